@@ -0,0 +1,286 @@
+/* ex: set tabstop=4 expandtab: */
+/*
+**==============================================================================
+**
+** Copyright (c) 2008, Michael E. Brasher
+** 
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+** 
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+** 
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+**==============================================================================
+*/
+
+// Times the parser and konkret over a schema written by konkret-mofgen and
+// prints the results as a line of JSON (one per schema, so that runs over
+// schemas of growing size show how each part scales).
+
+#include "mof/MOF_Parser.h"
+#include "mof/MOF_Class_Decl.h"
+#include "mof/MOF_Profile.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdarg>
+#include <climits>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+using namespace std;
+
+static const char* arg0;
+
+static void err(const char* format, ...)
+{
+    va_list ap;
+    fprintf(stderr, "%s: ", arg0);
+    va_start(ap, format);
+    vfprintf(stderr, format, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+    exit(1);
+}
+
+static void _remove_dir(const string& dir)
+{
+    DIR* d = opendir(dir.c_str());
+
+    if (!d)
+        return;
+
+    for (struct dirent* ent; (ent = readdir(d)) != NULL; )
+    {
+        if (strcmp(ent->d_name, ".") != 0 && strcmp(ent->d_name, "..") != 0)
+            unlink((dir + "/" + ent->d_name).c_str());
+    }
+
+    closedir(d);
+    rmdir(dir.c_str());
+}
+
+// Runs konkret on the given classes in a scratch directory and returns how
+// long it took.
+
+static double _generate(
+    const char* konkret, 
+    const string& schema, 
+    const vector<string>& classes,
+    const char* jobs)
+{
+    char dir[] = "/tmp/konkret-bench.XXXXXX";
+
+    if (!mkdtemp(dir))
+        err("failed to create a scratch directory");
+
+    string include = schema.substr(0, schema.rfind('/'));
+    vector<const char*> args;
+    args.push_back(konkret);
+    args.push_back("-I");
+    args.push_back(include.c_str());
+    args.push_back("-m");
+    args.push_back(schema.c_str());
+
+    if (jobs)
+    {
+        args.push_back("-j");
+        args.push_back(jobs);
+    }
+
+    for (size_t i = 0; i < classes.size(); i++)
+        args.push_back(classes[i].c_str());
+
+    args.push_back(NULL);
+
+    double start = MOF_Profile::now();
+    pid_t pid = fork();
+
+    if (pid == -1)
+        err("fork() failed");
+
+    if (pid == 0)
+    {
+        // Neither a schema from the environment nor a server or cache:
+
+        unsetenv("KONKRET_SCHEMA_DIR");
+        unsetenv("KONKRET_SERVER");
+        setenv("KONKRET_CACHE_DIR", "", 1);
+
+        int fd = open("/dev/null", O_WRONLY);
+
+        if (chdir(dir) != 0 || fd == -1 || dup2(fd, 1) == -1)
+            _exit(127);
+
+        execv(konkret, (char* const*)&args[0]);
+        _exit(127);
+    }
+
+    int status;
+
+    if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || 
+        WEXITSTATUS(status) != 0)
+    {
+        err("%s failed on %s", konkret, schema.c_str());
+    }
+
+    double seconds = MOF_Profile::now() - start;
+    _remove_dir(dir);
+    return seconds;
+}
+
+int main(int argc, char** argv)
+{
+    const char USAGE[] =
+        "Usage: %s [OPTIONS] SCHEMA\n"
+        "\n"
+        "Times MOF_parse_file() (and MOF_Class_Decl::handle() within it) and\n"
+        "class lookups over SCHEMA, then konkret on some of its classes.\n"
+        "\n"
+        "OPTIONS:\n"
+        "  -k FILE     The konkret program (without it, no generation)\n"
+        "  -g N        Number of classes for konkret (default: 50)\n"
+        "  -j N        Passed to konkret\n"
+        "  -a          Parse into an arena (see MOF_begin_arena())\n"
+        "  -h          Print this help message\n"
+        "\n";
+
+    arg0 = argv[0];
+
+    const char* konkret = 0;
+    const char* jobs = 0;
+    unsigned long num_generate = 50;
+    bool arena = false;
+
+    for (int opt; (opt = getopt(argc, argv, "k:g:j:ah")) != -1; )
+    {
+        switch (opt)
+        {
+            case 'k':
+                konkret = optarg;
+                break;
+            case 'g':
+                num_generate = strtoul(optarg, 0, 10);
+                break;
+            case 'j':
+                jobs = optarg;
+                break;
+            case 'a':
+                arena = true;
+                break;
+            case 'h':
+                printf(USAGE, arg0);
+                exit(0);
+            default:
+                err("invalid option: %c; try -h for help", opt);
+        }
+    }
+
+    if (optind + 1 != argc)
+        err("expected one schema argument. Try -h for help");
+
+    char path[PATH_MAX];
+
+    if (!realpath(argv[optind], path))
+        err("no such file: %s", argv[optind]);
+
+    string schema = path;
+    string include = schema.substr(0, schema.rfind('/'));
+    MOF_include_paths[MOF_num_include_paths++] = include.c_str();
+
+    // Parse:
+
+    if (arena)
+        MOF_begin_arena();
+
+    MOF_Profile::enabled = true;
+    double start = MOF_Profile::now();
+    MOF_parse_file(schema.c_str());
+    double parse_seconds = MOF_Profile::now() - start;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    long bytes = 0;
+
+    for (size_t i = 0; i < MOF_Profile::files.size(); i++)
+        bytes += MOF_Profile::files[i].bytes;
+
+    size_t nodes = 0;
+
+    for (size_t i = 0; i < MOF_Profile::NUM_NODES; i++)
+        nodes += MOF_Profile::nodes[i];
+
+    // Look up every class by name:
+
+    vector<string> classes;
+
+    for (MOF_Class_Decl* p = MOF_Class_Decl::list; p; 
+        p = (MOF_Class_Decl*)p->next)
+    {
+        classes.push_back(p->name);
+    }
+
+    start = MOF_Profile::now();
+
+    for (MOF_Class_Decl* p = MOF_Class_Decl::list; p; 
+        p = (MOF_Class_Decl*)p->next)
+    {
+        if (!MOF_Class_Decl::find(p->name))
+            err("lost class %s", p->name);
+    }
+
+    double find_seconds = MOF_Profile::now() - start;
+
+    // Generate classes spread over the schema:
+
+    double generate_seconds = 0;
+    vector<string> generate;
+
+    if (konkret && num_generate && classes.size())
+    {
+        size_t step = classes.size() / num_generate;
+
+        if (step == 0)
+            step = 1;
+
+        for (size_t i = 0; i < classes.size() && 
+            generate.size() < num_generate; i += step)
+        {
+            generate.push_back(classes[i]);
+        }
+
+        generate_seconds = _generate(konkret, schema, generate, jobs);
+    }
+
+    printf("{ \"schema\": \"%s\", \"classes\": %lu, \"files\": %lu, "
+        "\"bytes\": %ld, \"nodes\": %lu, \"parse_seconds\": %.6f, "
+        "\"handle_seconds\": %.6f, \"find_seconds\": %.6f, "
+        "\"arena\": %s, \"max_rss_kb\": %ld, "
+        "\"generated_classes\": %lu, \"generate_seconds\": %.6f }\n",
+        schema.c_str(), (unsigned long)classes.size(), 
+        (unsigned long)MOF_Profile::files.size(), bytes, 
+        (unsigned long)nodes, parse_seconds,
+        MOF_Profile::phase_seconds[MOF_Profile::VALIDATE_CLASS], find_seconds,
+        arena ? "true" : "false", usage.ru_maxrss, 
+        (unsigned long)generate.size(), generate_seconds);
+
+    return 0;
+}
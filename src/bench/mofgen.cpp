@@ -0,0 +1,350 @@
+/* ex: set tabstop=4 expandtab: */
+/*
+**==============================================================================
+**
+** Copyright (c) 2008, Michael E. Brasher
+** 
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+** 
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+** 
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+**==============================================================================
+*/
+
+// Writes a synthetic CIM-style schema for the benchmarks: a qualifiers file,
+// one file per class (named after it, as in the CIM schema) and a schema.mof
+// including them all, then instances.mof.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdarg>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+static const char* arg0;
+
+static void err(const char* format, ...)
+{
+    va_list ap;
+    fprintf(stderr, "%s: ", arg0);
+    va_start(ap, format);
+    vfprintf(stderr, format, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+    exit(1);
+}
+
+// Same schema for the same options on every platform (so not rand()):
+
+static unsigned long _seed = 1;
+
+static unsigned long _random(unsigned long n)
+{
+    _seed = _seed * 1103515245 + 12345;
+    return ((_seed >> 16) & 0x7fffffff) % n;
+}
+
+static FILE* _open(const string& dir, const string& name)
+{
+    string path = dir + "/" + name;
+    FILE* os = fopen(path.c_str(), "wb");
+
+    if (!os)
+        err("failed to open %s", path.c_str());
+
+    return os;
+}
+
+static void _close(FILE* os)
+{
+    if (fclose(os) != 0)
+        err("failed to write schema file");
+}
+
+static const char QUALIFIERS[] =
+    "Qualifier Abstract : boolean = false, Scope(class, association, "
+    "indication), Flavor(EnableOverride, Restricted);\n"
+    "Qualifier Association : boolean = false, Scope(association), "
+    "Flavor(DisableOverride, ToSubclass);\n"
+    "Qualifier Description : string = null, Scope(any), "
+    "Flavor(EnableOverride, ToSubclass, Translatable);\n"
+    "Qualifier In : boolean = true, Scope(parameter), "
+    "Flavor(DisableOverride, ToSubclass);\n"
+    "Qualifier Key : boolean = false, Scope(property, reference), "
+    "Flavor(DisableOverride, ToSubclass);\n"
+    "Qualifier MaxLen : uint32 = null, Scope(property, method, parameter), "
+    "Flavor(EnableOverride, ToSubclass);\n"
+    "Qualifier Out : boolean = false, Scope(parameter), "
+    "Flavor(DisableOverride, ToSubclass);\n"
+    "Qualifier Required : boolean = false, Scope(property, reference, "
+    "method, parameter), Flavor(DisableOverride, ToSubclass);\n"
+    "Qualifier Units : string = null, Scope(property, method, parameter), "
+    "Flavor(EnableOverride, ToSubclass, Translatable);\n"
+    "Qualifier ValueMap : string[], Scope(property, method, parameter), "
+    "Flavor(EnableOverride, ToSubclass);\n"
+    "Qualifier Values : string[], Scope(property, method, parameter), "
+    "Flavor(EnableOverride, ToSubclass, Translatable);\n"
+    "Qualifier Version : string = null, Scope(class, association, "
+    "indication), Flavor(EnableOverride, Restricted, Translatable);\n"
+    "Qualifier Write : boolean = false, Scope(property), "
+    "Flavor(EnableOverride, ToSubclass);\n";
+
+static const char* const TYPES[] =
+{
+    "string", "uint16", "uint32", "uint64", "boolean", "datetime", "sint32",
+    "string",
+};
+
+static const size_t NUM_TYPES = sizeof(TYPES) / sizeof(TYPES[0]);
+
+// Writes the qualifiers of a property (up to 5 of them; a uint16 gets a
+// ValueMap and Values pair in place of the second).
+
+static void _put_property_qualifiers(
+    FILE* os, 
+    const string& cn, 
+    size_t j, 
+    const char* type, 
+    size_t density)
+{
+    if (density == 0)
+        return;
+
+    fprintf(os, "    [Description(\"Property %lu of %s.\")", 
+        (unsigned long)j, cn.c_str());
+
+    if (density > 1)
+    {
+        if (strcmp(type, "uint16") == 0)
+            fprintf(os, ", ValueMap {\"0\", \"1\", \"2\"}, "
+                "Values {\"Unknown\", \"OK\", \"Error\"}");
+        else
+            fprintf(os, ", Write");
+    }
+
+    if (density > 2)
+        fprintf(os, ", Required");
+
+    if (density > 3 && strcmp(type, "string") == 0)
+        fprintf(os, ", MaxLen(256)");
+
+    if (density > 4)
+        fprintf(os, ", Units(\"Bytes\")");
+
+    fprintf(os, "]\n");
+}
+
+int main(int argc, char** argv)
+{
+    const char USAGE[] =
+        "Usage: %s [OPTIONS] DIR\n"
+        "\n"
+        "Writes a synthetic schema to DIR (schema.mof includes the rest).\n"
+        "\n"
+        "OPTIONS:\n"
+        "  -n N        Number of classes (default: 1000)\n"
+        "  -d N        Depth of each class hierarchy (default: 5)\n"
+        "  -p N        Properties per class (default: 8)\n"
+        "  -q N        Qualifiers per property, 0 to 5 (default: 2)\n"
+        "  -a N        Associations from each root class (default: 1)\n"
+        "  -i N        Number of instance declarations (default: 100)\n"
+        "  -s N        Random seed (default: 1)\n"
+        "  -h          Print this help message\n"
+        "\n";
+
+    arg0 = argv[0];
+
+    unsigned long num_classes = 1000;
+    unsigned long depth = 5;
+    unsigned long num_properties = 8;
+    unsigned long density = 2;
+    unsigned long fan_out = 1;
+    unsigned long num_instances = 100;
+
+    for (int opt; (opt = getopt(argc, argv, "n:d:p:q:a:i:s:h")) != -1; )
+    {
+        unsigned long* value = 0;
+
+        switch (opt)
+        {
+            case 'n': value = &num_classes; break;
+            case 'd': value = &depth; break;
+            case 'p': value = &num_properties; break;
+            case 'q': value = &density; break;
+            case 'a': value = &fan_out; break;
+            case 'i': value = &num_instances; break;
+            case 's': value = &_seed; break;
+            case 'h':
+                printf(USAGE, arg0);
+                exit(0);
+            default:
+                err("invalid option: %c; try -h for help", opt);
+        }
+
+        char* end;
+        *value = strtoul(optarg, &end, 10);
+
+        if (*end || !*optarg)
+            err("invalid -%c option: %s", opt, optarg);
+    }
+
+    if (optind + 1 != argc)
+        err("expected one directory argument. Try -h for help");
+
+    if (num_classes == 0 || depth == 0)
+        err("-n and -d must be at least 1");
+
+    if (density > 5)
+        density = 5;
+
+    string dir = argv[optind];
+
+    if (mkdir(dir.c_str(), 0777) != 0 && errno != EEXIST)
+        err("failed to create %s", dir.c_str());
+
+    vector<string> files;
+
+    // Qualifier declarations:
+
+    FILE* os = _open(dir, "qualifiers.mof");
+    fputs(QUALIFIERS, os);
+    _close(os);
+
+    // Classes, in chains of the given depth. Class i derives from class i-1
+    // unless it starts a chain; properties are named after the level so that
+    // none is overridden.
+
+    vector<string> classes;
+    vector<size_t> roots;
+
+    for (size_t i = 0; i < num_classes; i++)
+    {
+        char buf[64];
+        sprintf(buf, "Bench_Class%lu", (unsigned long)i);
+        string cn = buf;
+        size_t level = i % depth;
+
+        classes.push_back(cn);
+        os = _open(dir, cn + ".mof");
+
+        fprintf(os, "[Version(\"1.0.0\"), Description(\"Synthetic class %s.\")]"
+            "\n", cn.c_str());
+
+        if (level == 0)
+        {
+            roots.push_back(i);
+            fprintf(os, "class %s\n{\n", cn.c_str());
+            fprintf(os, "    [Key, Description(\"Identifies the instance.\")]"
+                "\n    string InstanceID;\n");
+        }
+        else
+            fprintf(os, "class %s : %s\n{\n", cn.c_str(), classes[i-1].c_str());
+
+        for (size_t j = 0; j < num_properties; j++)
+        {
+            const char* type = TYPES[j % NUM_TYPES];
+
+            _put_property_qualifiers(os, cn, j, type, density);
+            fprintf(os, "    %s L%luProperty%lu%s;\n", type, 
+                (unsigned long)level, (unsigned long)j, 
+                j % NUM_TYPES == NUM_TYPES - 1 ? "[]" : "");
+        }
+
+        // A method on every third class:
+
+        if (i % 3 == 0)
+        {
+            fprintf(os, 
+                "    uint32 Method%lu([In] string Name, [In, Out] uint16 Level,"
+                " [Out] string Result);\n", (unsigned long)i);
+        }
+
+        fprintf(os, "};\n");
+        _close(os);
+        files.push_back(cn + ".mof");
+    }
+
+    // Associations between each root class and random other classes:
+
+    for (size_t r = 0; r < roots.size(); r++)
+    {
+        for (size_t f = 0; f < fan_out; f++)
+        {
+            char buf[64];
+            sprintf(buf, "Bench_Assoc%lu_%lu", (unsigned long)r, 
+                (unsigned long)f);
+            string an = buf;
+            const string& antecedent = classes[roots[r]];
+            const string& dependent = classes[_random(classes.size())];
+
+            os = _open(dir, an + ".mof");
+            fprintf(os, "[Association, Version(\"1.0.0\")]\nclass %s\n{\n", 
+                an.c_str());
+            fprintf(os, "    [Key] %s REF Antecedent;\n", antecedent.c_str());
+            fprintf(os, "    [Key] %s REF Dependent;\n", dependent.c_str());
+            fprintf(os, "};\n");
+            _close(os);
+            files.push_back(an + ".mof");
+        }
+    }
+
+    // Instances of random classes:
+
+    os = _open(dir, "instances.mof");
+
+    for (size_t i = 0; i < num_instances; i++)
+    {
+        size_t c = _random(classes.size());
+
+        fprintf(os, "instance of %s\n{\n", classes[c].c_str());
+        fprintf(os, "    InstanceID = \"Bench:%lu\";\n", (unsigned long)i);
+
+        if (num_properties)
+        {
+            fprintf(os, "    L%luProperty0 = \"Instance %lu\";\n", 
+                (unsigned long)(c % depth), (unsigned long)i);
+        }
+
+        fprintf(os, "};\n");
+    }
+
+    _close(os);
+
+    // The schema itself:
+
+    os = _open(dir, "schema.mof");
+    fprintf(os, "#pragma include (\"qualifiers.mof\")\n");
+
+    for (size_t i = 0; i < files.size(); i++)
+        fprintf(os, "#pragma include (\"%s\")\n", files[i].c_str());
+
+    fprintf(os, "#pragma include (\"instances.mof\")\n");
+    _close(os);
+
+    printf("Created %s/schema.mof (%lu classes, %lu associations, "
+        "%lu instances)\n", dir.c_str(), (unsigned long)classes.size(), 
+        (unsigned long)(files.size() - classes.size()), 
+        (unsigned long)num_instances);
+
+    return 0;
+}
@@ -0,0 +1,317 @@
+/*
+**==============================================================================
+**
+** Copyright (c) 2008, Michael E. Brasher
+** 
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+** 
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+** 
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+**==============================================================================
+*/
+
+#include "konkret.h"
+
+/*
+**==============================================================================
+**
+** Each thread owns a stack of chunks. Allocation bumps the offset of the top
+** chunk; a mark is the arena-wide offset of the top of the stack, so it can be
+** rewound across chunks. The first chunk is kept when the arena is reset so a
+** steady stream of requests does not touch the global allocator at all.
+**
+**==============================================================================
+*/
+
+#define CHUNK_SIZE (16 * 1024)
+
+typedef union _Align
+{
+    void* p;
+    long long l;
+    double d;
+    long double ld;
+}
+Align;
+
+#define ALIGN(N) (((N) + sizeof(Align) - 1) & ~(sizeof(Align) - 1))
+
+typedef struct _Chunk
+{
+    struct _Chunk* prev;
+
+    /* Arena offset of the first byte of this chunk */
+    size_t base;
+
+    size_t size;
+    size_t used;
+}
+Chunk;
+
+#define DATA(CHUNK) ((char*)(CHUNK) + ALIGN(sizeof(Chunk)))
+
+typedef struct _Arena
+{
+    Chunk* top;
+    size_t depth;
+}
+Arena;
+
+static pthread_key_t _key;
+static pthread_once_t _once = PTHREAD_ONCE_INIT;
+static int _keyed;
+
+static void _free_chunks(Chunk* chunk, Chunk* last)
+{
+    while (chunk != last)
+    {
+        Chunk* prev = chunk->prev;
+        free(chunk);
+        chunk = prev;
+    }
+}
+
+static void _destroy(void* data)
+{
+    Arena* self = (Arena*)data;
+
+    _free_chunks(self->top, NULL);
+    free(self);
+}
+
+static void _make_key(void)
+{
+    _keyed = pthread_key_create(&_key, _destroy) == 0;
+}
+
+/* When the provider library is unloaded, delete the key so that threads of
+   the broker that exit later do not call _destroy() in unmapped code. The
+   arena of the unloading thread is freed; those of other threads leak. */
+
+#if defined(__GNUC__)
+
+__attribute__((destructor))
+static void _delete_key(void)
+{
+    Arena* self;
+
+    if (!_keyed)
+        return;
+
+    if ((self = (Arena*)pthread_getspecific(_key)))
+        _destroy(self);
+
+    pthread_key_delete(_key);
+    _keyed = 0;
+}
+
+#endif /* __GNUC__ */
+
+static Arena* _arena(void)
+{
+    Arena* self;
+
+    pthread_once(&_once, _make_key);
+
+    if (!_keyed)
+        return NULL;
+
+    if ((self = (Arena*)pthread_getspecific(_key)))
+        return self;
+
+    if (!(self = (Arena*)calloc(1, sizeof(Arena))))
+        return NULL;
+
+    if (pthread_setspecific(_key, self) != 0)
+    {
+        free(self);
+        return NULL;
+    }
+
+    return self;
+}
+
+static Chunk* _push(Arena* self, size_t size)
+{
+    Chunk* chunk;
+
+    if (size < CHUNK_SIZE)
+        size = CHUNK_SIZE;
+
+    if (!(chunk = (Chunk*)malloc(ALIGN(sizeof(Chunk)) + size)))
+        return NULL;
+
+    chunk->prev = self->top;
+    chunk->base = self->top ? self->top->base + self->top->size : 0;
+    chunk->size = size;
+    chunk->used = 0;
+    self->top = chunk;
+
+    return chunk;
+}
+
+void* KArenaAlloc(size_t size)
+{
+    Arena* self;
+    Chunk* chunk;
+    void* ptr;
+
+    if (!(self = _arena()))
+        return NULL;
+
+    size = size ? ALIGN(size) : sizeof(Align);
+    chunk = self->top;
+
+    if (!chunk || chunk->size - chunk->used < size)
+    {
+        if (!(chunk = _push(self, size)))
+            return NULL;
+    }
+
+    ptr = DATA(chunk) + chunk->used;
+    chunk->used += size;
+    return ptr;
+}
+
+char* KArenaVPrintf(const char* format, va_list ap)
+{
+    Arena* self;
+    Chunk* chunk;
+    va_list tmp;
+    size_t avail = 0;
+    char* str = NULL;
+    int n;
+
+    if (!(self = _arena()))
+        return NULL;
+
+    /* Try to format straight into the space left in the top chunk */
+
+    if ((chunk = self->top))
+    {
+        str = DATA(chunk) + chunk->used;
+        avail = chunk->size - chunk->used;
+    }
+
+    va_copy(tmp, ap);
+    n = vsnprintf(str, avail, format, tmp);
+    va_end(tmp);
+
+    if (n < 0)
+        return NULL;
+
+    if ((size_t)n < avail)
+    {
+        chunk->used += ALIGN((size_t)n + 1);
+
+        /* The rounded size may exceed what was left */
+        if (chunk->used > chunk->size)
+            chunk->used = chunk->size;
+
+        return str;
+    }
+
+    if (!(str = (char*)KArenaAlloc((size_t)n + 1)))
+        return NULL;
+
+    va_copy(tmp, ap);
+    vsnprintf(str, (size_t)n + 1, format, tmp);
+    va_end(tmp);
+
+    return str;
+}
+
+char* KArenaPrintf(const char* format, ...)
+{
+    va_list ap;
+    char* str;
+
+    va_start(ap, format);
+    str = KArenaVPrintf(format, ap);
+    va_end(ap);
+
+    return str;
+}
+
+size_t KArenaMark(void)
+{
+    Arena* self;
+
+    if (!(self = _arena()) || !self->top)
+        return 0;
+
+    return self->top->base + self->top->used;
+}
+
+void KArenaRelease(size_t mark)
+{
+    Arena* self;
+    Chunk* chunk;
+
+    if (!(self = _arena()) || !self->top)
+        return;
+
+    /* Drop the chunks that were pushed after the mark was taken */
+
+    for (chunk = self->top; chunk->prev && chunk->base > mark; )
+    {
+        Chunk* prev = chunk->prev;
+        free(chunk);
+        chunk = prev;
+    }
+
+    self->top = chunk;
+
+    if (mark < chunk->base + chunk->used)
+        chunk->used = mark > chunk->base ? mark - chunk->base : 0;
+}
+
+void KArenaEnter(void)
+{
+    Arena* self;
+
+    if ((self = _arena()))
+        self->depth++;
+}
+
+void KArenaLeave(void)
+{
+    Arena* self;
+    Chunk* first;
+
+    if (!(self = _arena()))
+        return;
+
+    if (self->depth)
+        self->depth--;
+
+    if (self->depth || !self->top)
+        return;
+
+    /* Outermost scope: keep only the first chunk (unless oversized) */
+
+    for (first = self->top; first->prev; first = first->prev)
+        ;
+
+    if (first->size > CHUNK_SIZE)
+        first = NULL;
+    else
+        first->used = 0;
+
+    _free_chunks(self->top, first);
+    self->top = first;
+}
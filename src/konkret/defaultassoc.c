@@ -395,3 +395,296 @@ CMPIStatus KDefaultReferences(
     return _find_references(mb, mi, cc, cr, cop, thisClass, assocClass, role, 
         _deliver_instance_callback, properties);
 }
+
+/*
+**==============================================================================
+**
+** KAssoc
+**
+**==============================================================================
+*/
+
+static CMPIBoolean _contains(const char* const* isa, const char* cn)
+{
+    for (; *isa; isa++)
+    {
+        if (strcasecmp(*isa, cn) == 0)
+            return 1;
+    }
+
+    return 0;
+}
+
+/* True if cop names an instance of the role's declared class */
+static CMPIBoolean _is_a(
+    const CMPIBroker* mb,
+    const CMPIObjectPath* cop,
+    const KAssoc* assoc,
+    const KAssocRole* role)
+{
+    const char* cn = KClassName(cop);
+
+    if (!cn)
+        return 0;
+
+    if (strcasecmp(role->isa[0], cn) == 0 || _contains(role->subclasses, cn))
+        return 1;
+
+    /* A known class that is neither the declared class nor a subclass */
+
+    if (_contains(assoc->classes, cn))
+        return 0;
+
+    return CMClassPathIsA(mb, cop, role->isa[0], NULL);
+}
+
+typedef struct _ResultClass
+{
+    const char* name;
+    char last[128];
+    CMPIBoolean match;
+}
+ResultClass;
+
+/* Runtime check of a target whose declared class is not resultClass or a
+   subclass of it; remembers the answer for the last class seen */
+static CMPIBoolean _result_class(
+    const CMPIBroker* mb,
+    const CMPIObjectPath* cop,
+    ResultClass* rc)
+{
+    const char* cn = KClassName(cop);
+
+    if (!cn)
+        return 0;
+
+    if (strcasecmp(cn, rc->name) == 0)
+        return 1;
+
+    if (strcasecmp(cn, rc->last) != 0)
+    {
+        if (KStrlcpy(rc->last, cn, sizeof(rc->last)) >= sizeof(rc->last))
+            return CMClassPathIsA(mb, cop, rc->name, NULL);
+
+        rc->match = CMClassPathIsA(mb, cop, rc->name, NULL);
+    }
+
+    return rc->match;
+}
+
+static CMPIStatus _traverse(
+    const CMPIBroker* mb,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop,
+    const KAssoc* assoc,
+    const char* assocClass,
+    const char* resultClass,
+    const char* role,
+    const char* resultRole,
+    CMPIBoolean references,
+    FindCallback callback,
+    void* client_data)
+{
+    const KAssocRole* sources[MAX_REFS];
+    const KAssocRole* targets[MAX_REFS];
+    CMPIBoolean checks[MAX_REFS];
+    size_t numSources = 0;
+    size_t numTargets = 0;
+    ResultClass rc;
+    CMPIEnumeration* en;
+    CMPIObjectPath* ccop; /* class cop */
+    CMPIStatus st;
+    size_t i;
+
+    if (!assoc || assoc->numRoles > MAX_REFS)
+        CMReturn(CMPI_RC_ERR_FAILED);
+
+    /* Return now if this association is not an assocClass */
+
+    if (assocClass && !_contains(assoc->isa, assocClass))
+        CMReturn(CMPI_RC_OK);
+
+    /* Find the roles cop may play */
+
+    for (i = 0; i < assoc->numRoles; i++)
+    {
+        const KAssocRole* r = &assoc->roles[i];
+
+        if (role && strcasecmp(r->name, role) != 0)
+            continue;
+
+        if (_is_a(mb, cop, assoc, r))
+            sources[numSources++] = r;
+    }
+
+    if (numSources == 0)
+        CMReturn(CMPI_RC_OK);
+
+    /* Find the roles to deliver. No target of a role whose declared class
+       is (a subclass of) resultClass needs checking, and none of one whose
+       class is unrelated to it can match */
+
+    if (!references)
+    {
+        for (i = 0; i < assoc->numRoles; i++)
+        {
+            const KAssocRole* r = &assoc->roles[i];
+
+            if (resultRole && strcasecmp(r->name, resultRole) != 0)
+                continue;
+
+            checks[numTargets] = 0;
+
+            if (resultClass && !_contains(r->isa, resultClass))
+            {
+                if (_contains(assoc->classes, resultClass) &&
+                    !_contains(r->subclasses, resultClass))
+                {
+                    continue;
+                }
+
+                checks[numTargets] = 1;
+            }
+
+            targets[numTargets++] = r;
+        }
+
+        if (numTargets == 0)
+            CMReturn(CMPI_RC_OK);
+
+        memset(&rc, 0, sizeof(rc));
+        rc.name = resultClass;
+    }
+
+    /* Enumerate all instance names of the association class */
+
+    ccop = CMNewObjectPath(mb, KNameSpace(cop), assoc->isa[0], &st);
+
+    if (!ccop || st.rc)
+        return st;
+
+    en = mb->bft->enumerateInstanceNames(mb, cc, ccop, &st);
+
+    if (!en || st.rc)
+        return st;
+
+    while (CMHasNext(en, &st))
+    {
+        CMPIData cd;
+        CMPIObjectPath* acop; /* association cop */
+        const KAssocRole* from = NULL;
+
+        cd = CMGetNext(en, &st);
+
+        if (st.rc)
+            return st;
+
+        if (cd.type != CMPI_ref || !cd.value.ref)
+            continue;
+
+        acop = cd.value.ref;
+
+        /* Look only at the role keys cop may be in */
+
+        for (i = 0; i < numSources && !from; i++)
+        {
+            cd = CMGetKey(acop, sources[i]->name, &st);
+
+            if (KOkay(st) && cd.type == CMPI_ref && cd.value.ref &&
+                KMatch(cop, cd.value.ref))
+            {
+                from = sources[i];
+            }
+        }
+
+        if (!from)
+            continue;
+
+        if (references)
+        {
+            (*callback)(mb, cc, cr, acop, client_data);
+            continue;
+        }
+
+        for (i = 0; i < numTargets; i++)
+        {
+            if (targets[i] == from)
+                continue;
+
+            cd = CMGetKey(acop, targets[i]->name, &st);
+
+            if (!KOkay(st) || cd.type != CMPI_ref || !cd.value.ref)
+                continue;
+
+            if (checks[i] && !_result_class(mb, cd.value.ref, &rc))
+                continue;
+
+            (*callback)(mb, cc, cr, cd.value.ref, client_data);
+        }
+    }
+
+    CMReturn(CMPI_RC_OK);
+}
+
+CMPIStatus KAssociators(
+    const CMPIBroker* mb,
+    CMPIAssociationMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop,
+    const KAssoc* assoc,
+    const char* assocClass,
+    const char* resultClass,
+    const char* role,
+    const char* resultRole,
+    const char** properties)
+{
+    return _traverse(mb, cc, cr, cop, assoc, assocClass, resultClass, role,
+        resultRole, 0, _deliver_instance_callback, (void*)properties);
+}
+
+CMPIStatus KAssociatorNames(
+    const CMPIBroker* mb,
+    CMPIAssociationMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop,
+    const KAssoc* assoc,
+    const char* assocClass,
+    const char* resultClass,
+    const char* role,
+    const char* resultRole)
+{
+    return _traverse(mb, cc, cr, cop, assoc, assocClass, resultClass, role,
+        resultRole, 0, _deliver_object_path_callback, NULL);
+}
+
+CMPIStatus KReferences(
+    const CMPIBroker* mb,
+    CMPIAssociationMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop,
+    const KAssoc* assoc,
+    const char* assocClass,
+    const char* role,
+    const char** properties)
+{
+    return _traverse(mb, cc, cr, cop, assoc, assocClass, NULL, role, NULL,
+        1, _deliver_instance_callback, (void*)properties);
+}
+
+CMPIStatus KReferenceNames(
+    const CMPIBroker* mb,
+    CMPIAssociationMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop,
+    const KAssoc* assoc,
+    const char* assocClass,
+    const char* role)
+{
+    return _traverse(mb, cc, cr, cop, assoc, assocClass, NULL, role, NULL,
+        1, _deliver_object_path_callback, NULL);
+}
@@ -28,30 +28,122 @@
 #define enumInstanceNames enumerateInstanceNames
 #include "konkret.h"
 
-CMPIStatus KDefaultEnumerateInstancesOneToAll(
+CMPIStatus KAssocBuilder_Init(
+    KAssocBuilder* self,
     const CMPIBroker* cb,
-    const CMPIContext* cc, 
-    const CMPIResult* cr, 
-    const CMPIObjectPath* assocCop,
+    const CMPIResult* cr,
+    const char* ns,
+    const char* assocClass,
     const CMPIObjectPath* fromCop,
     const char* fromRole,
-    const CMPIObjectPath* toCop,
-    const char* toRole)
+    const char* toRole,
+    CMPIBoolean namesOnly)
 {
-    CMPIEnumeration* e;
-    CMPIStatus st;
+    CMPIStatus st = KSTATUS_INIT;
 
     /* Check args */
 
-    if (!cb || !cc || !cr || !assocCop || !fromCop || !fromRole || !toCop || 
+    if (!self || !cb || !cr || !assocClass || !fromCop || !fromRole || 
         !toRole)
     {
         KReturn(ERR_FAILED);
     }
 
-    /* Enumerate instances names of toCop */
+    memset(self, 0, sizeof(KAssocBuilder));
+    self->cb = cb;
+    self->cr = cr;
+    self->toRole = toRole;
 
-    if (!(e = cb->bft->enumerateInstanceNames(cb, cc, toCop, &st)))
+    /* Prepare the association object path */
+
+    if (!(self->cop = CMNewObjectPath(cb, ns, assocClass, &st)) || st.rc)
+    {
+        KReturn(ERR_FAILED);
+    }
+
+    if (CMAddKey(self->cop, fromRole, (CMPIValue*)&fromCop, CMPI_ref).rc)
+    {
+        KReturn(ERR_FAILED);
+    }
+
+    if (namesOnly)
+        KReturn(OK);
+
+    /* Prepare the association instance */
+
+    if (!(self->ci = CMNewInstance(cb, self->cop, &st)))
+    {
+        KReturn(ERR_FAILED);
+    }
+
+    if (CMSetProperty(self->ci, fromRole, (CMPIValue*)&fromCop, CMPI_ref).rc)
+    {
+        KReturn(ERR_FAILED);
+    }
+
+    KReturn(OK);
+}
+
+CMPIStatus KAssocBuilder_Add(
+    KAssocBuilder* self,
+    const CMPIObjectPath* toCop)
+{
+    const char* role;
+
+    if (!self || !self->cop || !toCop)
+    {
+        KReturn(ERR_FAILED);
+    }
+
+    role = self->toRole;
+
+    if (CMAddKey(self->cop, role, (CMPIValue*)&toCop, CMPI_ref).rc)
+    {
+        KReturn(ERR_FAILED);
+    }
+
+    if (!self->ci)
+        return CMReturnObjectPath(self->cr, self->cop);
+
+    if (CMSetProperty(self->ci, role, (CMPIValue*)&toCop, CMPI_ref).rc ||
+        self->ci->ft->setObjectPath(self->ci, self->cop).rc)
+    {
+        KReturn(ERR_FAILED);
+    }
+
+    return CMReturnInstance(self->cr, self->ci);
+}
+
+CMPIStatus KAssocBuilder_AddArray(
+    KAssocBuilder* self,
+    const CMPIObjectPath* const* toCops,
+    size_t count)
+{
+    size_t i;
+
+    if (count && !toCops)
+    {
+        KReturn(ERR_FAILED);
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        CMPIStatus st = KAssocBuilder_Add(self, toCops[i]);
+
+        if (!KOkay(st))
+            return st;
+    }
+
+    KReturn(OK);
+}
+
+CMPIStatus KAssocBuilder_AddEnumeration(
+    KAssocBuilder* self,
+    CMPIEnumeration* e)
+{
+    CMPIStatus st = KSTATUS_INIT;
+
+    if (!e)
     {
         KReturn(ERR_FAILED);
     }
@@ -59,8 +151,6 @@ CMPIStatus KDefaultEnumerateInstancesOneToAll(
     while (CMHasNext(e, &st))
     {
         CMPIData cd;
-        CMPIObjectPath* cop;
-        CMPIInstance* ci;
 
         /* Get next instance name */
 
@@ -71,43 +161,47 @@ CMPIStatus KDefaultEnumerateInstancesOneToAll(
             KReturn(ERR_FAILED);
         }
 
-        /* Create association object path */
-
-        if (!(cop = CMNewObjectPath(cb, KNameSpace(assocCop), 
-            KClassName(assocCop), &st)) || st.rc)
-        {
-            KReturn(ERR_FAILED);
-        }
+        if (!KOkay(st = KAssocBuilder_Add(self, cd.value.ref)))
+            return st;
+    }
 
-        if (CMAddKey(cop, fromRole, (CMPIValue*)&fromCop, CMPI_ref).rc)
-        {
-            KReturn(ERR_FAILED);
-        }
+    KReturn(OK);
+}
 
-        if (CMAddKey(cop, toRole, (CMPIValue*)&cd.value.ref, CMPI_ref).rc)
-        {
-            KReturn(ERR_FAILED);
-        }
+CMPIStatus KDefaultEnumerateInstancesOneToAll(
+    const CMPIBroker* cb,
+    const CMPIContext* cc, 
+    const CMPIResult* cr, 
+    const CMPIObjectPath* assocCop,
+    const CMPIObjectPath* fromCop,
+    const char* fromRole,
+    const CMPIObjectPath* toCop,
+    const char* toRole)
+{
+    KAssocBuilder builder;
+    CMPIEnumeration* e;
+    CMPIStatus st;
 
-        /* Create association instance */
+    /* Check args */
 
-        if (!(ci = CMNewInstance(cb, cop, &st)))
-        {
-            KReturn(ERR_FAILED);
-        }
+    if (!cb || !cc || !cr || !assocCop || !fromCop || !fromRole || !toCop || 
+        !toRole)
+    {
+        KReturn(ERR_FAILED);
+    }
 
-        if (CMSetProperty(ci, fromRole, (CMPIValue*)&fromCop, CMPI_ref).rc)
-        {
-            KReturn(ERR_FAILED);
-        }
+    if (!KOkay(st = KAssocBuilder_Init(&builder, cb, cr, KNameSpace(assocCop),
+        KClassName(assocCop), fromCop, fromRole, toRole, 0)))
+    {
+        return st;
+    }
 
-        if (CMSetProperty(ci, toRole, (CMPIValue*)&cd.value.ref, CMPI_ref).rc)
-        {
-            KReturn(ERR_FAILED);
-        }
+    /* Enumerate instances names of toCop */
 
-        CMReturnInstance(cr, ci);
+    if (!(e = cb->bft->enumerateInstanceNames(cb, cc, toCop, &st)))
+    {
+        KReturn(ERR_FAILED);
     }
 
-    KReturn(OK);
+    return KAssocBuilder_AddEnumeration(&builder, e);
 }
@@ -0,0 +1,222 @@
+/*
+**==============================================================================
+**
+** Copyright (c) 2008, Michael E. Brasher
+** 
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+** 
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+** 
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+**==============================================================================
+*/
+
+#define enumInstances enumerateInstances
+#include "konkret.h"
+#include <strings.h>
+
+typedef struct _DefaultEQ_Handle
+{
+    const CMPIBroker* cb;
+    const CMPIResult* result;
+    const KQuery* query;
+
+    /* The selected properties (the filter for returned instances) */
+    const char** properties;
+
+    /* Set by __KQueryMatch() for the instance about to be returned */
+    CMPIBoolean matched;
+}
+DefaultEQ_Handle;
+
+typedef struct _DefaultEQ_Result
+{
+    void* hdl;
+    CMPIResultFT* ft;
+}
+DefaultEQ_Result;
+
+static CMPIStatus _DefaultEQ_release(
+    CMPIResult* self)
+{
+    KReturn(OK);
+}
+
+static CMPIResult* _DefaultEQ_clone(
+    const CMPIResult* self, 
+    CMPIStatus* status)
+{
+    if (status)
+        KSetStatus(status, ERR_FAILED);
+
+    return NULL;
+}
+
+static CMPIStatus _DefaultEQ_returnData(
+    const CMPIResult* self, 
+    const CMPIValue* value, 
+    const CMPIType type)
+{
+    KReturn(ERR_FAILED);
+}
+
+static CMPIStatus _DefaultEQ_returnInstance(
+    const CMPIResult* self, 
+    const CMPIInstance* ci)
+{
+    DefaultEQ_Handle* handle = 
+        (DefaultEQ_Handle*)(((DefaultEQ_Result*)self)->hdl);
+
+    /* Instances returned without going through KReturnInstance() */
+
+    if (!handle->matched && 
+        !KQuery_MatchInstance(handle->query, handle->cb, ci))
+    {
+        KReturn(OK);
+    }
+
+    handle->matched = 0;
+
+    if (handle->properties)
+        CMSetPropertyFilter((CMPIInstance*)ci, handle->properties, NULL);
+
+    return CMReturnInstance(handle->result, ci);
+}
+
+static CMPIStatus _DefaultEQ_returnObjectPath(
+    const CMPIResult* self, 
+    const CMPIObjectPath* cop)
+{
+    KReturn(ERR_FAILED);
+}
+
+static CMPIStatus _DefaultEQ_returnDone(
+    const CMPIResult * self)
+{
+    DefaultEQ_Handle* handle = 
+        (DefaultEQ_Handle*)(((DefaultEQ_Result*)self)->hdl);
+
+    return CMReturnDone(handle->result);
+}
+
+static CMPIStatus _DefaultEQ_returnError(
+    const CMPIResult* self, 
+    const CMPIError* err)
+{
+    KReturn(ERR_FAILED);
+}
+
+static CMPIResultFT _ft =
+{
+    CMPICurrentVersion,
+    _DefaultEQ_release,
+    _DefaultEQ_clone,
+    _DefaultEQ_returnData,
+    _DefaultEQ_returnInstance,
+    _DefaultEQ_returnObjectPath,
+    _DefaultEQ_returnDone,
+    _DefaultEQ_returnError
+};
+
+CMPIBoolean __KQueryMatch(const CMPIResult* result, const KBase* base)
+{
+    DefaultEQ_Handle* handle;
+    int r;
+
+    if (!result || result->ft != &_ft)
+        return 1;
+
+    handle = (DefaultEQ_Handle*)(((DefaultEQ_Result*)result)->hdl);
+
+    /* If the structure cannot tell, the instance is tested when returned */
+    r = KQuery_Decide(handle->query, base);
+    handle->matched = r == 1;
+    return r != 0;
+}
+
+static int _supported_language(const char* lang)
+{
+    return lang && (strcasecmp(lang, "WQL") == 0 || 
+        strcasecmp(lang, "CQL") == 0 || strcasecmp(lang, "DMTF:CQL") == 0 ||
+        strcasecmp(lang, "CIM:CQL") == 0);
+}
+
+CMPIStatus KDefaultExecQuery(
+    const CMPIBroker* mb,
+    CMPIInstanceMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop,
+    const char* lang,
+    const char* query,
+    const unsigned char* sig,
+    KGetInstanceProc lookup)
+{
+    DefaultEQ_Result result;
+    DefaultEQ_Handle handle;
+    CMPIStatus st = KSTATUS_INIT;
+    CMPIObjectPath* path;
+    const char** requested;
+    KQuery* q;
+
+    if (!_supported_language(lang))
+        KReturn(ERR_QUERY_LANGUAGE_NOT_SUPPORTED);
+
+    if (!(q = KQuery_New(query, &st)))
+        return st;
+
+    /* Let the CIMOM filter queries that cannot be evaluated exactly */
+
+    if (!KQuery_Bind(q, sig))
+    {
+        KQuery_Delete(q);
+        KReturn(ERR_NOT_SUPPORTED);
+    }
+
+    handle.cb = mb;
+    handle.result = cr;
+    handle.query = q;
+    handle.properties = KQuery_Properties(q);
+    requested = KQuery_RequestedProperties(q);
+    handle.matched = 0;
+
+    result.hdl = (void*)&handle;
+    result.ft = &_ft;
+
+    /* Look up a single instance if the query fixes every key */
+
+    if (lookup && (path = KQuery_KeyPath(q, mb, KNameSpace(cop), 
+        KClassName(cop))))
+    {
+        st = (*lookup)(mi, cc, (CMPIResult*)(void*)&result, path, 
+            requested);
+
+        if (st.rc == CMPI_RC_ERR_NOT_FOUND)
+            KSetStatus(&st, OK);
+
+        if (st.rc != CMPI_RC_ERR_NOT_SUPPORTED)
+        {
+            KQuery_Delete(q);
+            return st;
+        }
+    }
+
+    st = (*mi->ft->enumerateInstances)(
+        mi, cc, (CMPIResult*)(void*)&result, cop, requested);
+
+    KQuery_Delete(q);
+    return st;
+}
@@ -27,6 +27,7 @@
 #include "konkret.h"
 
 #include <strings.h>
+#include <ctype.h>
 /*
 **==============================================================================
 **
@@ -982,6 +983,155 @@ CMPIBoolean KMatch(const CMPIObjectPath* cop1, const CMPIObjectPath* cop2)
     return 1;
 }
 
+/*
+**==============================================================================
+**
+** KHash
+**
+**==============================================================================
+*/
+
+static CMPIUint32 _hash_key(CMPIUint32 h, const CMPIData* cd)
+{
+    h = KHashBytes(h, &cd->type, sizeof(cd->type));
+
+    if (cd->state & CMPI_nullValue)
+        return KHashBytes(h, "\0", 1);
+
+    switch (cd->type)
+    {
+        case CMPI_boolean:
+            return KHashBytes(h, &cd->value.boolean, sizeof(CMPIBoolean));
+        case CMPI_uint8:
+        case CMPI_sint8:
+            return KHashBytes(h, &cd->value.uint8, 1);
+        case CMPI_uint16:
+        case CMPI_sint16:
+        case CMPI_char16:
+            return KHashBytes(h, &cd->value.uint16, 2);
+        case CMPI_uint32:
+        case CMPI_sint32:
+            return KHashBytes(h, &cd->value.uint32, 4);
+        case CMPI_uint64:
+        case CMPI_sint64:
+            return KHashBytes(h, &cd->value.uint64, 8);
+        case CMPI_real32:
+            return KHashBytes(h, &cd->value.real32, sizeof(CMPIReal32));
+        case CMPI_real64:
+            return KHashBytes(h, &cd->value.real64, sizeof(CMPIReal64));
+        case CMPI_string:
+        {
+            const char* s = KChars(cd->value.string);
+            return s ? KHashBytes(h, s, strlen(s)) : h;
+        }
+        case CMPI_dateTime:
+        {
+            CMPIUint64 x = CMGetBinaryFormat(cd->value.dateTime, NULL);
+            return KHashBytes(h, &x, sizeof(x));
+        }
+        case CMPI_ref:
+            return KHashObjectPath(h, cd->value.ref);
+        default:
+            return h;
+    }
+}
+
+CMPIUint32 KHashObjectPath(CMPIUint32 h, const CMPIObjectPath* cop)
+{
+    CMPIStatus st = KSTATUS_INIT;
+    CMPICount count;
+    CMPICount i;
+    CMPIUint32 sum = 0;
+
+    if (!cop)
+        return KHashBytes(h, "\0", 1);
+
+    count = CMGetKeyCount(cop, &st);
+
+    if (!KOkay(st))
+        return h;
+
+    /* Sum per-key hashes since KMatch() ignores the order of the keys */
+
+    for (i = 0; i < count; i++)
+    {
+        CMPIData cd;
+        CMPIString* pn;
+        const char* p;
+        CMPIUint32 hk = KHASH_INIT;
+
+        cd = CMGetKeyAt(cop, i, &pn, &st);
+
+        if (!KOkay(st) || !(p = KChars(pn)))
+            continue;
+
+        /* Key names are case-insensitive */
+
+        for (; *p; p++)
+        {
+            char c = (char)tolower((unsigned char)*p);
+            hk = KHashBytes(hk, &c, 1);
+        }
+
+        sum += _hash_key(hk, &cd);
+    }
+
+    h = KHashBytes(h, &count, sizeof(count));
+    return KHashBytes(h, &sum, sizeof(sum));
+}
+
+CMPIUint32 KHashDateTime(CMPIUint32 h, const KDateTime* self)
+{
+    h = KHashState(h, (const KValue*)self);
+
+    if (self->exists && !self->null && self->value)
+    {
+        CMPIUint64 x = CMGetBinaryFormat(self->value, NULL);
+        h = KHashBytes(h, &x, sizeof(x));
+    }
+
+    return h;
+}
+
+CMPIBoolean KDateTime_Equal(const KDateTime* x, const KDateTime* y)
+{
+    if (!x->exists != !y->exists || !x->null != !y->null)
+        return 0;
+
+    if (!x->exists || x->null)
+        return 1;
+
+    if (!x->value || !y->value)
+        return x->value == y->value;
+
+    return CMGetBinaryFormat(x->value, NULL) ==
+        CMGetBinaryFormat(y->value, NULL);
+}
+
+CMPIUint32 KHashRef(CMPIUint32 h, const KRef* self)
+{
+    h = KHashState(h, (const KValue*)self);
+
+    if (self->exists && !self->null)
+        h = KHashObjectPath(h, self->value);
+
+    return h;
+}
+
+CMPIBoolean KRef_Equal(const KRef* x, const KRef* y)
+{
+    if (!x->exists != !y->exists || !x->null != !y->null)
+        return 0;
+
+    if (!x->exists || x->null)
+        return 1;
+
+    if (x->value == y->value)
+        return 1;
+
+    return KMatch(x->value, y->value);
+}
+
 /*
 **==============================================================================
 **
@@ -1202,3 +1352,17 @@ CMPIData KFindProperty(
 
     return cd;
 }
+
+CMPIBoolean KRequested(const char** properties, const char* name)
+{
+    if (!properties)
+        return 1;
+
+    for (; *properties; properties++)
+    {
+        if (strcasecmp(*properties, name) == 0)
+            return 1;
+    }
+
+    return 0;
+}
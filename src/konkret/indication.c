@@ -0,0 +1,570 @@
+/*
+**==============================================================================
+**
+** Copyright (c) 2008, Michael E. Brasher
+** 
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+** 
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+** 
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+**==============================================================================
+*/
+
+#include "konkret.h"
+#include <pthread.h>
+#include <time.h>
+
+#define DEFAULT_MAX_DEPTH 1024
+#define DEFAULT_BATCH_SIZE 64
+
+typedef struct _Entry
+{
+    struct _Entry* next;
+    struct _Entry* chain;
+    CMPIInstance* ci;
+    char* key;
+    unsigned int hash;
+    CMPIUint64 due;
+}
+Entry;
+
+typedef struct _List
+{
+    Entry* head;
+    Entry* tail;
+}
+List;
+
+struct _KIndicationQueue
+{
+    const CMPIBroker* cb;
+    CMPIContext* cc;
+    char* ns;
+    KIndicationQueueOptions options;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t thread;
+    int running;
+
+    /* Pending indications without a key, in arrival order */
+    List ready;
+
+    /* Pending indications with a key, which wait out the coalescing window.
+       The window is the same for all of them, so arrival order is also the
+       order in which they fall due. */
+    List keyed;
+
+    /* Hash chains over pending indications that have a key */
+    Entry** chains;
+    size_t nchains;
+
+    /* Token bucket used for rate limiting */
+    double tokens;
+    CMPIUint64 refilled;
+
+    KIndicationQueueStats stats;
+};
+
+/* Current monotonic time in milliseconds */
+static CMPIUint64 _now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (CMPIUint64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static unsigned int _hash(const char* s)
+{
+    unsigned int h = 2166136261u;
+
+    while (*s)
+    {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
+    }
+
+    return h;
+}
+
+/* Forms a key from the values of the given properties */
+static char* _make_key(const CMPIInstance* ci, const char* const* names)
+{
+    char* buf = NULL;
+    size_t size = 0;
+    FILE* os;
+
+    if (!(os = open_memstream(&buf, &size)))
+        return NULL;
+
+    for (; *names; names++)
+    {
+        CMPIData cd = CMGetProperty(ci, *names, NULL);
+
+        fputc('|', os);
+
+        if (cd.state & CMPI_nullValue)
+            continue;
+
+        switch (cd.type)
+        {
+            case CMPI_boolean:
+                fprintf(os, "%d", cd.value.boolean);
+                break;
+            case CMPI_uint8:
+                fprintf(os, "%u", cd.value.uint8);
+                break;
+            case CMPI_sint8:
+                fprintf(os, "%d", cd.value.sint8);
+                break;
+            case CMPI_uint16:
+                fprintf(os, "%u", cd.value.uint16);
+                break;
+            case CMPI_sint16:
+                fprintf(os, "%d", cd.value.sint16);
+                break;
+            case CMPI_uint32:
+                fprintf(os, "%u", cd.value.uint32);
+                break;
+            case CMPI_sint32:
+                fprintf(os, "%d", cd.value.sint32);
+                break;
+            case CMPI_uint64:
+                fprintf(os, "%llu", cd.value.uint64);
+                break;
+            case CMPI_sint64:
+                fprintf(os, "%lld", cd.value.sint64);
+                break;
+            case CMPI_string:
+                fprintf(os, "%s", KChars(cd.value.string));
+                break;
+            default:
+                break;
+        }
+    }
+
+    fclose(os);
+    return buf;
+}
+
+static void _free_entry(Entry* entry)
+{
+    if (entry->ci)
+        CMRelease(entry->ci);
+
+    free(entry->key);
+    free(entry);
+}
+
+static Entry* _find(KIndicationQueue* self, const char* key, unsigned int hash)
+{
+    Entry* p;
+
+    for (p = self->chains[hash % self->nchains]; p; p = p->chain)
+    {
+        if (p->hash == hash && strcmp(p->key, key) == 0)
+            return p;
+    }
+
+    return NULL;
+}
+
+static void _unchain(KIndicationQueue* self, Entry* entry)
+{
+    Entry** p;
+
+    for (p = &self->chains[entry->hash % self->nchains]; *p; p = &(*p)->chain)
+    {
+        if (*p == entry)
+        {
+            *p = entry->chain;
+            return;
+        }
+    }
+}
+
+static void _append(List* list, Entry* entry)
+{
+    if (list->tail)
+        list->tail->next = entry;
+    else
+        list->head = entry;
+
+    list->tail = entry;
+}
+
+static Entry* _pop(List* list)
+{
+    Entry* entry = list->head;
+
+    if (!(list->head = entry->next))
+        list->tail = NULL;
+
+    entry->next = NULL;
+    return entry;
+}
+
+/* Returns the list whose head falls due first (NULL if both are empty) */
+static List* _next(KIndicationQueue* self)
+{
+    Entry* ready = self->ready.head;
+    Entry* keyed = self->keyed.head;
+
+    if (!keyed)
+        return ready ? &self->ready : NULL;
+
+    if (!ready || keyed->due < ready->due)
+        return &self->keyed;
+
+    return &self->ready;
+}
+
+/* Removes up to max due entries from the queue, earliest due first */
+static Entry* _take(KIndicationQueue* self, size_t* max, CMPIUint64 now)
+{
+    Entry* batch = NULL;
+    Entry** tail = &batch;
+    size_t n = 0;
+    List* list;
+
+    while (n < *max && (list = _next(self)) && list->head->due <= now)
+    {
+        Entry* entry = _pop(list);
+
+        if (entry->key)
+            _unchain(self, entry);
+
+        *tail = entry;
+        tail = &entry->next;
+        self->stats.depth--;
+        n++;
+    }
+
+    *max = n;
+    return batch;
+}
+
+/* Refills the token bucket and returns the number of whole tokens */
+static size_t _refill(KIndicationQueue* self, CMPIUint64 now)
+{
+    const KIndicationQueueOptions* o = &self->options;
+
+    if (!o->rateLimit)
+        return (size_t)-1;
+
+    self->tokens += (double)(now - self->refilled) * o->rateLimit / 1000.0;
+    self->refilled = now;
+
+    if (self->tokens > o->rateBurst)
+        self->tokens = o->rateBurst;
+
+    return (size_t)self->tokens;
+}
+
+static void _wait(KIndicationQueue* self, CMPIUint64 ms)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += ms / 1000;
+    ts.tv_nsec += (ms % 1000) * 1000000;
+
+    if (ts.tv_nsec >= 1000000000)
+    {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000;
+    }
+
+    pthread_cond_timedwait(&self->cond, &self->lock, &ts);
+}
+
+static void* _run(void* arg)
+{
+    KIndicationQueue* self = (KIndicationQueue*)arg;
+
+    CBAttachThread(self->cb, self->cc);
+    pthread_mutex_lock(&self->lock);
+
+    while (self->running)
+    {
+        CMPIUint64 now = _now();
+        size_t max = self->options.batchSize;
+        size_t tokens;
+        Entry* batch;
+        List* list;
+
+        if (!(list = _next(self)))
+        {
+            pthread_cond_wait(&self->cond, &self->lock);
+            continue;
+        }
+
+        /* Hold back entries still inside their coalescing window */
+
+        if (list->head->due > now)
+        {
+            _wait(self, list->head->due - now);
+            continue;
+        }
+
+        if ((tokens = _refill(self, now)) < max)
+            max = tokens;
+
+        if (max == 0)
+        {
+            _wait(self, 1000 / self->options.rateLimit + 1);
+            continue;
+        }
+
+        batch = _take(self, &max, now);
+
+        if (self->options.rateLimit)
+            self->tokens -= max;
+
+        /* Deliver the batch without holding the lock */
+
+        pthread_mutex_unlock(&self->lock);
+
+        while (batch)
+        {
+            Entry* next = batch->next;
+            CMPIStatus st;
+
+            st = CBDeliverIndication(self->cb, self->cc, self->ns, batch->ci);
+
+            pthread_mutex_lock(&self->lock);
+
+            if (KOkay(st))
+                self->stats.delivered++;
+            else
+                self->stats.failed++;
+
+            pthread_mutex_unlock(&self->lock);
+
+            _free_entry(batch);
+            batch = next;
+        }
+
+        pthread_mutex_lock(&self->lock);
+    }
+
+    pthread_mutex_unlock(&self->lock);
+    CBDetachThread(self->cb, self->cc);
+
+    return NULL;
+}
+
+KIndicationQueue* KIndicationQueue_New(
+    const CMPIBroker* cb,
+    const CMPIContext* cc,
+    const char* ns,
+    const KIndicationQueueOptions* options)
+{
+    KIndicationQueue* self;
+
+    if (!cb || !cc || !ns)
+        return NULL;
+
+    if (!(self = (KIndicationQueue*)calloc(1, sizeof(KIndicationQueue))))
+        return NULL;
+
+    self->cb = cb;
+
+    if (options)
+        self->options = *options;
+
+    if (!self->options.maxDepth)
+        self->options.maxDepth = DEFAULT_MAX_DEPTH;
+
+    if (!self->options.batchSize)
+        self->options.batchSize = DEFAULT_BATCH_SIZE;
+
+    if (self->options.rateLimit && !self->options.rateBurst)
+        self->options.rateBurst = self->options.rateLimit;
+
+    self->tokens = self->options.rateBurst;
+    self->refilled = _now();
+
+    self->nchains = self->options.maxDepth / 2 + 1;
+    self->chains = (Entry**)calloc(self->nchains, sizeof(Entry*));
+    self->ns = strdup(ns);
+
+    if (!self->chains || !self->ns)
+        goto failed;
+
+    /* The delivery thread runs outside of any request context */
+
+    if (!(self->cc = CBPrepareAttachThread(cb, cc)))
+        goto failed;
+
+    pthread_mutex_init(&self->lock, NULL);
+    pthread_cond_init(&self->cond, NULL);
+    self->running = 1;
+
+    if (pthread_create(&self->thread, NULL, _run, self) != 0)
+    {
+        pthread_cond_destroy(&self->cond);
+        pthread_mutex_destroy(&self->lock);
+        goto failed;
+    }
+
+    return self;
+
+failed:
+    free(self->chains);
+    free(self->ns);
+    free(self);
+    return NULL;
+}
+
+static void _free_list(List* list)
+{
+    Entry* p;
+
+    for (p = list->head; p; )
+    {
+        Entry* next = p->next;
+        _free_entry(p);
+        p = next;
+    }
+}
+
+void KIndicationQueue_Delete(KIndicationQueue* self)
+{
+    if (!self)
+        return;
+
+    pthread_mutex_lock(&self->lock);
+    self->running = 0;
+    pthread_cond_signal(&self->cond);
+    pthread_mutex_unlock(&self->lock);
+
+    pthread_join(self->thread, NULL);
+
+    /* Nobody is listening anymore, so discard whatever is still pending */
+
+    _free_list(&self->ready);
+    _free_list(&self->keyed);
+
+    pthread_cond_destroy(&self->cond);
+    pthread_mutex_destroy(&self->lock);
+    free(self->chains);
+    free(self->ns);
+    free(self);
+}
+
+CMPIStatus KIndicationQueue_Deliver(
+    KIndicationQueue* self,
+    const CMPIInstance* ci,
+    const char* key)
+{
+    CMPIStatus st = KSTATUS_INIT;
+    const KIndicationQueueOptions* o;
+    Entry* entry;
+    char* tmp = NULL;
+    unsigned int hash = 0;
+
+    if (!self || !ci)
+        KReturn(ERR_INVALID_PARAMETER);
+
+    o = &self->options;
+
+    if (o->coalesceWindow)
+    {
+        if (!key && o->keyProperties)
+            key = tmp = _make_key(ci, o->keyProperties);
+
+        if (key)
+            hash = _hash(key);
+    }
+    else
+        key = NULL;
+
+    pthread_mutex_lock(&self->lock);
+
+    /* Replace a pending indication with the same key by the newer one */
+
+    if (key && (entry = _find(self, key, hash)))
+    {
+        CMPIInstance* clone = CMClone(ci, &st);
+
+        if (clone)
+        {
+            CMRelease(entry->ci);
+            entry->ci = clone;
+            self->stats.coalesced++;
+        }
+
+        pthread_mutex_unlock(&self->lock);
+        free(tmp);
+        return st;
+    }
+
+    if (self->stats.depth >= o->maxDepth)
+    {
+        self->stats.dropped++;
+        pthread_mutex_unlock(&self->lock);
+        free(tmp);
+        KReturn(ERR_FAILED);
+    }
+
+    if (!(entry = (Entry*)calloc(1, sizeof(Entry))) ||
+        !(entry->ci = CMClone(ci, &st)))
+    {
+        self->stats.dropped++;
+        pthread_mutex_unlock(&self->lock);
+        free(entry);
+        free(tmp);
+
+        if (KOkay(st))
+            KReturn(ERR_FAILED);
+
+        return st;
+    }
+
+    entry->due = _now();
+
+    if (key && (entry->key = tmp ? tmp : strdup(key)))
+    {
+        entry->hash = hash;
+        entry->due += o->coalesceWindow;
+        entry->chain = self->chains[hash % self->nchains];
+        self->chains[hash % self->nchains] = entry;
+        tmp = NULL;
+        _append(&self->keyed, entry);
+    }
+    else
+        _append(&self->ready, entry);
+
+    self->stats.enqueued++;
+
+    if (++self->stats.depth > self->stats.peakDepth)
+        self->stats.peakDepth = self->stats.depth;
+
+    pthread_cond_signal(&self->cond);
+    pthread_mutex_unlock(&self->lock);
+
+    KReturn(OK);
+}
+
+void KIndicationQueue_GetStats(
+    KIndicationQueue* self,
+    KIndicationQueueStats* stats)
+{
+    pthread_mutex_lock(&self->lock);
+    *stats = self->stats;
+    pthread_mutex_unlock(&self->lock);
+}
@@ -35,12 +35,17 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdarg.h>
+#include <pthread.h>
 
 #include <cmpidt.h>
 #include <cmpift.h>
 #include <cmpimacs.h>
 #include <cmpios.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /*
 **==============================================================================
 **
@@ -156,6 +161,48 @@ KINLINE CMPIString* KNewString(const CMPIBroker* cb, const char* s)
     return (cb && s) ?  CMNewString(cb, s, NULL) : NULL;
 }
 
+/*
+**==============================================================================
+**
+** KArena
+**
+**     A per-thread bump allocator for request-scoped temporaries (formatted
+**     strings, scratch structures). Memory obtained from KArenaAlloc() and
+**     KArenaPrintf() lives until the outermost KArenaLeave() on the calling
+**     thread, or until KArenaRelease() rewinds past it. It is never freed
+**     individually.
+**
+**     The generated provider operations run inside KArenaEnter()/
+**     KArenaLeave() (see KArenaReturn()). Anything allocated outside such a
+**     scope is kept until the next scope on that thread ends.
+**
+**==============================================================================
+*/
+
+KEXTERN void* KArenaAlloc(size_t size);
+
+KEXTERN char* KArenaVPrintf(const char* format, va_list ap);
+
+KEXTERN char* KArenaPrintf(const char* format, ...)
+    __attribute__((format(printf, 1, 2)));
+
+KEXTERN size_t KArenaMark(void);
+
+KEXTERN void KArenaRelease(size_t mark);
+
+KEXTERN void KArenaEnter(void);
+
+KEXTERN void KArenaLeave(void);
+
+KINLINE CMPIStatus __KArenaReturn(CMPIStatus st)
+{
+    KArenaLeave();
+    return st;
+}
+
+/* Evaluates EXPR (a CMPIStatus) inside an arena scope and returns it */
+#define KArenaReturn(EXPR) return (KArenaEnter(), __KArenaReturn(EXPR))
+
 /*
 **==============================================================================
 **
@@ -201,6 +248,9 @@ KINLINE CMPIStatus __KReturn(CMPIrc RC)
 
 #define KReturn(CODE) return __KReturn(CMPI_RC_##CODE)
 
+/* The status KReturn(CODE) returns, e.g. for KArenaReturn(KStatus(OK)) */
+#define KStatus(CODE) __KReturn(CMPI_RC_##CODE)
+
 KINLINE void KPutStatus(CMPIStatus* st)
 {
     if (st)
@@ -215,13 +265,14 @@ KINLINE CMPIStatus __KReturn2(
     ...)
 {
     va_list args;
-    char* str = NULL;
+    size_t mark = KArenaMark();
+    char* str;
     va_start(args, format);
-    vasprintf(&str, format, args);
+    str = KArenaVPrintf(format, args);
     va_end(args);
     CMPIStatus stat={(rc),NULL};
     stat.msg=cb->eft->newString(cb, str, NULL);
-    free(str);
+    KArenaRelease(mark);
     return stat;
 }
 
@@ -1017,6 +1068,35 @@ KINLINE void KString_Clr(KString* self)
 
 #define KSTRING_INIT { 0, 0, NULL, {0}, NULL, {0} }
 
+/*
+**==============================================================================
+**
+** KStringPool
+**
+**     Interns strings into broker strings that live until the pool is
+**     cleared, so values repeated across many instances are created once.
+**
+**==============================================================================
+*/
+
+typedef struct _KStringPool
+{
+    pthread_rwlock_t lock;
+    struct _KStringPoolEntry** buckets;
+    size_t nbuckets;
+    size_t count;
+}
+KStringPool;
+
+#define KSTRINGPOOL_INIT { PTHREAD_RWLOCK_INITIALIZER, NULL, 0, 0 }
+
+KEXTERN CMPIString* KStringPool_Intern(
+    KStringPool* self, 
+    const CMPIBroker* cb, 
+    const char* s);
+
+KEXTERN void KStringPool_Clear(KStringPool* self);
+
 /*
 **==============================================================================
 **
@@ -1131,6 +1211,273 @@ KINLINE void KRef_Clr(KRef* self)
 
 #define KREF_INIT { 0, 0, NULL, {0}, NULL, {0} }
 
+/*
+**==============================================================================
+**
+** KHash
+**
+**     Hashing and equality of key values held in generated structures. These
+**     agree with KMatch(): nulls equal only nulls, strings compare exactly.
+**
+**==============================================================================
+*/
+
+#define KHASH_INIT 2166136261U
+
+KINLINE CMPIUint32 KHashBytes(CMPIUint32 h, const void* data, size_t size)
+{
+    const unsigned char* p = (const unsigned char*)data;
+
+    while (size--)
+    {
+        h ^= *p++;
+        h *= 16777619U;
+    }
+
+    return h;
+}
+
+KINLINE CMPIUint32 KHashState(CMPIUint32 h, const KValue* self)
+{
+    unsigned char state = (self->exists ? 1 : 0) | (self->null ? 2 : 0);
+    return KHashBytes(h, &state, 1);
+}
+
+KINLINE CMPIUint32 KHashValue(CMPIUint32 h, const KValue* self, size_t size)
+{
+    h = KHashState(h, self);
+
+    if (self->exists && !self->null)
+        h = KHashBytes(h, &self->u, size);
+
+    return h;
+}
+
+KINLINE CMPIBoolean KValue_Equal(
+    const KValue* x,
+    const KValue* y,
+    size_t size)
+{
+    if (!x->exists != !y->exists || !x->null != !y->null)
+        return 0;
+
+    if (!x->exists || x->null)
+        return 1;
+
+    return memcmp(&x->u, &y->u, size) == 0;
+}
+
+KINLINE const char* __KStringChars(const KString* self)
+{
+    return self->chars ? self->chars : KChars(self->value);
+}
+
+KINLINE CMPIUint32 KHashString(CMPIUint32 h, const KString* self)
+{
+    h = KHashState(h, (const KValue*)self);
+
+    if (self->exists && !self->null)
+    {
+        const char* s = __KStringChars(self);
+
+        if (s)
+            h = KHashBytes(h, s, strlen(s));
+    }
+
+    return h;
+}
+
+KINLINE CMPIBoolean KString_Equal(const KString* x, const KString* y)
+{
+    const char* s1;
+    const char* s2;
+
+    if (!x->exists != !y->exists || !x->null != !y->null)
+        return 0;
+
+    if (!x->exists || x->null)
+        return 1;
+
+    s1 = __KStringChars(x);
+    s2 = __KStringChars(y);
+
+    return s1 && s2 && strcmp(s1, s2) == 0;
+}
+
+KEXTERN CMPIUint32 KHashDateTime(CMPIUint32 h, const KDateTime* self);
+
+KEXTERN CMPIBoolean KDateTime_Equal(const KDateTime* x, const KDateTime* y);
+
+KEXTERN CMPIUint32 KHashRef(CMPIUint32 h, const KRef* self);
+
+KEXTERN CMPIBoolean KRef_Equal(const KRef* x, const KRef* y);
+
+KEXTERN CMPIUint32 KHashObjectPath(CMPIUint32 h, const CMPIObjectPath* cop);
+
+/*
+**==============================================================================
+**
+** KMAP_DEFINE
+**
+**     Defines an open-addressing hash map (linear probing, backward-shift
+**     deletion) named NAME from KEY to VALUE. Keys are copied into the table
+**     bytewise, so any strings or paths they point to must outlive the map
+**     (see KStringPool). The generator defines <ALIAS>RefMap_Define() for
+**     each class in terms of this macro.
+**
+**         NAME_Init(map)
+**         NAME_Destroy(map)
+**         NAME_Find(map, key) -- value or NULL
+**         NAME_Insert(map, key) -- new or existing value; NULL if out of memory
+**         NAME_Remove(map, key) -- nonzero if the key was present
+**
+**==============================================================================
+*/
+
+#define KMAP_DEFINE(NAME, KEY, VALUE, HASH, EQUAL) \
+    typedef struct _##NAME##Slot \
+    { \
+        KEY key; \
+        VALUE value; \
+        CMPIUint32 hash; \
+        CMPIUint32 used; \
+    } \
+    NAME##Slot; \
+    \
+    typedef struct _##NAME \
+    { \
+        NAME##Slot* slots; \
+        size_t size; \
+        size_t count; \
+    } \
+    NAME; \
+    \
+    KINLINE void NAME##_Init(NAME* self) \
+    { \
+        memset(self, 0, sizeof(*self)); \
+    } \
+    \
+    KINLINE void NAME##_Destroy(NAME* self) \
+    { \
+        free(self->slots); \
+        memset(self, 0, sizeof(*self)); \
+    } \
+    \
+    KINLINE NAME##Slot* NAME##_Lookup( \
+        const NAME* self, const KEY* key, CMPIUint32 hash) \
+    { \
+        size_t mask = self->size - 1; \
+        size_t i = hash & mask; \
+        \
+        while (self->slots[i].used) \
+        { \
+            if (self->slots[i].hash == hash && EQUAL(&self->slots[i].key, key)) \
+                return &self->slots[i]; \
+            \
+            i = (i + 1) & mask; \
+        } \
+        \
+        return &self->slots[i]; \
+    } \
+    \
+    KINLINE VALUE* NAME##_Find(const NAME* self, const KEY* key) \
+    { \
+        NAME##Slot* slot; \
+        \
+        if (!self->count) \
+            return NULL; \
+        \
+        slot = NAME##_Lookup(self, key, HASH(key)); \
+        return slot->used ? &slot->value : NULL; \
+    } \
+    \
+    KINLINE CMPIBoolean NAME##_Grow(NAME* self) \
+    { \
+        NAME tmp; \
+        size_t i; \
+        \
+        tmp.size = self->size ? self->size * 2 : 16; \
+        tmp.count = self->count; \
+        \
+        if (!(tmp.slots = (NAME##Slot*)calloc(tmp.size, sizeof(NAME##Slot)))) \
+            return 0; \
+        \
+        for (i = 0; i < self->size; i++) \
+        { \
+            if (self->slots[i].used) \
+            { \
+                memcpy(NAME##_Lookup(&tmp, &self->slots[i].key, \
+                    self->slots[i].hash), &self->slots[i], sizeof(NAME##Slot)); \
+            } \
+        } \
+        \
+        free(self->slots); \
+        *self = tmp; \
+        return 1; \
+    } \
+    \
+    KINLINE VALUE* NAME##_Insert(NAME* self, const KEY* key) \
+    { \
+        CMPIUint32 hash = HASH(key); \
+        NAME##Slot* slot; \
+        \
+        if (4 * (self->count + 1) > 3 * self->size && !NAME##_Grow(self)) \
+            return NULL; \
+        \
+        slot = NAME##_Lookup(self, key, hash); \
+        \
+        if (!slot->used) \
+        { \
+            memset(slot, 0, sizeof(*slot)); \
+            memcpy((void*)&slot->key, key, sizeof(KEY)); \
+            slot->hash = hash; \
+            slot->used = 1; \
+            self->count++; \
+        } \
+        \
+        return &slot->value; \
+    } \
+    \
+    KINLINE CMPIBoolean NAME##_Remove(NAME* self, const KEY* key) \
+    { \
+        size_t mask = self->size - 1; \
+        size_t i; \
+        size_t j; \
+        NAME##Slot* slot; \
+        \
+        if (!self->count) \
+            return 0; \
+        \
+        slot = NAME##_Lookup(self, key, HASH(key)); \
+        \
+        if (!slot->used) \
+            return 0; \
+        \
+        i = j = (size_t)(slot - self->slots); \
+        \
+        for (;;) \
+        { \
+            size_t k; \
+            \
+            j = (j + 1) & mask; \
+            \
+            if (!self->slots[j].used) \
+                break; \
+            \
+            k = self->slots[j].hash & mask; \
+            \
+            if (i <= j ? (k <= i || k > j) : (k <= i && k > j)) \
+            { \
+                memcpy(&self->slots[i], &self->slots[j], sizeof(NAME##Slot)); \
+                i = j; \
+            } \
+        } \
+        \
+        self->slots[i].used = 0; \
+        self->count--; \
+        return 1; \
+    }
+
 /*
 **==============================================================================
 **
@@ -2384,11 +2731,17 @@ KINLINE void KNext(KPos* self)
 **==============================================================================
 */
 
+KEXTERN CMPIBoolean __KQueryMatch(const CMPIResult* result, const KBase* base);
+
 KINLINE CMPIStatus __KReturnInstance(const CMPIResult* result, KBase* base)
 {
     CMPIStatus status;
     CMPIInstance* instance;
 
+    /* Skip instances that the query being executed does not select */
+    if (!__KQueryMatch(result, base))
+        KReturn(OK);
+
     if (!(instance = KBase_ToInstance(base, &status)))
         return status;
 
@@ -2537,6 +2890,59 @@ KEXTERN CMPIStatus KDefaultGetInstance(
     const CMPIObjectPath* cop,
     const char** properties);
 
+typedef CMPIStatus (*KEnumInstanceNamesProc)(
+    CMPIInstanceMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop);
+
+typedef CMPIStatus (*KEnumInstancesProc)(
+    CMPIInstanceMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop,
+    const char** properties);
+
+typedef CMPIStatus (*KGetInstanceProc)(
+    CMPIInstanceMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop,
+    const char** properties);
+
+/* Evaluates the query against the instances the provider enumerates (or
+   the one returned by lookup if the query fixes every key) */
+KEXTERN CMPIStatus KDefaultExecQuery(
+    const CMPIBroker* mb,
+    CMPIInstanceMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop,
+    const char* lang,
+    const char* query,
+    const unsigned char* sig,
+    KGetInstanceProc lookup);
+
+/* Run proc, unless an identical enumeration (same user, namespace, class,
+   operation and property list) is already in progress; in that case wait
+   for it and return its results instead */
+KEXTERN CMPIStatus KSingleFlightEnumInstances(
+    const CMPIBroker* cb,
+    CMPIInstanceMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop,
+    const char** properties,
+    KEnumInstancesProc proc);
+
+KEXTERN CMPIStatus KSingleFlightEnumInstanceNames(
+    const CMPIBroker* cb,
+    CMPIInstanceMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop,
+    KEnumInstanceNamesProc proc);
+
 KEXTERN CMPIStatus KDefaultAssociatorNames(
     const CMPIBroker* mb,
     CMPIAssociationMI* mi,
@@ -2593,6 +2999,288 @@ KEXTERN CMPIStatus KDefaultEnumerateInstancesOneToAll(
     const CMPIObjectPath* toCop,
     const char* toRole);
 
+/*
+**==============================================================================
+**
+** KAssocBuilder
+**
+**     Returns the instances (or, in names-only mode, the object paths) of an
+**     association between one fixed "from" object and many "to" objects. The
+**     path and instance are prepared once; each target only updates the "to"
+**     reference before the result is handed to the broker (which copies it).
+**
+**==============================================================================
+*/
+
+typedef struct _KAssocBuilder
+{
+    const CMPIBroker* cb;
+    const CMPIResult* cr;
+    CMPIObjectPath* cop;
+    CMPIInstance* ci;
+    const char* toRole;
+}
+KAssocBuilder;
+
+KEXTERN CMPIStatus KAssocBuilder_Init(
+    KAssocBuilder* self,
+    const CMPIBroker* cb,
+    const CMPIResult* cr,
+    const char* ns,
+    const char* assocClass,
+    const CMPIObjectPath* fromCop,
+    const char* fromRole,
+    const char* toRole,
+    CMPIBoolean namesOnly);
+
+KEXTERN CMPIStatus KAssocBuilder_Add(
+    KAssocBuilder* self,
+    const CMPIObjectPath* toCop);
+
+KEXTERN CMPIStatus KAssocBuilder_AddArray(
+    KAssocBuilder* self,
+    const CMPIObjectPath* const* toCops,
+    size_t count);
+
+/* Adds every object path that e yields */
+KEXTERN CMPIStatus KAssocBuilder_AddEnumeration(
+    KAssocBuilder* self,
+    CMPIEnumeration* e);
+
+/*
+**==============================================================================
+**
+** KAssoc
+**
+**     Describes an association class to the traversal functions below. The
+**     generator emits one per association from the hierarchy of its role
+**     classes, so that role, assocClass and resultClass filters mostly
+**     resolve without broker upcalls; CMClassPathIsA() is called only for
+**     other classes.
+**
+**==============================================================================
+*/
+
+typedef struct _KAssocRole
+{
+    /* Reference property name */
+    const char* name;
+
+    /* Declared class followed by its superclasses (null-terminated) */
+    const char* const* isa;
+
+    /* Known subclasses of the declared class (null-terminated) */
+    const char* const* subclasses;
+}
+KAssocRole;
+
+typedef struct _KAssoc
+{
+    /* Association class followed by its superclasses (null-terminated) */
+    const char* const* isa;
+
+    const KAssocRole* roles;
+    size_t numRoles;
+
+    /* The role classes and their superclasses (null-terminated) */
+    const char* const* classes;
+}
+KAssoc;
+
+KEXTERN CMPIStatus KAssociators(
+    const CMPIBroker* mb,
+    CMPIAssociationMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop,
+    const KAssoc* assoc,
+    const char* assocClass,
+    const char* resultClass,
+    const char* role,
+    const char* resultRole,
+    const char** properties);
+
+KEXTERN CMPIStatus KAssociatorNames(
+    const CMPIBroker* mb,
+    CMPIAssociationMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop,
+    const KAssoc* assoc,
+    const char* assocClass,
+    const char* resultClass,
+    const char* role,
+    const char* resultRole);
+
+KEXTERN CMPIStatus KReferences(
+    const CMPIBroker* mb,
+    CMPIAssociationMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop,
+    const KAssoc* assoc,
+    const char* assocClass,
+    const char* role,
+    const char** properties);
+
+KEXTERN CMPIStatus KReferenceNames(
+    const CMPIBroker* mb,
+    CMPIAssociationMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop,
+    const KAssoc* assoc,
+    const char* assocClass,
+    const char* role);
+
+/*
+**==============================================================================
+**
+** KIndicationQueue
+**
+**     Delivers indications asynchronously from a background thread so that
+**     the caller never blocks in CBDeliverIndication(). Indications with
+**     equal keys that arrive within the coalescing window are collapsed
+**     into the most recent one. Indications without a key are delivered
+**     right away, ahead of keyed ones still waiting out their window.
+**
+**==============================================================================
+*/
+
+typedef struct _KIndicationQueueOptions
+{
+    /* Maximum number of pending indications (default 1024) */
+    size_t maxDepth;
+
+    /* Maximum number of indications delivered per wakeup (default 64) */
+    size_t batchSize;
+
+    /* Milliseconds a keyed indication waits for newer duplicates (0=off) */
+    CMPIUint32 coalesceWindow;
+
+    /* Properties that form the key when KIndicationQueue_Deliver() is
+       given none (NULL-terminated) */
+    const char* const* keyProperties;
+
+    /* Maximum sustained deliveries per second (0=unlimited) */
+    CMPIUint32 rateLimit;
+
+    /* Deliveries allowed in a burst (defaults to rateLimit) */
+    CMPIUint32 rateBurst;
+}
+KIndicationQueueOptions;
+
+typedef struct _KIndicationQueueStats
+{
+    size_t depth;
+    size_t peakDepth;
+    CMPIUint64 enqueued;
+    CMPIUint64 delivered;
+    CMPIUint64 coalesced;
+    CMPIUint64 dropped;
+    CMPIUint64 failed;
+}
+KIndicationQueueStats;
+
+typedef struct _KIndicationQueue KIndicationQueue;
+
+KEXTERN KIndicationQueue* KIndicationQueue_New(
+    const CMPIBroker* cb,
+    const CMPIContext* cc,
+    const char* ns,
+    const KIndicationQueueOptions* options);
+
+KEXTERN void KIndicationQueue_Delete(KIndicationQueue* self);
+
+KEXTERN CMPIStatus KIndicationQueue_Deliver(
+    KIndicationQueue* self,
+    const CMPIInstance* ci,
+    const char* key);
+
+KEXTERN void KIndicationQueue_GetStats(
+    KIndicationQueue* self,
+    KIndicationQueueStats* stats);
+
+/*
+**==============================================================================
+**
+** KQuery
+**
+**     Parses simple WQL/CQL select statements and evaluates their WHERE
+**     clause against generated structures. KQuery_Bind() resolves the
+**     properties against a signature and returns true if every predicate
+**     can be evaluated exactly. Otherwise KQuery_Match() errs on the side
+**     of returning true.
+**
+**==============================================================================
+*/
+
+typedef struct _KQuery KQuery;
+
+KEXTERN KQuery* KQuery_New(const char* query, CMPIStatus* status);
+
+KEXTERN void KQuery_Delete(KQuery* self);
+
+KEXTERN const char* KQuery_ClassName(const KQuery* self);
+
+/* Returns the selected properties or NULL for all properties */
+KEXTERN const char** KQuery_Properties(const KQuery* self);
+
+/* Returns the properties to ask the provider for (the selected ones and those
+   the WHERE clause refers to) or NULL for all properties */
+KEXTERN const char** KQuery_RequestedProperties(const KQuery* self);
+
+KEXTERN CMPIBoolean KQuery_Bind(KQuery* self, const unsigned char* sig);
+
+KEXTERN CMPIBoolean KQuery_Match(const KQuery* self, const KBase* base);
+
+/* Like KQuery_Match() but returns -1 if the structure cannot tell (it is not
+   of the bound class or some predicate is not exact) */
+KEXTERN int KQuery_Decide(const KQuery* self, const KBase* base);
+
+KEXTERN CMPIBoolean KQuery_MatchInstance(
+    const KQuery* self, 
+    const CMPIBroker* cb,
+    const CMPIInstance* ci);
+
+/* Returns the object path fixed by key equalities in the WHERE clause, or
+   NULL if some key is not fixed */
+KEXTERN CMPIObjectPath* KQuery_KeyPath(
+    const KQuery* self,
+    const CMPIBroker* cb,
+    const char* ns,
+    const char* cn);
+
+/*
+**==============================================================================
+**
+** KFilters
+**
+**     The filters activated for an indication class. KFilters_Match() 
+**     returns false if no subscriber could possibly want the indication, 
+**     so it need not be converted to an instance at all.
+**
+**==============================================================================
+*/
+
+typedef struct _KFilters
+{
+    pthread_rwlock_t lock;
+    const unsigned char* sig;
+    struct _KFilter* filters;
+}
+KFilters;
+
+#define KFILTERS_INIT(SIG) { PTHREAD_RWLOCK_INITIALIZER, SIG, NULL }
+
+KEXTERN CMPIStatus KFilters_Activate(KFilters* self, const CMPISelectExp* se);
+
+KEXTERN CMPIStatus KFilters_Deactivate(KFilters* self, const CMPISelectExp* se);
+
+KEXTERN CMPIBoolean KFilters_Match(KFilters* self, const KBase* base);
+
+KEXTERN void KFilters_Clear(KFilters* self);
+
 /*
 **==============================================================================
 **
@@ -2626,6 +3314,9 @@ KEXTERN CMPIData KFindProperty(
     const char* name,
     CMPIStatus* status);
 
+/* True if name is in the property list (a null list requests them all) */
+KEXTERN CMPIBoolean KRequested(const char** properties, const char* name);
+
 /*
 **==============================================================================
 **
@@ -2638,6 +3329,314 @@ KEXTERN size_t KStrlcpy(char* dest, const char* src, size_t size);
 
 KEXTERN size_t KStrlcat(char* dest, const char* src, size_t size);
 
+/*
+**==============================================================================
+**
+** KLibrary
+**
+**     Serves the providers of several classes from one library under a single
+**     provider name. The broker creates one MI of each type for the library;
+**     the KLibrary functions dispatch each call to the MI of the class it is
+**     for, which is created on first use. The generator emits the class table
+**     (sorted by class name) and the KLibraryMIStub() in library mode (-L).
+**
+**==============================================================================
+*/
+
+typedef CMPIInstanceMI* (*KInstanceMIFactory)(
+    const CMPIBroker* mb,
+    const CMPIContext* cc,
+    CMPIStatus* st);
+
+typedef CMPIMethodMI* (*KMethodMIFactory)(
+    const CMPIBroker* mb,
+    const CMPIContext* cc,
+    CMPIStatus* st);
+
+typedef CMPIAssociationMI* (*KAssociationMIFactory)(
+    const CMPIBroker* mb,
+    const CMPIContext* cc,
+    CMPIStatus* st);
+
+typedef CMPIIndicationMI* (*KIndicationMIFactory)(
+    const CMPIBroker* mb,
+    const CMPIContext* cc,
+    CMPIStatus* st);
+
+typedef struct _KLibraryClass
+{
+    const char* className;
+
+    /* Entry points of the class's provider (null if not of that type) */
+    KInstanceMIFactory instance;
+    KMethodMIFactory method;
+    KAssociationMIFactory association;
+    KIndicationMIFactory indication;
+
+    /* Created on first use */
+    CMPIInstanceMI* instanceMI;
+    CMPIMethodMI* methodMI;
+    CMPIAssociationMI* associationMI;
+    CMPIIndicationMI* indicationMI;
+}
+KLibraryClass;
+
+#define KLIBRARYCLASS_INIT(CLASS, INSTANCE, METHOD, ASSOCIATION, INDICATION) \
+    { CLASS, INSTANCE, METHOD, ASSOCIATION, INDICATION, NULL, NULL, NULL, NULL }
+
+typedef struct _KLibrary
+{
+    pthread_mutex_t lock;
+    KLibraryClass* classes;
+    size_t numClasses;
+    const CMPIBroker* cb;
+
+    /* Number of the library's MIs not yet cleaned up */
+    size_t refs;
+
+    /* Shared by the classes; cleared when the last MI is cleaned up */
+    KStringPool* pool;
+}
+KLibrary;
+
+#define KLIBRARY_INIT(CLASSES, POOL) \
+    { \
+        PTHREAD_MUTEX_INITIALIZER, \
+        CLASSES, \
+        sizeof(CLASSES) / sizeof(CLASSES[0]), \
+        NULL, \
+        0, \
+        POOL \
+    }
+
+/* Records that the broker MB created an MI of library SELF (done by the
+   KLibraryMIStub() entry points) */
+KEXTERN void KLibraryAddRef(KLibrary* self, const CMPIBroker* mb);
+
+KEXTERN CMPIStatus KLibraryCleanup(
+    CMPIInstanceMI* mi,
+    const CMPIContext* cc,
+    CMPIBoolean term);
+
+KEXTERN CMPIStatus KLibraryEnumInstanceNames(
+    CMPIInstanceMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop);
+
+KEXTERN CMPIStatus KLibraryEnumInstances(
+    CMPIInstanceMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop,
+    const char** properties);
+
+KEXTERN CMPIStatus KLibraryGetInstance(
+    CMPIInstanceMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop,
+    const char** properties);
+
+KEXTERN CMPIStatus KLibraryCreateInstance(
+    CMPIInstanceMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop,
+    const CMPIInstance* ci);
+
+KEXTERN CMPIStatus KLibraryModifyInstance(
+    CMPIInstanceMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop,
+    const CMPIInstance* ci,
+    const char** properties);
+
+KEXTERN CMPIStatus KLibraryDeleteInstance(
+    CMPIInstanceMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop);
+
+KEXTERN CMPIStatus KLibraryExecQuery(
+    CMPIInstanceMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop,
+    const char* lang,
+    const char* query);
+
+KEXTERN CMPIStatus KLibraryMethodCleanup(
+    CMPIMethodMI* mi,
+    const CMPIContext* cc,
+    CMPIBoolean term);
+
+KEXTERN CMPIStatus KLibraryInvokeMethod(
+    CMPIMethodMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop,
+    const char* meth,
+    const CMPIArgs* in,
+    CMPIArgs* out);
+
+KEXTERN CMPIStatus KLibraryAssociationCleanup(
+    CMPIAssociationMI* mi,
+    const CMPIContext* cc,
+    CMPIBoolean term);
+
+KEXTERN CMPIStatus KLibraryAssociators(
+    CMPIAssociationMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop,
+    const char* assocClass,
+    const char* resultClass,
+    const char* role,
+    const char* resultRole,
+    const char** properties);
+
+KEXTERN CMPIStatus KLibraryAssociatorNames(
+    CMPIAssociationMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop,
+    const char* assocClass,
+    const char* resultClass,
+    const char* role,
+    const char* resultRole);
+
+KEXTERN CMPIStatus KLibraryReferences(
+    CMPIAssociationMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop,
+    const char* assocClass,
+    const char* role,
+    const char** properties);
+
+KEXTERN CMPIStatus KLibraryReferenceNames(
+    CMPIAssociationMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop,
+    const char* assocClass,
+    const char* role);
+
+KEXTERN CMPIStatus KLibraryIndicationCleanup(
+    CMPIIndicationMI* mi,
+    const CMPIContext* cc,
+    CMPIBoolean term);
+
+KEXTERN CMPIStatus KLibraryAuthorizeFilter(
+    CMPIIndicationMI* mi,
+    const CMPIContext* cc,
+    const CMPISelectExp* se,
+    const char* className,
+    const CMPIObjectPath* cop,
+    const char* owner);
+
+KEXTERN CMPIStatus KLibraryMustPoll(
+    CMPIIndicationMI* mi,
+    const CMPIContext* cc,
+    const CMPISelectExp* se,
+    const char* className,
+    const CMPIObjectPath* cop);
+
+KEXTERN CMPIStatus KLibraryActivateFilter(
+    CMPIIndicationMI* mi,
+    const CMPIContext* cc,
+    const CMPISelectExp* se,
+    const char* className,
+    const CMPIObjectPath* cop,
+    CMPIBoolean firstActivation);
+
+KEXTERN CMPIStatus KLibraryDeActivateFilter(
+    CMPIIndicationMI* mi,
+    const CMPIContext* cc,
+    const CMPISelectExp* se,
+    const char* className,
+    const CMPIObjectPath* cop,
+    CMPIBoolean lastActivation);
+
+KEXTERN CMPIStatus KLibraryEnableIndications(
+    CMPIIndicationMI* mi,
+    const CMPIContext* cc);
+
+KEXTERN CMPIStatus KLibraryDisableIndications(
+    CMPIIndicationMI* mi,
+    const CMPIContext* cc);
+
+/* Defines the broker entry points of library LIB (as CMInstanceMIStub() and
+   friends do for a single class), serving the classes of LIBRARY and
+   setting BROKER when the broker loads it */
+#define KLibraryMIStub(LIB, LIBRARY, BROKER) \
+    static CMPIInstanceMIFT _KLibraryInstanceMIFT = \
+    { \
+        CMPICurrentVersion, CMPICurrentVersion, "instance" #LIB, \
+        KLibraryCleanup, KLibraryEnumInstanceNames, KLibraryEnumInstances, \
+        KLibraryGetInstance, KLibraryCreateInstance, KLibraryModifyInstance, \
+        KLibraryDeleteInstance, KLibraryExecQuery \
+    }; \
+    \
+    static CMPIMethodMIFT _KLibraryMethodMIFT = \
+    { \
+        CMPICurrentVersion, CMPICurrentVersion, "method" #LIB, \
+        KLibraryMethodCleanup, KLibraryInvokeMethod \
+    }; \
+    \
+    static CMPIAssociationMIFT _KLibraryAssociationMIFT = \
+    { \
+        CMPICurrentVersion, CMPICurrentVersion, "association" #LIB, \
+        KLibraryAssociationCleanup, KLibraryAssociators, \
+        KLibraryAssociatorNames, KLibraryReferences, KLibraryReferenceNames \
+    }; \
+    \
+    static CMPIIndicationMIFT _KLibraryIndicationMIFT = \
+    { \
+        CMPICurrentVersion, CMPICurrentVersion, "indication" #LIB, \
+        KLibraryIndicationCleanup, KLibraryAuthorizeFilter, KLibraryMustPoll, \
+        KLibraryActivateFilter, KLibraryDeActivateFilter, \
+        KLibraryEnableIndications, KLibraryDisableIndications \
+    }; \
+    \
+    CMPI_EXTERN_C CMPIInstanceMI* LIB##_Create_InstanceMI( \
+        const CMPIBroker* mb, const CMPIContext* cc, CMPIStatus* st) \
+    { \
+        static CMPIInstanceMI mi = { &LIBRARY, &_KLibraryInstanceMIFT }; \
+        KLibraryAddRef(&LIBRARY, mb); \
+        BROKER = mb; \
+        return &mi; \
+    } \
+    \
+    CMPI_EXTERN_C CMPIMethodMI* LIB##_Create_MethodMI( \
+        const CMPIBroker* mb, const CMPIContext* cc, CMPIStatus* st) \
+    { \
+        static CMPIMethodMI mi = { &LIBRARY, &_KLibraryMethodMIFT }; \
+        KLibraryAddRef(&LIBRARY, mb); \
+        BROKER = mb; \
+        return &mi; \
+    } \
+    \
+    CMPI_EXTERN_C CMPIAssociationMI* LIB##_Create_AssociationMI( \
+        const CMPIBroker* mb, const CMPIContext* cc, CMPIStatus* st) \
+    { \
+        static CMPIAssociationMI mi = { &LIBRARY, &_KLibraryAssociationMIFT }; \
+        KLibraryAddRef(&LIBRARY, mb); \
+        BROKER = mb; \
+        return &mi; \
+    } \
+    \
+    CMPI_EXTERN_C CMPIIndicationMI* LIB##_Create_IndicationMI( \
+        const CMPIBroker* mb, const CMPIContext* cc, CMPIStatus* st) \
+    { \
+        static CMPIIndicationMI mi = { &LIBRARY, &_KLibraryIndicationMIFT }; \
+        KLibraryAddRef(&LIBRARY, mb); \
+        BROKER = mb; \
+        return &mi; \
+    }
+
 /*
 **==============================================================================
 **
@@ -2650,4 +3649,23 @@ KEXTERN size_t KStrlcat(char* dest, const char* src, size_t size);
     static volatile KUSED const char __konkret_registration[] = \
     "@(#)KONKRET_REGISTRATION=" NAMESPACE ":" CLASS ":" PROVIDERNAME ":" TYPES;
 
+/* Registers several classes at once (as a library does); the entries are
+   separated by ";" as in:
+
+       KONKRET_REGISTRATION_BLOCK(
+           KONKRET_REGISTRATION_ENTRY("root/cimv2", "A", "Lib", "instance")
+           ";"
+           KONKRET_REGISTRATION_ENTRY("root/cimv2", "B", "Lib", "instance"))
+*/
+#define KONKRET_REGISTRATION_ENTRY(NAMESPACE, CLASS, PROVIDERNAME, TYPES) \
+    NAMESPACE ":" CLASS ":" PROVIDERNAME ":" TYPES
+
+#define KONKRET_REGISTRATION_BLOCK(ENTRIES) \
+    static volatile KUSED const char __konkret_registration[] = \
+    "@(#)KONKRET_REGISTRATION=" ENTRIES;
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* _konkret_h */
@@ -0,0 +1,170 @@
+/*
+**==============================================================================
+**
+** Copyright (c) 2008, Michael E. Brasher
+** 
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+** 
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+** 
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+**==============================================================================
+*/
+
+#ifndef _konkret_hpp
+#define _konkret_hpp
+
+#include "konkret.h"
+#include <cstddef>
+#include <utility>
+
+/*
+**==============================================================================
+**
+** C++ support for the headers generated with konkret -x (requires C++11).
+**
+** The generated wrappers live in konkret::schema and carry the same names as
+** the C structures they wrap, so refer to them qualified (never with a
+** using-directive).
+**
+**==============================================================================
+*/
+
+namespace konkret
+{
+
+/*
+**==============================================================================
+**
+** Field
+**
+**     Describes one field of a generated structure at compile time.
+**
+**==============================================================================
+*/
+
+struct Field
+{
+    const char* name;
+    size_t offset;
+    KTag tag;
+
+    constexpr KTag Type() const
+    {
+        return tag & 0x0F;
+    }
+
+    constexpr bool IsArray() const
+    {
+        return (tag & KTAG_ARRAY) != 0;
+    }
+
+    constexpr bool IsKey() const
+    {
+        return (tag & KTAG_KEY) != 0;
+    }
+};
+
+/*
+**==============================================================================
+**
+** Handle
+**
+**     Move-only owner of a CMPI encapsulated object (CMPIInstance,
+**     CMPIObjectPath, ...), which is released when the handle goes away.
+**
+**==============================================================================
+*/
+
+template<class T>
+class Handle
+{
+public:
+
+    Handle() noexcept : _ptr(nullptr)
+    {
+    }
+
+    explicit Handle(T* ptr) noexcept : _ptr(ptr)
+    {
+    }
+
+    Handle(Handle&& x) noexcept : _ptr(x._ptr)
+    {
+        x._ptr = nullptr;
+    }
+
+    Handle(const Handle&) = delete;
+
+    ~Handle()
+    {
+        reset();
+    }
+
+    Handle& operator=(Handle&& x) noexcept
+    {
+        if (this != &x)
+            reset(x.release());
+
+        return *this;
+    }
+
+    Handle& operator=(const Handle&) = delete;
+
+    T* get() const noexcept
+    {
+        return _ptr;
+    }
+
+    T* operator->() const noexcept
+    {
+        return _ptr;
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return _ptr != nullptr;
+    }
+
+    /* Gives up ownership without releasing */
+    T* release() noexcept
+    {
+        T* ptr = _ptr;
+        _ptr = nullptr;
+        return ptr;
+    }
+
+    void reset(T* ptr = nullptr) noexcept
+    {
+        if (_ptr)
+            _ptr->ft->release(_ptr);
+
+        _ptr = ptr;
+    }
+
+private:
+    T* _ptr;
+};
+
+template<class T>
+inline Handle<T> Clone(const T* x, CMPIStatus* status = nullptr)
+{
+    return Handle<T>(x ? x->ft->clone(x, status) : nullptr);
+}
+
+}
+
+#endif /* _konkret_hpp */
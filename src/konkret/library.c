@@ -0,0 +1,525 @@
+/*
+**==============================================================================
+**
+** Copyright (c) 2008, Michael E. Brasher
+** 
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+** 
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+** 
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+**==============================================================================
+*/
+
+#include "konkret.h"
+#include <strings.h>
+
+static int _compare(const void* key, const void* elem)
+{
+    return strcasecmp((const char*)key, ((const KLibraryClass*)elem)->className);
+}
+
+static KLibraryClass* _find(KLibrary* self, const char* cn)
+{
+    if (!cn)
+        return NULL;
+
+    return (KLibraryClass*)bsearch(cn, self->classes, self->numClasses, 
+        sizeof(KLibraryClass), _compare);
+}
+
+/* The MIs of a class are created on first use under the library lock. Calls
+   to a class run inside an arena scope (see KArenaEnter()), so the scratch
+   memory of a request is recycled even if the provider never asks for it. */
+
+#define _DEFINE_GET(TYPE, NAME) \
+    static CMPI##TYPE##MI* _get_##NAME( \
+        KLibrary* self, \
+        KLibraryClass* lc, \
+        const CMPIContext* cc) \
+    { \
+        CMPI##TYPE##MI* mi; \
+        \
+        if (!lc || !lc->NAME) \
+            return NULL; \
+        \
+        pthread_mutex_lock(&self->lock); \
+        \
+        if (!lc->NAME##MI) \
+        { \
+            CMPIStatus st = KSTATUS_INIT; \
+            lc->NAME##MI = lc->NAME(self->cb, cc, &st); \
+        } \
+        \
+        mi = lc->NAME##MI; \
+        pthread_mutex_unlock(&self->lock); \
+        return mi; \
+    }
+
+_DEFINE_GET(Instance, instance)
+_DEFINE_GET(Method, method)
+_DEFINE_GET(Association, association)
+_DEFINE_GET(Indication, indication)
+
+/* The library's MIs of each type are cleaned up by cleaning up the MIs of
+   its classes, which are taken (and forgotten, once their cleanup succeeds)
+   under the library lock. The string pool shared by the classes is cleared
+   only when the last of the library's MIs has gone. */
+
+static void _release(KLibrary* self)
+{
+    pthread_mutex_lock(&self->lock);
+
+    if (self->refs && --self->refs == 0 && self->pool)
+        KStringPool_Clear(self->pool);
+
+    pthread_mutex_unlock(&self->lock);
+}
+
+#define _DEFINE_CLEANUP(TYPE, NAME) \
+    static CMPIStatus _cleanup_##NAME( \
+        KLibrary* self, \
+        const CMPIContext* cc, \
+        CMPIBoolean term) \
+    { \
+        CMPIStatus result = KSTATUS_INIT; \
+        size_t i; \
+        \
+        for (i = 0; i < self->numClasses; i++) \
+        { \
+            KLibraryClass* lc = &self->classes[i]; \
+            CMPI##TYPE##MI* cmi; \
+            CMPIStatus st; \
+            \
+            pthread_mutex_lock(&self->lock); \
+            cmi = lc->NAME##MI; \
+            pthread_mutex_unlock(&self->lock); \
+            \
+            if (!cmi) \
+                continue; \
+            \
+            st = cmi->ft->cleanup(cmi, cc, term); \
+            \
+            if (KOkay(st)) \
+            { \
+                pthread_mutex_lock(&self->lock); \
+                \
+                if (lc->NAME##MI == cmi) \
+                    lc->NAME##MI = NULL; \
+                \
+                pthread_mutex_unlock(&self->lock); \
+            } \
+            else if (KOkay(result)) \
+                result = st; \
+        } \
+        \
+        if (KOkay(result)) \
+            _release(self); \
+        \
+        return result; \
+    }
+
+_DEFINE_CLEANUP(Instance, instance)
+_DEFINE_CLEANUP(Method, method)
+_DEFINE_CLEANUP(Association, association)
+_DEFINE_CLEANUP(Indication, indication)
+
+void KLibraryAddRef(KLibrary* self, const CMPIBroker* mb)
+{
+    pthread_mutex_lock(&self->lock);
+    self->cb = mb;
+    self->refs++;
+    pthread_mutex_unlock(&self->lock);
+}
+
+static CMPIStatus _no_class(const char* cn)
+{
+    CMPIStatus st;
+    st.rc = cn ? CMPI_RC_ERR_INVALID_CLASS : CMPI_RC_ERR_FAILED;
+    st.msg = NULL;
+    return st;
+}
+
+/*
+**==============================================================================
+**
+** Instance provider
+**
+**==============================================================================
+*/
+
+#define _INSTANCE(MI, CC, COP) \
+    KLibrary* self = (KLibrary*)MI->hdl; \
+    const char* cn = KClassName(COP); \
+    CMPIInstanceMI* cmi = _get_instance(self, _find(self, cn), CC); \
+    \
+    if (!cmi) \
+        return _no_class(cn);
+
+CMPIStatus KLibraryCleanup(
+    CMPIInstanceMI* mi,
+    const CMPIContext* cc,
+    CMPIBoolean term)
+{
+    return _cleanup_instance((KLibrary*)mi->hdl, cc, term);
+}
+
+CMPIStatus KLibraryEnumInstanceNames(
+    CMPIInstanceMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop)
+{
+    _INSTANCE(mi, cc, cop);
+    KArenaReturn(cmi->ft->enumerateInstanceNames(cmi, cc, cr, cop));
+}
+
+CMPIStatus KLibraryEnumInstances(
+    CMPIInstanceMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop,
+    const char** properties)
+{
+    _INSTANCE(mi, cc, cop);
+    KArenaReturn(cmi->ft->enumerateInstances(cmi, cc, cr, cop, properties));
+}
+
+CMPIStatus KLibraryGetInstance(
+    CMPIInstanceMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop,
+    const char** properties)
+{
+    _INSTANCE(mi, cc, cop);
+    KArenaReturn(cmi->ft->getInstance(cmi, cc, cr, cop, properties));
+}
+
+CMPIStatus KLibraryCreateInstance(
+    CMPIInstanceMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop,
+    const CMPIInstance* ci)
+{
+    _INSTANCE(mi, cc, cop);
+    KArenaReturn(cmi->ft->createInstance(cmi, cc, cr, cop, ci));
+}
+
+CMPIStatus KLibraryModifyInstance(
+    CMPIInstanceMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop,
+    const CMPIInstance* ci,
+    const char** properties)
+{
+    _INSTANCE(mi, cc, cop);
+    KArenaReturn(cmi->ft->modifyInstance(cmi, cc, cr, cop, ci, properties));
+}
+
+CMPIStatus KLibraryDeleteInstance(
+    CMPIInstanceMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop)
+{
+    _INSTANCE(mi, cc, cop);
+    KArenaReturn(cmi->ft->deleteInstance(cmi, cc, cr, cop));
+}
+
+CMPIStatus KLibraryExecQuery(
+    CMPIInstanceMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop,
+    const char* lang,
+    const char* query)
+{
+    _INSTANCE(mi, cc, cop);
+    KArenaReturn(cmi->ft->execQuery(cmi, cc, cr, cop, lang, query));
+}
+
+/*
+**==============================================================================
+**
+** Method provider
+**
+**==============================================================================
+*/
+
+CMPIStatus KLibraryMethodCleanup(
+    CMPIMethodMI* mi,
+    const CMPIContext* cc,
+    CMPIBoolean term)
+{
+    return _cleanup_method((KLibrary*)mi->hdl, cc, term);
+}
+
+CMPIStatus KLibraryInvokeMethod(
+    CMPIMethodMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop,
+    const char* meth,
+    const CMPIArgs* in,
+    CMPIArgs* out)
+{
+    KLibrary* self = (KLibrary*)mi->hdl;
+    const char* cn = KClassName(cop);
+    CMPIMethodMI* cmi = _get_method(self, _find(self, cn), cc);
+
+    if (!cmi)
+        return _no_class(cn);
+
+    KArenaReturn(cmi->ft->invokeMethod(cmi, cc, cr, cop, meth, in, out));
+}
+
+/*
+**==============================================================================
+**
+** Association provider
+**
+**     The object path names the source object rather than the association,
+**     so calls go to the association named by assocClass if the library has
+**     it, or else to every association in the library, each of which applies
+**     the assocClass filter itself.
+**
+**==============================================================================
+*/
+
+#define _FOREACH_ASSOCIATION(MI, CC, ASSOC_CLASS, CALL) \
+    KLibrary* self = (KLibrary*)MI->hdl; \
+    KLibraryClass* lc = _find(self, ASSOC_CLASS); \
+    CMPIStatus result = KSTATUS_INIT; \
+    size_t i; \
+    \
+    if (lc && lc->association) \
+    { \
+        CMPIAssociationMI* cmi = _get_association(self, lc, CC); \
+        \
+        if (!cmi) \
+            KReturn(ERR_FAILED); \
+        \
+        return CALL; \
+    } \
+    \
+    for (i = 0; i < self->numClasses && KOkay(result); i++) \
+    { \
+        CMPIAssociationMI* cmi; \
+        \
+        if (!self->classes[i].association) \
+            continue; \
+        \
+        if (!(cmi = _get_association(self, &self->classes[i], CC))) \
+            KReturn(ERR_FAILED); \
+        \
+        result = CALL; \
+    } \
+    \
+    return result;
+
+CMPIStatus KLibraryAssociationCleanup(
+    CMPIAssociationMI* mi,
+    const CMPIContext* cc,
+    CMPIBoolean term)
+{
+    return _cleanup_association((KLibrary*)mi->hdl, cc, term);
+}
+
+CMPIStatus KLibraryAssociators(
+    CMPIAssociationMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop,
+    const char* assocClass,
+    const char* resultClass,
+    const char* role,
+    const char* resultRole,
+    const char** properties)
+{
+    _FOREACH_ASSOCIATION(mi, cc, assocClass, 
+        cmi->ft->associators(cmi, cc, cr, cop, assocClass, resultClass, role,
+            resultRole, properties));
+}
+
+CMPIStatus KLibraryAssociatorNames(
+    CMPIAssociationMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop,
+    const char* assocClass,
+    const char* resultClass,
+    const char* role,
+    const char* resultRole)
+{
+    _FOREACH_ASSOCIATION(mi, cc, assocClass, 
+        cmi->ft->associatorNames(cmi, cc, cr, cop, assocClass, resultClass, 
+            role, resultRole));
+}
+
+CMPIStatus KLibraryReferences(
+    CMPIAssociationMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop,
+    const char* assocClass,
+    const char* role,
+    const char** properties)
+{
+    _FOREACH_ASSOCIATION(mi, cc, assocClass, 
+        cmi->ft->references(cmi, cc, cr, cop, assocClass, role, properties));
+}
+
+CMPIStatus KLibraryReferenceNames(
+    CMPIAssociationMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop,
+    const char* assocClass,
+    const char* role)
+{
+    _FOREACH_ASSOCIATION(mi, cc, assocClass, 
+        cmi->ft->referenceNames(cmi, cc, cr, cop, assocClass, role));
+}
+
+/*
+**==============================================================================
+**
+** Indication provider
+**
+**==============================================================================
+*/
+
+#define _INDICATION(MI, CC, CLASS_NAME) \
+    KLibrary* self = (KLibrary*)MI->hdl; \
+    CMPIIndicationMI* cmi = \
+        _get_indication(self, _find(self, CLASS_NAME), CC); \
+    \
+    if (!cmi) \
+        return _no_class(CLASS_NAME);
+
+CMPIStatus KLibraryIndicationCleanup(
+    CMPIIndicationMI* mi,
+    const CMPIContext* cc,
+    CMPIBoolean term)
+{
+    return _cleanup_indication((KLibrary*)mi->hdl, cc, term);
+}
+
+CMPIStatus KLibraryAuthorizeFilter(
+    CMPIIndicationMI* mi,
+    const CMPIContext* cc,
+    const CMPISelectExp* se,
+    const char* className,
+    const CMPIObjectPath* cop,
+    const char* owner)
+{
+    _INDICATION(mi, cc, className);
+    KArenaReturn(cmi->ft->authorizeFilter(cmi, cc, se, className, cop, owner));
+}
+
+CMPIStatus KLibraryMustPoll(
+    CMPIIndicationMI* mi,
+    const CMPIContext* cc,
+    const CMPISelectExp* se,
+    const char* className,
+    const CMPIObjectPath* cop)
+{
+    _INDICATION(mi, cc, className);
+    KArenaReturn(cmi->ft->mustPoll(cmi, cc, se, className, cop));
+}
+
+CMPIStatus KLibraryActivateFilter(
+    CMPIIndicationMI* mi,
+    const CMPIContext* cc,
+    const CMPISelectExp* se,
+    const char* className,
+    const CMPIObjectPath* cop,
+    CMPIBoolean firstActivation)
+{
+    _INDICATION(mi, cc, className);
+    KArenaReturn(cmi->ft->activateFilter(cmi, cc, se, className, cop, 
+        firstActivation));
+}
+
+CMPIStatus KLibraryDeActivateFilter(
+    CMPIIndicationMI* mi,
+    const CMPIContext* cc,
+    const CMPISelectExp* se,
+    const char* className,
+    const CMPIObjectPath* cop,
+    CMPIBoolean lastActivation)
+{
+    _INDICATION(mi, cc, className);
+    KArenaReturn(cmi->ft->deActivateFilter(cmi, cc, se, className, cop, 
+        lastActivation));
+}
+
+/* Enabling and disabling apply to every indication class in the library */
+
+CMPIStatus KLibraryEnableIndications(
+    CMPIIndicationMI* mi,
+    const CMPIContext* cc)
+{
+    KLibrary* self = (KLibrary*)mi->hdl;
+    CMPIStatus result = KSTATUS_INIT;
+    size_t i;
+
+    for (i = 0; i < self->numClasses; i++)
+    {
+        CMPIIndicationMI* cmi = _get_indication(self, &self->classes[i], cc);
+
+        if (cmi)
+        {
+            CMPIStatus st = cmi->ft->enableIndications(cmi, cc);
+
+            if (KOkay(result))
+                result = st;
+        }
+    }
+
+    return result;
+}
+
+CMPIStatus KLibraryDisableIndications(
+    CMPIIndicationMI* mi,
+    const CMPIContext* cc)
+{
+    KLibrary* self = (KLibrary*)mi->hdl;
+    CMPIStatus result = KSTATUS_INIT;
+    size_t i;
+
+    for (i = 0; i < self->numClasses; i++)
+    {
+        CMPIIndicationMI* cmi;
+
+        pthread_mutex_lock(&self->lock);
+        cmi = self->classes[i].indicationMI;
+        pthread_mutex_unlock(&self->lock);
+
+        if (cmi)
+        {
+            CMPIStatus st = cmi->ft->disableIndications(cmi, cc);
+
+            if (KOkay(result))
+                result = st;
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,1513 @@
+/*
+**==============================================================================
+**
+** Copyright (c) 2008, Michael E. Brasher
+** 
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+** 
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+** 
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+**==============================================================================
+*/
+
+#include "konkret.h"
+#include <ctype.h>
+#include <errno.h>
+#include <strings.h>
+
+/*
+**==============================================================================
+**
+** Queries are evaluated with SQL three-valued logic. Some predicates cannot
+** be decided here (unsupported types, unknown properties, LIKE, ISA), so
+** every node evaluates to the set of outcomes it might have. An object is
+** selected if TRUE is among them.
+**
+**==============================================================================
+*/
+
+#define R_TRUE 1
+#define R_FALSE 2
+#define R_UNKNOWN 4
+#define R_ANY (R_TRUE | R_FALSE | R_UNKNOWN)
+
+typedef enum _ValueType
+{
+    V_NONE, /* cannot be evaluated here */
+    V_ABSENT, /* property was never set */
+    V_NULL,
+    V_BOOLEAN,
+    V_SINT,
+    V_UINT,
+    V_REAL,
+    V_STRING
+}
+ValueType;
+
+typedef struct _Value
+{
+    ValueType type;
+    union
+    {
+        CMPIBoolean boolean;
+        CMPISint64 sint;
+        CMPIUint64 uint;
+        CMPIReal64 real;
+        const char* string;
+    }
+    u;
+}
+Value;
+
+typedef struct _Operand
+{
+    /* Property name or NULL for literals */
+    const char* name;
+    Value literal;
+
+    /* Bound field offset (negative if the class has no such property) */
+    long offset;
+    KTag tag;
+}
+Operand;
+
+typedef enum _NodeType
+{
+    N_AND,
+    N_OR,
+    N_NOT,
+    N_EQ,
+    N_NE,
+    N_LT,
+    N_LE,
+    N_GT,
+    N_GE,
+    N_IS_NULL,
+    N_IS_NOT_NULL,
+    N_OPAQUE
+}
+NodeType;
+
+typedef struct _Node
+{
+    NodeType type;
+    struct _Node* left;
+    struct _Node* right;
+    Operand lhs;
+    Operand rhs;
+}
+Node;
+
+struct _KQuery
+{
+    /* Token storage; names and string literals point into it */
+    char* strings;
+    const char* className;
+    const char** properties;
+    /* The selected properties plus those the WHERE clause refers to */
+    const char** requested;
+    Node* where;
+    const unsigned char* sig;
+    CMPIBoolean exact;
+};
+
+/*
+**==============================================================================
+**
+** Lexer
+**
+**==============================================================================
+*/
+
+typedef enum _TokenType
+{
+    T_END,
+    T_ERROR,
+    T_IDENT,
+    T_STRING,
+    T_NUMBER,
+    T_STAR,
+    T_COMMA,
+    T_OPEN,
+    T_CLOSE,
+    T_EQ,
+    T_NE,
+    T_LT,
+    T_LE,
+    T_GT,
+    T_GE
+}
+TokenType;
+
+typedef struct _Parser
+{
+    const char* pos;
+    TokenType type;
+    const char* token;
+
+    /* Where the next token is copied to */
+    char* out;
+}
+Parser;
+
+static void _lex(Parser* p)
+{
+    const char* s = p->pos;
+    char c;
+
+    while (isspace((unsigned char)*s))
+        s++;
+
+    p->token = p->out;
+
+    if (!(c = *s))
+    {
+        p->type = T_END;
+        p->pos = s;
+        *p->out = '\0';
+        return;
+    }
+
+    if (isalpha((unsigned char)c) || c == '_')
+    {
+        while (isalnum((unsigned char)*s) || *s == '_' || *s == '.')
+            *p->out++ = *s++;
+
+        p->type = T_IDENT;
+    }
+    else if (isdigit((unsigned char)c) || ((c == '-' || c == '+') && 
+        (isdigit((unsigned char)s[1]) || s[1] == '.')) || c == '.')
+    {
+        *p->out++ = *s++;
+
+        while (isalnum((unsigned char)*s) || *s == '.' ||
+            ((*s == '-' || *s == '+') && (s[-1] == 'e' || s[-1] == 'E')))
+            *p->out++ = *s++;
+
+        p->type = T_NUMBER;
+    }
+    else if (c == '\'' || c == '"')
+    {
+        /* A doubled quote stands for the quote itself */
+
+        for (s++; ; )
+        {
+            if (!*s)
+            {
+                p->type = T_ERROR;
+                return;
+            }
+
+            if (*s == c && *++s != c)
+                break;
+
+            *p->out++ = *s++;
+        }
+
+        p->type = T_STRING;
+    }
+    else
+    {
+        s++;
+
+        switch (c)
+        {
+            case '*':
+                p->type = T_STAR;
+                break;
+            case ',':
+                p->type = T_COMMA;
+                break;
+            case '(':
+                p->type = T_OPEN;
+                break;
+            case ')':
+                p->type = T_CLOSE;
+                break;
+            case '=':
+                p->type = T_EQ;
+                break;
+            case '!':
+                p->type = *s == '=' ? (s++, T_NE) : T_ERROR;
+                break;
+            case '<':
+                if (*s == '=')
+                    p->type = (s++, T_LE);
+                else if (*s == '>')
+                    p->type = (s++, T_NE);
+                else
+                    p->type = T_LT;
+                break;
+            case '>':
+                p->type = *s == '=' ? (s++, T_GE) : T_GT;
+                break;
+            default:
+                p->type = T_ERROR;
+                break;
+        }
+    }
+
+    *p->out++ = '\0';
+    p->pos = s;
+}
+
+static int _keyword(const Parser* p, const char* keyword)
+{
+    return p->type == T_IDENT && strcasecmp(p->token, keyword) == 0;
+}
+
+/*
+**==============================================================================
+**
+** Parser
+**
+**     query   := SELECT ('*' | ident (',' ident)*) FROM ident [WHERE or]
+**     or      := and (OR and)*
+**     and     := not (AND not)*
+**     not     := NOT not | primary
+**     primary := '(' or ')' | operand IS [NOT] NULL | operand ISA ident
+**              | operand [NOT] LIKE operand | operand relop operand
+**     operand := ident | string | number | TRUE | FALSE | NULL
+**
+**==============================================================================
+*/
+
+static void _free_node(Node* node)
+{
+    if (node)
+    {
+        _free_node(node->left);
+        _free_node(node->right);
+        free(node);
+    }
+}
+
+static Node* _new_node(NodeType type, Node* left, Node* right)
+{
+    Node* node;
+
+    if (!(node = (Node*)calloc(1, sizeof(Node))))
+    {
+        _free_node(left);
+        _free_node(right);
+        return NULL;
+    }
+
+    node->type = type;
+    node->left = left;
+    node->right = right;
+    return node;
+}
+
+static int _parse_number(const char* s, Value* v)
+{
+    char* end;
+
+    errno = 0;
+
+    if (strpbrk(s, ".eE") && strncasecmp(s, "0x", 2) != 0)
+    {
+        v->type = V_REAL;
+        v->u.real = strtod(s, &end);
+    }
+    else if (*s == '-')
+    {
+        v->type = V_SINT;
+        v->u.sint = strtoll(s, &end, 0);
+    }
+    else
+    {
+        v->type = V_UINT;
+        v->u.uint = strtoull(s, &end, 0);
+    }
+
+    return *end == '\0' && errno == 0;
+}
+
+static int _parse_operand(Parser* p, Operand* x)
+{
+    memset(x, 0, sizeof(*x));
+    x->offset = -1;
+
+    switch (p->type)
+    {
+        case T_IDENT:
+        {
+            if (_keyword(p, "TRUE") || _keyword(p, "FALSE"))
+            {
+                x->literal.type = V_BOOLEAN;
+                x->literal.u.boolean = _keyword(p, "TRUE");
+            }
+            else if (_keyword(p, "NULL"))
+                x->literal.type = V_NULL;
+            else
+                x->name = p->token;
+            break;
+        }
+        case T_STRING:
+            x->literal.type = V_STRING;
+            x->literal.u.string = p->token;
+            break;
+        case T_NUMBER:
+            if (!_parse_number(p->token, &x->literal))
+                return -1;
+            break;
+        default:
+            return -1;
+    }
+
+    _lex(p);
+    return 0;
+}
+
+static Node* _parse_or(Parser* p);
+
+static Node* _parse_primary(Parser* p)
+{
+    Node* node;
+    NodeType type;
+
+    if (p->type == T_OPEN)
+    {
+        _lex(p);
+
+        if (!(node = _parse_or(p)))
+            return NULL;
+
+        if (p->type != T_CLOSE)
+        {
+            _free_node(node);
+            return NULL;
+        }
+
+        _lex(p);
+        return node;
+    }
+
+    if (!(node = _new_node(N_OPAQUE, NULL, NULL)))
+        return NULL;
+
+    if (_parse_operand(p, &node->lhs) != 0)
+        goto failed;
+
+    if (_keyword(p, "IS"))
+    {
+        _lex(p);
+        node->type = N_IS_NULL;
+
+        if (_keyword(p, "NOT"))
+        {
+            _lex(p);
+            node->type = N_IS_NOT_NULL;
+        }
+
+        if (!_keyword(p, "NULL"))
+            goto failed;
+
+        _lex(p);
+        return node;
+    }
+
+    if (_keyword(p, "ISA"))
+    {
+        _lex(p);
+
+        if (p->type != T_IDENT)
+            goto failed;
+
+        _lex(p);
+        return node;
+    }
+
+    if (_keyword(p, "NOT"))
+    {
+        _lex(p);
+
+        if (!_keyword(p, "LIKE"))
+            goto failed;
+    }
+
+    if (_keyword(p, "LIKE"))
+    {
+        _lex(p);
+
+        if (_parse_operand(p, &node->rhs) != 0)
+            goto failed;
+
+        return node;
+    }
+
+    switch (p->type)
+    {
+        case T_EQ:
+            type = N_EQ;
+            break;
+        case T_NE:
+            type = N_NE;
+            break;
+        case T_LT:
+            type = N_LT;
+            break;
+        case T_LE:
+            type = N_LE;
+            break;
+        case T_GT:
+            type = N_GT;
+            break;
+        case T_GE:
+            type = N_GE;
+            break;
+        default:
+            goto failed;
+    }
+
+    _lex(p);
+
+    if (_parse_operand(p, &node->rhs) != 0)
+        goto failed;
+
+    node->type = type;
+    return node;
+
+failed:
+    _free_node(node);
+    return NULL;
+}
+
+static Node* _parse_not(Parser* p)
+{
+    Node* node;
+
+    if (!_keyword(p, "NOT"))
+        return _parse_primary(p);
+
+    _lex(p);
+
+    if (!(node = _parse_not(p)))
+        return NULL;
+
+    return _new_node(N_NOT, node, NULL);
+}
+
+static Node* _parse_and(Parser* p)
+{
+    Node* node;
+
+    if (!(node = _parse_not(p)))
+        return NULL;
+
+    while (node && _keyword(p, "AND"))
+    {
+        Node* right;
+        _lex(p);
+
+        if (!(right = _parse_not(p)))
+        {
+            _free_node(node);
+            return NULL;
+        }
+
+        node = _new_node(N_AND, node, right);
+    }
+
+    return node;
+}
+
+static Node* _parse_or(Parser* p)
+{
+    Node* node;
+
+    if (!(node = _parse_and(p)))
+        return NULL;
+
+    while (node && _keyword(p, "OR"))
+    {
+        Node* right;
+        _lex(p);
+
+        if (!(right = _parse_and(p)))
+        {
+            _free_node(node);
+            return NULL;
+        }
+
+        node = _new_node(N_OR, node, right);
+    }
+
+    return node;
+}
+
+static size_t _count_nodes(const Node* node)
+{
+    if (!node)
+        return 0;
+
+    return 1 + _count_nodes(node->left) + _count_nodes(node->right);
+}
+
+/* Appends name (without any class qualifier) to list unless already there */
+static void _add_property(const char** list, size_t* n, const char* name)
+{
+    const char* dot = strrchr(name, '.');
+    size_t i;
+
+    if (dot)
+        name = dot + 1;
+
+    for (i = 0; i < *n; i++)
+    {
+        if (strcasecmp(list[i], name) == 0)
+            return;
+    }
+
+    list[(*n)++] = name;
+}
+
+static void _add_operands(const char** list, size_t* n, const Node* node)
+{
+    if (node)
+    {
+        _add_operands(list, n, node->left);
+        _add_operands(list, n, node->right);
+
+        if (node->lhs.name)
+            _add_property(list, n, node->lhs.name);
+
+        if (node->rhs.name)
+            _add_property(list, n, node->rhs.name);
+    }
+}
+
+static int _parse(Parser* p, KQuery* self)
+{
+    size_t n = 0;
+
+    _lex(p);
+
+    if (!_keyword(p, "SELECT"))
+        return -1;
+
+    _lex(p);
+
+    if (p->type == T_STAR)
+        _lex(p);
+    else
+    {
+        const char* first = p->token;
+        size_t i;
+
+        /* Count the properties, then store pointers to the copied tokens */
+
+        for (;;)
+        {
+            if (p->type != T_IDENT)
+                return -1;
+
+            n++;
+            _lex(p);
+
+            if (p->type != T_COMMA)
+                break;
+
+            _lex(p);
+        }
+
+        self->properties = (const char**)calloc(n + 1, sizeof(char*));
+
+        if (!self->properties)
+            return -1;
+
+        for (i = 0; i < n; i++)
+        {
+            const char* dot = strrchr(first, '.');
+            self->properties[i] = dot ? dot + 1 : first;
+            first += strlen(first) + 1;
+            first += strlen(first) + 1;
+        }
+    }
+
+    if (!_keyword(p, "FROM"))
+        return -1;
+
+    _lex(p);
+
+    if (p->type != T_IDENT || _keyword(p, "WHERE"))
+        return -1;
+
+    self->className = p->token;
+    _lex(p);
+
+    if (_keyword(p, "WHERE"))
+    {
+        _lex(p);
+
+        if (!(self->where = _parse_or(p)))
+            return -1;
+    }
+
+    if (p->type != T_END)
+        return -1;
+
+    /* Providers must also fill in the properties the WHERE clause tests */
+
+    if (self->properties)
+    {
+        size_t i;
+
+        self->requested = (const char**)calloc(
+            n + 2 * _count_nodes(self->where) + 1, sizeof(char*));
+
+        if (!self->requested)
+            return -1;
+
+        for (i = 0, n = 0; self->properties[i]; i++)
+            _add_property(self->requested, &n, self->properties[i]);
+
+        _add_operands(self->requested, &n, self->where);
+    }
+
+    return 0;
+}
+
+/*
+**==============================================================================
+**
+** Evaluation
+**
+**==============================================================================
+*/
+
+/* Finds the offset of the named field relative to the end of the KBase */
+static long _find_field(const unsigned char* sig, const char* name, KTag* tag)
+{
+    size_t n = *sig++;
+    size_t count;
+    size_t i;
+    long offset = 0;
+
+    sig += n + 1;
+    count = *sig++;
+
+    for (i = 0; i < count; i++)
+    {
+        KTag t = *sig++;
+        n = *sig++;
+
+        if (strcasecmp((const char*)sig, name) == 0)
+        {
+            *tag = t;
+            return offset;
+        }
+
+        sig += n + 1;
+        offset += KTypeSize(t);
+    }
+
+    return -1;
+}
+
+static CMPIBoolean _bind_operand(KQuery* self, Operand* x)
+{
+    const char* name = x->name;
+    const char* dot;
+
+    if (!name)
+        return 1;
+
+    /* Allow properties to be qualified with the class name */
+
+    if ((dot = strrchr(name, '.')))
+    {
+        if (strncasecmp(name, self->className, dot - name) != 0 ||
+            self->className[dot - name] != '\0')
+        {
+            x->offset = -1;
+            return 0;
+        }
+
+        name = dot + 1;
+    }
+
+    x->offset = _find_field(self->sig, name, &x->tag);
+
+    if (x->offset < 0 || (x->tag & KTAG_ARRAY))
+        return 0;
+
+    switch (KTypeOf(x->tag))
+    {
+        case KTYPE_DATETIME:
+        case KTYPE_REFERENCE:
+        case KTYPE_INSTANCE:
+            return 0;
+        default:
+            return 1;
+    }
+}
+
+static CMPIBoolean _bind(KQuery* self, Node* node)
+{
+    CMPIBoolean exact;
+
+    if (!node)
+        return 1;
+
+    exact = _bind(self, node->left);
+    exact = _bind(self, node->right) && exact;
+    exact = _bind_operand(self, &node->lhs) && exact;
+    exact = _bind_operand(self, &node->rhs) && exact;
+
+    return exact && node->type != N_OPAQUE;
+}
+
+static void _load(Value* v, const Operand* x, const KBase* base)
+{
+    const KValue* kv;
+
+    if (!x->name)
+    {
+        *v = x->literal;
+        return;
+    }
+
+    v->type = V_NONE;
+
+    if (x->offset < 0 || (x->tag & KTAG_ARRAY))
+        return;
+
+    kv = (const KValue*)((const char*)(base + 1) + x->offset);
+
+    if (!kv->exists)
+    {
+        v->type = V_ABSENT;
+        return;
+    }
+
+    if (kv->null)
+    {
+        v->type = V_NULL;
+        return;
+    }
+
+    switch (KTypeOf(x->tag))
+    {
+        case KTYPE_BOOLEAN:
+            v->type = V_BOOLEAN;
+            v->u.boolean = kv->u.boolean;
+            break;
+        case KTYPE_UINT8:
+            v->type = V_UINT;
+            v->u.uint = kv->u.uint8;
+            break;
+        case KTYPE_SINT8:
+            v->type = V_SINT;
+            v->u.sint = kv->u.sint8;
+            break;
+        case KTYPE_UINT16:
+            v->type = V_UINT;
+            v->u.uint = kv->u.uint16;
+            break;
+        case KTYPE_SINT16:
+            v->type = V_SINT;
+            v->u.sint = kv->u.sint16;
+            break;
+        case KTYPE_UINT32:
+            v->type = V_UINT;
+            v->u.uint = kv->u.uint32;
+            break;
+        case KTYPE_SINT32:
+            v->type = V_SINT;
+            v->u.sint = kv->u.sint32;
+            break;
+        case KTYPE_UINT64:
+            v->type = V_UINT;
+            v->u.uint = kv->u.uint64;
+            break;
+        case KTYPE_SINT64:
+            v->type = V_SINT;
+            v->u.sint = kv->u.sint64;
+            break;
+        case KTYPE_REAL32:
+            v->type = V_REAL;
+            v->u.real = kv->u.real32;
+            break;
+        case KTYPE_REAL64:
+            v->type = V_REAL;
+            v->u.real = kv->u.real64;
+            break;
+        case KTYPE_CHAR16:
+            v->type = V_UINT;
+            v->u.uint = kv->u.char16;
+            break;
+        case KTYPE_STRING:
+        {
+            const KString* ks = (const KString*)kv;
+            v->type = V_STRING;
+            v->u.string = ks->chars ? ks->chars : KChars(ks->value);
+
+            if (!v->u.string)
+                v->type = V_NULL;
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+static CMPIReal64 _real(const Value* v)
+{
+    switch (v->type)
+    {
+        case V_SINT:
+            return (CMPIReal64)v->u.sint;
+        case V_UINT:
+            return (CMPIReal64)v->u.uint;
+        default:
+            return v->u.real;
+    }
+}
+
+/* Returns <0, 0 or >0, or sets *ok to zero if the values are incomparable */
+static int _compare(const Value* a, const Value* b, int* ok)
+{
+    *ok = 1;
+
+    if (a->type == V_STRING && b->type == V_STRING)
+        return strcmp(a->u.string, b->u.string);
+
+    if (a->type == V_BOOLEAN && b->type == V_BOOLEAN)
+        return (int)!!a->u.boolean - (int)!!b->u.boolean;
+
+    if (a->type < V_SINT || a->type > V_REAL || 
+        b->type < V_SINT || b->type > V_REAL)
+    {
+        *ok = 0;
+        return 0;
+    }
+
+    if (a->type == V_REAL || b->type == V_REAL)
+    {
+        CMPIReal64 x = _real(a);
+        CMPIReal64 y = _real(b);
+        return x < y ? -1 : (x > y ? 1 : 0);
+    }
+
+    if (a->type == V_SINT && a->u.sint < 0)
+    {
+        if (b->type == V_UINT || b->u.sint >= 0)
+            return -1;
+
+        return a->u.sint < b->u.sint ? -1 : (a->u.sint > b->u.sint ? 1 : 0);
+    }
+
+    if (b->type == V_SINT && b->u.sint < 0)
+        return 1;
+
+    /* Both are non-negative */
+    return a->u.uint < b->u.uint ? -1 : (a->u.uint > b->u.uint ? 1 : 0);
+}
+
+static int _and3(int a, int b)
+{
+    if (a == R_FALSE || b == R_FALSE)
+        return R_FALSE;
+
+    if (a == R_UNKNOWN || b == R_UNKNOWN)
+        return R_UNKNOWN;
+
+    return R_TRUE;
+}
+
+static int _or3(int a, int b)
+{
+    if (a == R_TRUE || b == R_TRUE)
+        return R_TRUE;
+
+    if (a == R_UNKNOWN || b == R_UNKNOWN)
+        return R_UNKNOWN;
+
+    return R_FALSE;
+}
+
+/* Applies a three-valued operator to every pair of possible outcomes */
+static int _combine(int (*op)(int, int), int x, int y)
+{
+    int r = 0;
+    int a;
+    int b;
+
+    for (a = R_TRUE; a <= R_UNKNOWN; a <<= 1)
+    {
+        for (b = R_TRUE; b <= R_UNKNOWN; b <<= 1)
+        {
+            if ((x & a) && (y & b))
+                r |= op(a, b);
+        }
+    }
+
+    return r;
+}
+
+static int _eval(const Node* node, const KBase* base)
+{
+    Value a;
+    Value b;
+    int c;
+    int ok;
+
+    switch (node->type)
+    {
+        case N_AND:
+            return _combine(_and3, 
+                _eval(node->left, base), _eval(node->right, base));
+
+        case N_OR:
+            return _combine(_or3, 
+                _eval(node->left, base), _eval(node->right, base));
+
+        case N_NOT:
+        {
+            int r = _eval(node->left, base);
+            return (r & R_UNKNOWN) | 
+                ((r & R_TRUE) ? R_FALSE : 0) | ((r & R_FALSE) ? R_TRUE : 0);
+        }
+
+        case N_IS_NULL:
+        case N_IS_NOT_NULL:
+        {
+            CMPIBoolean null;
+
+            _load(&a, &node->lhs, base);
+
+            if (a.type == V_NONE || a.type == V_ABSENT)
+                return R_TRUE | R_FALSE;
+
+            null = a.type == V_NULL;
+
+            if (node->type == N_IS_NOT_NULL)
+                null = !null;
+
+            return null ? R_TRUE : R_FALSE;
+        }
+
+        case N_OPAQUE:
+            return R_ANY;
+
+        default:
+            break;
+    }
+
+    _load(&a, &node->lhs, base);
+    _load(&b, &node->rhs, base);
+
+    if (a.type == V_NONE || b.type == V_NONE)
+        return R_ANY;
+
+    if (a.type == V_ABSENT || a.type == V_NULL || 
+        b.type == V_ABSENT || b.type == V_NULL)
+        return R_UNKNOWN;
+
+    c = _compare(&a, &b, &ok);
+
+    if (!ok)
+        return R_ANY;
+
+    switch (node->type)
+    {
+        case N_EQ:
+            ok = c == 0;
+            break;
+        case N_NE:
+            ok = c != 0;
+            break;
+        case N_LT:
+            ok = c < 0;
+            break;
+        case N_LE:
+            ok = c <= 0;
+            break;
+        case N_GT:
+            ok = c > 0;
+            break;
+        case N_GE:
+            ok = c >= 0;
+            break;
+        default:
+            return R_ANY;
+    }
+
+    return ok ? R_TRUE : R_FALSE;
+}
+
+/*
+**==============================================================================
+**
+** KQuery
+**
+**==============================================================================
+*/
+
+KQuery* KQuery_New(const char* query, CMPIStatus* status)
+{
+    KQuery* self;
+    Parser p;
+
+    KSetStatus(status, OK);
+
+    if (!query)
+    {
+        KSetStatus(status, ERR_INVALID_PARAMETER);
+        return NULL;
+    }
+
+    if (!(self = (KQuery*)calloc(1, sizeof(KQuery))) ||
+        !(self->strings = (char*)malloc(2 * strlen(query) + 2)))
+    {
+        free(self);
+        KSetStatus(status, ERR_FAILED);
+        return NULL;
+    }
+
+    p.pos = query;
+    p.out = self->strings;
+
+    if (_parse(&p, self) != 0)
+    {
+        KQuery_Delete(self);
+        KSetStatus(status, ERR_INVALID_QUERY);
+        return NULL;
+    }
+
+    return self;
+}
+
+void KQuery_Delete(KQuery* self)
+{
+    if (self)
+    {
+        _free_node(self->where);
+        free(self->properties);
+        free(self->requested);
+        free(self->strings);
+        free(self);
+    }
+}
+
+const char* KQuery_ClassName(const KQuery* self)
+{
+    return self->className;
+}
+
+const char** KQuery_Properties(const KQuery* self)
+{
+    return self->properties;
+}
+
+const char** KQuery_RequestedProperties(const KQuery* self)
+{
+    return self->requested;
+}
+
+CMPIBoolean KQuery_Bind(KQuery* self, const unsigned char* sig)
+{
+    self->sig = sig;
+    self->exact = _bind(self, self->where);
+    return self->exact;
+}
+
+int KQuery_Decide(const KQuery* self, const KBase* base)
+{
+    int r;
+
+    if (!self->where)
+        return 1;
+
+    /* Only structures of the bound class can be evaluated (a provider may
+       return those of a subclass) */
+    if (!base || base->magic != KMAGIC || base->sig != self->sig)
+        return -1;
+
+    r = _eval(self->where, base);
+
+    if (r == R_TRUE)
+        return 1;
+
+    return (r & R_TRUE) ? -1 : 0;
+}
+
+CMPIBoolean KQuery_Match(const KQuery* self, const KBase* base)
+{
+    return KQuery_Decide(self, base) != 0;
+}
+
+/* Finds a conjunct of the form "Property = literal" on the given field */
+static const Value* _key_value(const Node* node, long offset)
+{
+    const Value* v;
+
+    if (!node)
+        return NULL;
+
+    if (node->type == N_AND)
+    {
+        if ((v = _key_value(node->left, offset)))
+            return v;
+
+        return _key_value(node->right, offset);
+    }
+
+    if (node->type != N_EQ)
+        return NULL;
+
+    if (node->lhs.name && node->lhs.offset == offset && !node->rhs.name)
+        return &node->rhs.literal;
+
+    if (node->rhs.name && node->rhs.offset == offset && !node->lhs.name)
+        return &node->lhs.literal;
+
+    return NULL;
+}
+
+/* Converts a literal to a key value of the given type */
+static int _key_data(const Value* v, KTag tag, CMPIValue* value, CMPIType* type)
+{
+    CMPIUint64 max;
+    CMPISint64 min;
+
+    switch (KTypeOf(tag))
+    {
+        case KTYPE_BOOLEAN:
+            if (v->type != V_BOOLEAN)
+                return -1;
+            value->boolean = v->u.boolean;
+            *type = CMPI_boolean;
+            return 0;
+        case KTYPE_STRING:
+            if (v->type != V_STRING)
+                return -1;
+            value->chars = (char*)v->u.string;
+            *type = CMPI_chars;
+            return 0;
+        case KTYPE_UINT8:
+            max = 0xFF;
+            min = 0;
+            *type = CMPI_uint8;
+            break;
+        case KTYPE_SINT8:
+            max = 0x7F;
+            min = -0x80;
+            *type = CMPI_sint8;
+            break;
+        case KTYPE_UINT16:
+        case KTYPE_CHAR16:
+            max = 0xFFFF;
+            min = 0;
+            *type = KTypeOf(tag) == KTYPE_CHAR16 ? CMPI_char16 : CMPI_uint16;
+            break;
+        case KTYPE_SINT16:
+            max = 0x7FFF;
+            min = -0x8000;
+            *type = CMPI_sint16;
+            break;
+        case KTYPE_UINT32:
+            max = 0xFFFFFFFFU;
+            min = 0;
+            *type = CMPI_uint32;
+            break;
+        case KTYPE_SINT32:
+            max = 0x7FFFFFFF;
+            min = -0x7FFFFFFF - 1;
+            *type = CMPI_sint32;
+            break;
+        case KTYPE_UINT64:
+            max = 0xFFFFFFFFFFFFFFFFULL;
+            min = 0;
+            *type = CMPI_uint64;
+            break;
+        case KTYPE_SINT64:
+            max = 0x7FFFFFFFFFFFFFFFULL;
+            min = -0x7FFFFFFFFFFFFFFFLL - 1;
+            *type = CMPI_sint64;
+            break;
+        default:
+            return -1;
+    }
+
+    if (v->type == V_UINT)
+    {
+        if (v->u.uint > max)
+            return -1;
+
+        value->uint64 = v->u.uint;
+    }
+    else if (v->type == V_SINT)
+    {
+        if (v->u.sint < min)
+            return -1;
+
+        value->sint64 = v->u.sint;
+    }
+    else
+        return -1;
+
+    /* Narrow to the member that corresponds to the type */
+
+    switch (*type)
+    {
+        case CMPI_uint8:
+            value->uint8 = (CMPIUint8)value->uint64;
+            break;
+        case CMPI_sint8:
+            value->sint8 = (CMPISint8)value->sint64;
+            break;
+        case CMPI_uint16:
+            value->uint16 = (CMPIUint16)value->uint64;
+            break;
+        case CMPI_char16:
+            value->char16 = (CMPIChar16)value->uint64;
+            break;
+        case CMPI_sint16:
+            value->sint16 = (CMPISint16)value->sint64;
+            break;
+        case CMPI_uint32:
+            value->uint32 = (CMPIUint32)value->uint64;
+            break;
+        case CMPI_sint32:
+            value->sint32 = (CMPISint32)value->sint64;
+            break;
+        default:
+            break;
+    }
+
+    return 0;
+}
+
+CMPIObjectPath* KQuery_KeyPath(
+    const KQuery* self,
+    const CMPIBroker* cb,
+    const char* ns,
+    const char* cn)
+{
+    const unsigned char* sig = self->sig;
+    CMPIObjectPath* cop;
+    size_t n;
+    size_t count;
+    size_t i;
+    long offset = 0;
+    size_t keys = 0;
+
+    if (!sig || !self->exact)
+        return NULL;
+
+    if (!(cop = CMNewObjectPath(cb, ns, cn, NULL)))
+        return NULL;
+
+    n = *sig++;
+    sig += n + 1;
+    count = *sig++;
+
+    for (i = 0; i < count; i++)
+    {
+        KTag tag = *sig++;
+        const char* name = (const char*)++sig;
+
+        sig += sig[-1] + 1;
+
+        if ((tag & KTAG_KEY))
+        {
+            const Value* v = _key_value(self->where, offset);
+            CMPIValue value;
+            CMPIType type;
+
+            if (!v || _key_data(v, tag, &value, &type) != 0 ||
+                !KOkay(CMAddKey(cop, name, &value, type)))
+            {
+                return NULL;
+            }
+
+            keys++;
+        }
+
+        offset += KTypeSize(tag);
+    }
+
+    return keys ? cop : NULL;
+}
+
+CMPIBoolean KQuery_MatchInstance(
+    const KQuery* self, 
+    const CMPIBroker* cb,
+    const CMPIInstance* ci)
+{
+    const unsigned char* sig = self->sig;
+    size_t size = sizeof(KBase);
+    size_t n;
+    size_t count;
+    size_t i;
+    size_t mark;
+    KBase* base;
+    CMPIBoolean match = 1;
+
+    if (!self->where || !sig)
+        return 1;
+
+    n = *sig++;
+    sig += n + 1;
+    count = *sig++;
+
+    for (i = 0; i < count; i++)
+    {
+        KTag tag = *sig++;
+        sig += *sig + 2;
+        size += KTypeSize(tag);
+    }
+
+    mark = KArenaMark();
+
+    if (!(base = (KBase*)KArenaAlloc(size)))
+        return 1;
+
+    KBase_Init(base, cb, size, self->sig, NULL);
+
+    if (KOkay(KBase_FromInstance(base, ci)))
+        match = KQuery_Match(self, base);
+
+    KArenaRelease(mark);
+    return match;
+}
+
+/*
+**==============================================================================
+**
+** KFilters
+**
+**==============================================================================
+*/
+
+struct _KFilter
+{
+    struct _KFilter* next;
+    char* text;
+    size_t refs;
+
+    /* Null if the filter could not be parsed (matches everything) */
+    KQuery* query;
+};
+
+CMPIStatus KFilters_Activate(KFilters* self, const CMPISelectExp* se)
+{
+    CMPIStatus st = KSTATUS_INIT;
+    const char* text;
+    struct _KFilter* p;
+
+    if (!se || !(text = KChars(CMGetSelExpString(se, &st))))
+        KReturn(ERR_INVALID_PARAMETER);
+
+    pthread_rwlock_wrlock(&self->lock);
+
+    for (p = self->filters; p; p = p->next)
+    {
+        if (strcmp(p->text, text) == 0)
+        {
+            p->refs++;
+            pthread_rwlock_unlock(&self->lock);
+            KReturn(OK);
+        }
+    }
+
+    if (!(p = (struct _KFilter*)calloc(1, sizeof(struct _KFilter))) ||
+        !(p->text = strdup(text)))
+    {
+        pthread_rwlock_unlock(&self->lock);
+        free(p);
+        KReturn(ERR_FAILED);
+    }
+
+    if ((p->query = KQuery_New(text, NULL)))
+        KQuery_Bind(p->query, self->sig);
+
+    p->refs = 1;
+    p->next = self->filters;
+    self->filters = p;
+
+    pthread_rwlock_unlock(&self->lock);
+    KReturn(OK);
+}
+
+CMPIStatus KFilters_Deactivate(KFilters* self, const CMPISelectExp* se)
+{
+    CMPIStatus st = KSTATUS_INIT;
+    const char* text;
+    struct _KFilter** p;
+
+    if (!se || !(text = KChars(CMGetSelExpString(se, &st))))
+        KReturn(ERR_INVALID_PARAMETER);
+
+    pthread_rwlock_wrlock(&self->lock);
+
+    for (p = &self->filters; *p; p = &(*p)->next)
+    {
+        struct _KFilter* filter = *p;
+
+        if (strcmp(filter->text, text) == 0)
+        {
+            if (--filter->refs == 0)
+            {
+                *p = filter->next;
+                KQuery_Delete(filter->query);
+                free(filter->text);
+                free(filter);
+            }
+
+            break;
+        }
+    }
+
+    pthread_rwlock_unlock(&self->lock);
+    KReturn(OK);
+}
+
+CMPIBoolean KFilters_Match(KFilters* self, const KBase* base)
+{
+    struct _KFilter* p;
+    CMPIBoolean match = 0;
+
+    pthread_rwlock_rdlock(&self->lock);
+
+    for (p = self->filters; p && !match; p = p->next)
+        match = !p->query || KQuery_Match(p->query, base);
+
+    pthread_rwlock_unlock(&self->lock);
+
+    return match;
+}
+
+void KFilters_Clear(KFilters* self)
+{
+    struct _KFilter* p;
+
+    pthread_rwlock_wrlock(&self->lock);
+
+    while ((p = self->filters))
+    {
+        self->filters = p->next;
+        KQuery_Delete(p->query);
+        free(p->text);
+        free(p);
+    }
+
+    pthread_rwlock_unlock(&self->lock);
+}
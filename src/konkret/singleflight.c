@@ -0,0 +1,523 @@
+/*
+**==============================================================================
+**
+** Copyright (c) 2008, Michael E. Brasher
+** 
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+** 
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+** 
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+**==============================================================================
+*/
+
+#include "konkret.h"
+#include <strings.h>
+#include <ctype.h>
+
+/*
+**==============================================================================
+**
+** Identical enumerations that run concurrently share one execution. The
+** first caller (the leader) runs the provider and records what it returns;
+** callers arriving while it runs wait and then replay the recording into
+** their own results. The leader records only if somebody joined before its
+** first result; otherwise it closes the flight to latecomers (who would miss
+** what was already returned) and clones nothing.
+**
+**==============================================================================
+*/
+
+typedef struct _Item
+{
+    struct _Item* next;
+    CMPIInstance* ci;
+    CMPIObjectPath* cop;
+}
+Item;
+
+typedef struct _Flight
+{
+    struct _Flight* next;
+    char* key;
+    unsigned int hash;
+    pthread_cond_t cond;
+    int done;
+
+    /* Number of callers still waiting for or replaying the results */
+    size_t waiters;
+
+    /* Whether the leader keeps clones of its results (once decided) */
+    int decided;
+    int recording;
+
+    Item* items;
+    Item** tail;
+    CMPIrc rc;
+    char* msg;
+}
+Flight;
+
+static pthread_mutex_t _lock = PTHREAD_MUTEX_INITIALIZER;
+static Flight* _flights;
+
+static int _compare_names(const void* x, const void* y)
+{
+    return strcasecmp(*(const char* const*)x, *(const char* const*)y);
+}
+
+/* Forms the key: principal, namespace, class, operation, property list */
+static char* _make_key(
+    const CMPIContext* cc,
+    const CMPIObjectPath* cop,
+    const char* op,
+    const char** properties)
+{
+    char* buf = NULL;
+    size_t size = 0;
+    FILE* os;
+    CMPIData cd;
+    CMPIStatus st = KSTATUS_INIT;
+
+    if (!(os = open_memstream(&buf, &size)))
+        return NULL;
+
+    /* Never share results between different users */
+
+    cd = CMGetContextEntry(cc, CMPIPrincipal, &st);
+
+    if (KOkay(st) && cd.type == CMPI_string && !(cd.state & CMPI_nullValue))
+        fprintf(os, "%s", KChars(cd.value.string));
+
+    fprintf(os, "\n%s\n%s\n%s\n", KNameSpace(cop), KClassName(cop), op);
+
+    /* The property list is order-insensitive */
+
+    if (properties)
+    {
+        size_t n = 0;
+        size_t i;
+        const char** names;
+
+        while (properties[n])
+            n++;
+
+        if ((names = (const char**)malloc((n + 1) * sizeof(char*))))
+        {
+            memcpy(names, properties, n * sizeof(char*));
+            qsort(names, n, sizeof(char*), _compare_names);
+
+            for (i = 0; i < n; i++)
+            {
+                const char* p;
+
+                for (p = names[i]; *p; p++)
+                    fputc(tolower((unsigned char)*p), os);
+
+                fputc(',', os);
+            }
+
+            free(names);
+        }
+        else
+        {
+            fclose(os);
+            free(buf);
+            return NULL;
+        }
+    }
+    else
+        fputc('*', os);
+
+    fclose(os);
+    return buf;
+}
+
+static unsigned int _hash(const char* s)
+{
+    unsigned int h = 2166136261u;
+
+    while (*s)
+    {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
+    }
+
+    return h;
+}
+
+/* Removes a flight from the list, so later callers start a new one */
+static void _unlink(Flight* flight)
+{
+    Flight** p;
+
+    for (p = &_flights; *p; p = &(*p)->next)
+    {
+        if (*p == flight)
+        {
+            *p = flight->next;
+            break;
+        }
+    }
+}
+
+static void _free_flight(Flight* flight)
+{
+    Item* p;
+
+    for (p = flight->items; p; )
+    {
+        Item* next = p->next;
+
+        if (p->ci)
+            CMRelease(p->ci);
+
+        if (p->cop)
+            CMRelease(p->cop);
+
+        free(p);
+        p = next;
+    }
+
+    pthread_cond_destroy(&flight->cond);
+    free(flight->msg);
+    free(flight->key);
+    free(flight);
+}
+
+/*
+**==============================================================================
+**
+** Recording result (forwards to the leader's result and keeps clones)
+**
+**==============================================================================
+*/
+
+typedef struct _SingleFlight_Handle
+{
+    const CMPIResult* result;
+    Flight* flight;
+}
+SingleFlight_Handle;
+
+typedef struct _SingleFlight_Result
+{
+    void* hdl;
+    CMPIResultFT* ft;
+}
+SingleFlight_Result;
+
+static CMPIStatus _record(Flight* flight, CMPIInstance* ci, CMPIObjectPath* cop)
+{
+    Item* item;
+
+    if (!(item = (Item*)calloc(1, sizeof(Item))))
+        KReturn(ERR_FAILED);
+
+    item->ci = ci;
+    item->cop = cop;
+
+    /* Only the leader appends, and waiters read after it is done */
+    *flight->tail = item;
+    flight->tail = &item->next;
+
+    KReturn(OK);
+}
+
+/* Called by the leader for each result; decides at the first one */
+static int _recording(Flight* flight)
+{
+    if (!flight->decided)
+    {
+        pthread_mutex_lock(&_lock);
+
+        if (!(flight->recording = flight->waiters != 0))
+            _unlink(flight);
+
+        flight->decided = 1;
+        pthread_mutex_unlock(&_lock);
+    }
+
+    return flight->recording;
+}
+
+static CMPIStatus _SingleFlight_release(
+    CMPIResult* self)
+{
+    KReturn(OK);
+}
+
+static CMPIResult* _SingleFlight_clone(
+    const CMPIResult* self, 
+    CMPIStatus* status)
+{
+    if (status)
+        KSetStatus(status, ERR_FAILED);
+
+    return NULL;
+}
+
+static CMPIStatus _SingleFlight_returnData(
+    const CMPIResult* self, 
+    const CMPIValue* value, 
+    const CMPIType type)
+{
+    KReturn(ERR_FAILED);
+}
+
+static CMPIStatus _SingleFlight_returnInstance(
+    const CMPIResult* self, 
+    const CMPIInstance* ci)
+{
+    SingleFlight_Handle* handle = 
+        (SingleFlight_Handle*)(((SingleFlight_Result*)self)->hdl);
+    CMPIInstance* clone;
+    CMPIStatus st;
+
+    if (_recording(handle->flight))
+    {
+        if (!(clone = CMClone(ci, &st)))
+            return st;
+
+        KReturnIf(_record(handle->flight, clone, NULL));
+    }
+
+    return CMReturnInstance(handle->result, ci);
+}
+
+static CMPIStatus _SingleFlight_returnObjectPath(
+    const CMPIResult* self, 
+    const CMPIObjectPath* cop)
+{
+    SingleFlight_Handle* handle = 
+        (SingleFlight_Handle*)(((SingleFlight_Result*)self)->hdl);
+    CMPIObjectPath* clone;
+    CMPIStatus st;
+
+    if (_recording(handle->flight))
+    {
+        if (!(clone = CMClone(cop, &st)))
+            return st;
+
+        KReturnIf(_record(handle->flight, NULL, clone));
+    }
+
+    return CMReturnObjectPath(handle->result, cop);
+}
+
+static CMPIStatus _SingleFlight_returnDone(
+    const CMPIResult * self)
+{
+    SingleFlight_Handle* handle = 
+        (SingleFlight_Handle*)(((SingleFlight_Result*)self)->hdl);
+
+    return CMReturnDone(handle->result);
+}
+
+static CMPIStatus _SingleFlight_returnError(
+    const CMPIResult* self, 
+    const CMPIError* err)
+{
+    KReturn(ERR_FAILED);
+}
+
+static CMPIResultFT _ft =
+{
+    CMPICurrentVersion,
+    _SingleFlight_release,
+    _SingleFlight_clone,
+    _SingleFlight_returnData,
+    _SingleFlight_returnInstance,
+    _SingleFlight_returnObjectPath,
+    _SingleFlight_returnDone,
+    _SingleFlight_returnError
+};
+
+/*
+**==============================================================================
+**
+** Flights
+**
+**==============================================================================
+*/
+
+/* Replays a finished flight into the result of a waiting caller */
+static CMPIStatus _replay(
+    const CMPIBroker* cb, 
+    Flight* flight, 
+    const CMPIResult* cr)
+{
+    CMPIStatus st = KSTATUS_INIT;
+    Item* p;
+
+    if (flight->rc != CMPI_RC_OK)
+    {
+        if (flight->msg)
+            KSetStatus2(cb, &st, OK, flight->msg);
+
+        st.rc = flight->rc;
+        return st;
+    }
+
+    for (p = flight->items; p && KOkay(st); p = p->next)
+    {
+        if (p->ci)
+            st = CMReturnInstance(cr, p->ci);
+        else if (p->cop)
+            st = CMReturnObjectPath(cr, p->cop);
+    }
+
+    if (KOkay(st))
+        st = CMReturnDone(cr);
+
+    return st;
+}
+
+static CMPIStatus _single_flight(
+    const CMPIBroker* cb,
+    CMPIInstanceMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop,
+    const char** properties,
+    const char* op,
+    KEnumInstancesProc enumInstances,
+    KEnumInstanceNamesProc enumInstanceNames)
+{
+    SingleFlight_Result result;
+    SingleFlight_Handle handle;
+    CMPIStatus st;
+    Flight* flight;
+    char* key;
+    unsigned int hash;
+
+    if (!(key = _make_key(cc, cop, op, properties)))
+        KReturn(ERR_FAILED);
+
+    hash = _hash(key);
+
+    pthread_mutex_lock(&_lock);
+
+    /* Join an identical operation that is already running */
+
+    for (flight = _flights; flight; flight = flight->next)
+    {
+        if (flight->hash == hash && strcmp(flight->key, key) == 0)
+            break;
+    }
+
+    if (flight)
+    {
+        free(key);
+        flight->waiters++;
+
+        while (!flight->done)
+            pthread_cond_wait(&flight->cond, &_lock);
+
+        pthread_mutex_unlock(&_lock);
+
+        st = _replay(cb, flight, cr);
+
+        pthread_mutex_lock(&_lock);
+
+        if (--flight->waiters == 0)
+            _free_flight(flight);
+
+        pthread_mutex_unlock(&_lock);
+        return st;
+    }
+
+    /* Otherwise lead a new one */
+
+    if (!(flight = (Flight*)calloc(1, sizeof(Flight))))
+    {
+        pthread_mutex_unlock(&_lock);
+        free(key);
+        KReturn(ERR_FAILED);
+    }
+
+    flight->key = key;
+    flight->hash = hash;
+    flight->tail = &flight->items;
+    pthread_cond_init(&flight->cond, NULL);
+    flight->next = _flights;
+    _flights = flight;
+
+    pthread_mutex_unlock(&_lock);
+
+    handle.result = cr;
+    handle.flight = flight;
+    result.hdl = (void*)&handle;
+    result.ft = &_ft;
+
+    if (enumInstances)
+    {
+        st = (*enumInstances)(
+            mi, cc, (CMPIResult*)(void*)&result, cop, properties);
+    }
+    else
+    {
+        st = (*enumInstanceNames)(
+            mi, cc, (CMPIResult*)(void*)&result, cop);
+    }
+
+    pthread_mutex_lock(&_lock);
+
+    /* Later callers must start a new flight to see fresh data */
+
+    _unlink(flight);
+
+    flight->rc = st.rc;
+
+    if (st.msg && KChars(st.msg))
+        flight->msg = strdup(KChars(st.msg));
+
+    flight->done = 1;
+
+    if (flight->waiters)
+        pthread_cond_broadcast(&flight->cond);
+    else
+        _free_flight(flight);
+
+    pthread_mutex_unlock(&_lock);
+
+    return st;
+}
+
+CMPIStatus KSingleFlightEnumInstances(
+    const CMPIBroker* cb,
+    CMPIInstanceMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop,
+    const char** properties,
+    KEnumInstancesProc proc)
+{
+    return _single_flight(cb, mi, cc, cr, cop, properties, 
+        "EnumerateInstances", proc, NULL);
+}
+
+CMPIStatus KSingleFlightEnumInstanceNames(
+    const CMPIBroker* cb,
+    CMPIInstanceMI* mi,
+    const CMPIContext* cc,
+    const CMPIResult* cr,
+    const CMPIObjectPath* cop,
+    KEnumInstanceNamesProc proc)
+{
+    return _single_flight(cb, mi, cc, cr, cop, NULL, 
+        "EnumerateInstanceNames", NULL, proc);
+}
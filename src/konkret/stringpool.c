@@ -0,0 +1,184 @@
+/*
+**==============================================================================
+**
+** Copyright (c) 2008, Michael E. Brasher
+** 
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+** 
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+** 
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+**==============================================================================
+*/
+
+#include "konkret.h"
+
+typedef struct _KStringPoolEntry
+{
+    struct _KStringPoolEntry* next;
+    unsigned int hash;
+    CMPIString* str;
+    const char* chars;
+}
+KStringPoolEntry;
+
+static unsigned int _hash(const char* s)
+{
+    unsigned int h = 2166136261u;
+
+    while (*s)
+    {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
+    }
+
+    return h;
+}
+
+static CMPIString* _find(KStringPool* self, const char* s, unsigned int hash)
+{
+    KStringPoolEntry* p;
+
+    if (!self->nbuckets)
+        return NULL;
+
+    for (p = self->buckets[hash % self->nbuckets]; p; p = p->next)
+    {
+        if (p->hash == hash && strcmp(p->chars, s) == 0)
+            return p->str;
+    }
+
+    return NULL;
+}
+
+static int _grow(KStringPool* self)
+{
+    size_t n = self->nbuckets ? self->nbuckets * 2 : 64;
+    KStringPoolEntry** buckets;
+    size_t i;
+
+    if (!(buckets = (KStringPoolEntry**)calloc(n, sizeof(*buckets))))
+        return -1;
+
+    for (i = 0; i < self->nbuckets; i++)
+    {
+        KStringPoolEntry* p = self->buckets[i];
+
+        while (p)
+        {
+            KStringPoolEntry* next = p->next;
+            p->next = buckets[p->hash % n];
+            buckets[p->hash % n] = p;
+            p = next;
+        }
+    }
+
+    free(self->buckets);
+    self->buckets = buckets;
+    self->nbuckets = n;
+    return 0;
+}
+
+CMPIString* KStringPool_Intern(
+    KStringPool* self, 
+    const CMPIBroker* cb, 
+    const char* s)
+{
+    unsigned int hash;
+    CMPIString* str;
+    CMPIString* tmp;
+    KStringPoolEntry* entry;
+
+    if (!self || !cb || !s)
+        return NULL;
+
+    hash = _hash(s);
+
+    pthread_rwlock_rdlock(&self->lock);
+    str = _find(self, s, hash);
+    pthread_rwlock_unlock(&self->lock);
+
+    if (str)
+        return str;
+
+    pthread_rwlock_wrlock(&self->lock);
+
+    /* Another thread may have added it meanwhile */
+
+    if ((str = _find(self, s, hash)))
+    {
+        pthread_rwlock_unlock(&self->lock);
+        return str;
+    }
+
+    if (self->count >= self->nbuckets && _grow(self) != 0)
+    {
+        pthread_rwlock_unlock(&self->lock);
+        return NULL;
+    }
+
+    /* Clone the string so that it outlives the current request */
+
+    if (!(tmp = CMNewString(cb, s, NULL)) || !(str = CMClone(tmp, NULL)))
+    {
+        pthread_rwlock_unlock(&self->lock);
+        return NULL;
+    }
+
+    if (!(entry = (KStringPoolEntry*)malloc(sizeof(KStringPoolEntry))))
+    {
+        CMRelease(str);
+        pthread_rwlock_unlock(&self->lock);
+        return NULL;
+    }
+
+    entry->hash = hash;
+    entry->str = str;
+    entry->chars = KChars(str);
+    entry->next = self->buckets[hash % self->nbuckets];
+    self->buckets[hash % self->nbuckets] = entry;
+    self->count++;
+
+    pthread_rwlock_unlock(&self->lock);
+    return str;
+}
+
+void KStringPool_Clear(KStringPool* self)
+{
+    size_t i;
+
+    pthread_rwlock_wrlock(&self->lock);
+
+    for (i = 0; i < self->nbuckets; i++)
+    {
+        KStringPoolEntry* p = self->buckets[i];
+
+        while (p)
+        {
+            KStringPoolEntry* next = p->next;
+            CMRelease(p->str);
+            free(p);
+            p = next;
+        }
+    }
+
+    free(self->buckets);
+    self->buckets = NULL;
+    self->nbuckets = 0;
+    self->count = 0;
+
+    pthread_rwlock_unlock(&self->lock);
+}
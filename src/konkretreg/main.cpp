@@ -28,6 +28,7 @@
 #include <unistd.h>
 #include <vector>
 #include <string>
+#include <algorithm>
 
 using namespace std;
 
@@ -189,37 +190,52 @@ int main(int argc, char** argv)
                 n--;
                 continue;
             }
-            char buf[4096];
-
             size_t r = strlen(p) + 1;
-            *buf = '\0';
-            strncat(buf, p + sizeof(REG)-1, sizeof(buf)-1);
 
-            Reg reg;
+            // A registration block holds several entries separated by ';'
+            // (see KONKRET_REGISTRATION_BLOCK()):
+
+            string block = p + sizeof(REG)-1;
+
+            for (size_t pos = 0; pos <= block.size(); )
+            {
+                size_t end = block.find(';', pos);
+
+                if (end == string::npos)
+                    end = block.size();
+
+                char buf[4096];
+                *buf = '\0';
+                strncat(buf, block.c_str() + pos, 
+                    min(end - pos, sizeof(buf)-1));
+                pos = end + 1;
 
-            // Get nameSpace:
+                Reg reg;
 
-            char* q = strtok(buf, ":");
+                // Get nameSpace:
 
-            if (q)
-                reg.nameSpace = q;
+                char* q = strtok(buf, ":");
 
-            // Get className:
+                if (q)
+                    reg.nameSpace = q;
 
-            if (q && (q = strtok(NULL, ":")))
-                reg.className = q;
+                // Get className:
 
-            // Get providerName:
+                if (q && (q = strtok(NULL, ":")))
+                    reg.className = q;
 
-            if (q && (q = strtok(NULL, ":")))
-                reg.providerName = q;
+                // Get providerName:
 
-            // Get types:
+                if (q && (q = strtok(NULL, ":")))
+                    reg.providerName = q;
 
-            if (q && (q = strtok(NULL, ":")))
-                reg.types = q;
+                // Get types:
 
-            regs.push_back(reg);
+                if (q && (q = strtok(NULL, ":")))
+                    reg.types = q;
+
+                regs.push_back(reg);
+            }
 
             p += r;
             n -= r;
@@ -2,6 +2,7 @@
 
 #include <cassert>
 #include "MOF_Types.h"
+#include "MOF_Arena.h"
 #include "REF_Parser.h"
 
 extern int MOF_lex();
@@ -315,25 +316,25 @@ name
     | TOK_SCHEMA
     {
 	MOF_trace("name:2");
-	$$ = strdup($1);
+	$$ = MOF_strdup($1);
 	MOF_ASSERT($$ != NULL);
     }
     | TOK_ASSOCIATION
     {
 	MOF_trace("name:3");
-	$$ = strdup($1);
+	$$ = MOF_strdup($1);
 	MOF_ASSERT($$ != NULL);
     }
     | TOK_INDICATION
     {
 	MOF_trace("name:4");
-	$$ = strdup($1);
+	$$ = MOF_strdup($1);
 	MOF_ASSERT($$ != NULL);
     }
     | TOK_REFERENCE
     {
 	MOF_trace("name:5");
-	$$ = strdup($1);
+	$$ = MOF_strdup($1);
 	MOF_ASSERT($$ != NULL);
     }
     ;
@@ -642,7 +643,7 @@ class_decl
     {
 	MOF_trace("class_decl:1");
 	$$ = $1;
-	$$->file_name = MOF_file_name ? strdup(MOF_file_name) : NULL;
+	$$->file_name = MOF_file_name ? MOF_strdup(MOF_file_name) : NULL;
 	$$->qualifiers = NULL;
 	$$->features = $2;
     }
@@ -1380,7 +1381,7 @@ literal
 	$$ = new MOF_Literal();
 	MOF_ASSERT($$ != NULL);
 	$$->value_type = TOK_STRING_VALUE;
-	$$->string_value = $1.escaped;
+	$$->string_value = MOF_arena_string($1.escaped);
         free($1.raw);
     }
     | TOK_NULL_VALUE
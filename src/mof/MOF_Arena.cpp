@@ -0,0 +1,183 @@
+/*
+**==============================================================================
+**
+** Copyright (c) 2003, 2004, 2005, 2006, Michael Brasher, Karl Schopmeyer
+** Copyright (c) 2008, Michael E. Brasher
+** 
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+** 
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+** 
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+**==============================================================================
+*/
+
+#include "MOF_Arena.h"
+#include "MOF_Parser.h"
+#include "MOF_Class_Decl.h"
+#include "MOF_Qualifier_Decl.h"
+#include "MOF_Instance_Decl.h"
+#include <map>
+
+using namespace std;
+
+static const size_t BLOCK_SIZE = 1024 * 1024;
+static const size_t ALIGNMENT = 16;
+
+MOF_Arena* MOF_Arena::current = 0;
+
+// The blocks of every live arena (start to end), for contains():
+
+typedef map<const char*, const char*> Block_Map;
+static Block_Map _block_map;
+
+MOF_Arena::MOF_Arena() : _next(0), _end(0), _bytes(0)
+{
+}
+
+MOF_Arena::~MOF_Arena()
+{
+    for (size_t i = 0; i < _blocks.size(); i++)
+    {
+        _block_map.erase(_blocks[i]);
+        free(_blocks[i]);
+    }
+
+    if (current == this)
+        current = 0;
+}
+
+void* MOF_Arena::allocate(size_t size)
+{
+    size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+
+    if (size > (size_t)(_end - _next))
+    {
+        // Big requests get a block to themselves (leaving the current one
+        // to carry on with):
+
+        size_t block_size = size > BLOCK_SIZE / 4 ? size : BLOCK_SIZE;
+        char* block = (char*)malloc(block_size);
+
+        if (!block)
+        {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+
+        _blocks.push_back(block);
+        _block_map[block] = block + block_size;
+
+        if (block_size != BLOCK_SIZE)
+        {
+            _bytes += size;
+            return block;
+        }
+
+        _next = block;
+        _end = block + block_size;
+    }
+
+    void* p = _next;
+    _next += size;
+    _bytes += size;
+    return p;
+}
+
+char* MOF_Arena::strndup(const char* s, size_t n)
+{
+    char* p = (char*)allocate(n + 1);
+    memcpy(p, s, n);
+    p[n] = '\0';
+    return p;
+}
+
+bool MOF_Arena::contains(const void* p)
+{
+    if (_block_map.empty())
+        return false;
+
+    Block_Map::const_iterator pos = _block_map.upper_bound((const char*)p);
+
+    if (pos == _block_map.begin())
+        return false;
+
+    --pos;
+    return (const char*)p < pos->second;
+}
+
+char* MOF_strdup(const char* s)
+{
+    return MOF_strndup(s, strlen(s));
+}
+
+char* MOF_strndup(const char* s, size_t n)
+{
+    if (MOF_Arena::current)
+        return MOF_Arena::current->strndup(s, n);
+
+    char* p = (char*)malloc(n + 1);
+
+    if (p)
+    {
+        memcpy(p, s, n);
+        p[n] = '\0';
+    }
+
+    return p;
+}
+
+char* MOF_arena_string(char* s)
+{
+    if (!MOF_Arena::current || !s)
+        return s;
+
+    char* p = MOF_Arena::current->strndup(s, strlen(s));
+    free(s);
+    return p;
+}
+
+void MOF_free(void* p)
+{
+    if (!MOF_Arena::contains(p))
+        free(p);
+}
+
+//==============================================================================
+//
+// MOF_begin_arena() and MOF_free_arena()
+//
+//==============================================================================
+
+void MOF_begin_arena()
+{
+    if (!MOF_Arena::current)
+        MOF_Arena::current = new MOF_Arena;
+}
+
+void MOF_free_arena()
+{
+    if (!MOF_Arena::current)
+        return;
+
+    // Everything parsed goes with the arena:
+
+    MOF_Class_Decl::reset_list();
+    MOF_Qualifier_Decl::reset_list();
+    MOF_Instance_Decl::reset_list();
+
+    delete MOF_Arena::current;
+}
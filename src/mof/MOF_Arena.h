@@ -0,0 +1,82 @@
+/*
+**==============================================================================
+**
+** Copyright (c) 2003, 2004, 2005, 2006, Michael Brasher, Karl Schopmeyer
+** Copyright (c) 2008, Michael E. Brasher
+** 
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+** 
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+** 
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+**==============================================================================
+*/
+
+#ifndef _MOF_Arena_h
+#define _MOF_Arena_h
+
+#include "MOF_Config.h"
+
+#ifndef SWIG
+#include <vector>
+#endif
+
+/* Memory for one parse session (see MOF_begin_arena()). Parse-tree nodes and
+   their strings are carved out of large blocks, which are all freed at once
+   (without running any destructors) when the arena is destroyed. */
+class MOF_LINKAGE MOF_Arena
+{
+public:
+
+    MOF_Arena();
+
+    ~MOF_Arena();
+
+    void* allocate(size_t size);
+
+    char* strndup(const char* s, size_t n);
+
+    /* Bytes handed out so far */
+    size_t bytes() const { return _bytes; }
+
+    /* Where new parse-tree nodes and strings come from (the heap if null) */
+    static MOF_Arena* current;
+
+    /* Whether p came from a live arena (and so must not be freed) */
+    static bool contains(const void* p);
+
+private:
+
+    MOF_Arena(const MOF_Arena&);
+    MOF_Arena& operator=(const MOF_Arena&);
+
+    std::vector<char*> _blocks;
+    char* _next;
+    char* _end;
+    size_t _bytes;
+};
+
+/* Like strdup() and strndup(), but from the current arena if there is one */
+MOF_LINKAGE char* MOF_strdup(const char* s);
+MOF_LINKAGE char* MOF_strndup(const char* s, size_t n);
+
+/* Moves a malloc'ed string into the current arena (if there is one) */
+MOF_LINKAGE char* MOF_arena_string(char* s);
+
+/* Frees a string from MOF_strdup() (or malloc), unless an arena owns it */
+MOF_LINKAGE void MOF_free(void* p);
+
+#endif /* _MOF_Arena_h */
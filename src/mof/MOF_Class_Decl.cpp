@@ -26,24 +26,30 @@
 */
 
 #include "MOF_Class_Decl.h"
+#include "MOF_Arena.h"
+#include "MOF_Profile.h"
 #include "MOF_Error.h"
 #include "MOF_String.h"
 #include "MOF_Qualifier_Info.h"
 #include "MOF_Instance_Decl.h"
 #include "MOF_Yacc.h"
+#include <cctype>
+#include <map>
+#include <string>
 
 MOF_Class_Decl* MOF_Class_Decl::list = 0;
+static MOF_Class_Decl* _list_tail = 0;
 
 MOF_Class_Decl::MOF_Class_Decl() : alias(0), super_class_name(0), file_name(0),
     super_class(0), features(0), all_features(0)
 {
-
+    MOF_Profile::nodes[MOF_Profile::CLASS_DECL]++;
 }
 
 MOF_Class_Decl::~MOF_Class_Decl()
 {
-    free(alias);
-    free(super_class_name);
+    MOF_free(alias);
+    MOF_free(super_class_name);
     features->delete_list();
     all_features->delete_list();
 }
@@ -110,7 +116,7 @@ static void _check_duplicate_features(
     {
         for (q = class_decl->features; q != p; q = (MOF_Feature*)q->next)
         {
-            if (MOF_stricmp(p->name, q->name) == 0)
+            if (p->symbol() == q->symbol())
                 MOF_error_printf("duplicate class feature: \"%s\"", p->name);
         }
     }
@@ -186,7 +192,8 @@ static void _validate_feature_compatibility(
                      qualifier;
                      qualifier = (MOF_Qualifier*)qualifier->next)
                 {
-                    if (strcasecmp(qualifier->name, "EmbeddedInstance") == 0)
+                    if (qualifier->symbol()->qual_id ==
+                        MOF_QID_EMBEDDEDINSTANCE)
                     {
                         /* this string property defines actually an embedded_instance
                          * so data_type string will actually match to instance
@@ -257,6 +264,8 @@ static void _build_param_qual_info_list(
 
 static void _build_all_features(MOF_Class_Decl* class_decl)
 {
+    MOF_Feature_Info* tail = 0;
+
     /*
      * Propagate class features from super class (if any):
      */
@@ -279,10 +288,7 @@ static void _build_all_features(MOF_Class_Decl* class_decl)
             info->propagated = true;
             info->feature = p->feature;
 
-            if (class_decl->all_features == 0)
-                class_decl->all_features = info;
-            else
-                class_decl->all_features->append(info);
+            MOF_append(class_decl->all_features, tail, info);
         }
     }
 
@@ -304,7 +310,7 @@ static void _build_all_features(MOF_Class_Decl* class_decl)
 
             for (q = class_decl->all_features; q; q =(MOF_Feature_Info*)q->next)
             {
-                if (MOF_stricmp(p->name, q->feature->name) == 0)
+                if (p->symbol() == q->feature->symbol())
                 {
                     /*
                      * Fix case to match original case.
@@ -405,39 +411,91 @@ static void _build_all_features(MOF_Class_Decl* class_decl)
                 info->propagated = false;
                 info->feature = p;
 
-                if (class_decl->all_features == 0)
-                    class_decl->all_features = info;
-                else
-                    class_decl->all_features->append(info);
+                MOF_append(class_decl->all_features, tail, info);
             }
 
         }
     }
 }
 
+/*
+ * Classes by lower-case name, for find(). Classes are only ever appended to
+ * the list, so the index catches up from the last class it saw (and starts
+ * over if the list was replaced, as by a repository load).
+ */
+
+typedef std::map<std::string, MOF_Class_Decl*> Class_Index;
+static Class_Index _index;
+static MOF_Class_Decl* _index_head = 0;
+static MOF_Class_Decl* _index_last = 0;
+
+static std::string _lower(const char* s)
+{
+    std::string key(s);
+
+    for (size_t i = 0; i < key.size(); i++)
+        key[i] = tolower((unsigned char)key[i]);
+
+    return key;
+}
+
+static void _update_index()
+{
+    MOF_Class_Decl* p;
+
+    if (_index_head != MOF_Class_Decl::list)
+    {
+        _index.clear();
+        _index_head = MOF_Class_Decl::list;
+        _index_last = 0;
+    }
+
+    p = _index_last ? (MOF_Class_Decl*)_index_last->next : MOF_Class_Decl::list;
+
+    for (; p; p = (MOF_Class_Decl*)p->next)
+    {
+        /* The first of any two classes with the same name wins (as it did
+           when find() searched the list) */
+        _index.insert(Class_Index::value_type(_lower(p->name), p));
+        _index_last = p;
+    }
+}
+
+void MOF_Class_Decl::reset_list()
+{
+    // The index and the tail point into the old list; a new list may reuse
+    // its addresses.
+
+    list = 0;
+    _list_tail = 0;
+    _index.clear();
+    _index_head = 0;
+    _index_last = 0;
+}
+
 MOF_Class_Decl* MOF_Class_Decl::find(
     char* class_name,
     bool fix_case)
 {
-    MOF_Class_Decl* p;
+    _update_index();
 
-    for (p = MOF_Class_Decl::list; p; p = (MOF_Class_Decl*)p->next)
+    Class_Index::const_iterator pos = _index.find(_lower(class_name));
+
+    if (pos == _index.end())
+        return 0;
+
+    MOF_Class_Decl* p = pos->second;
+
+    if (fix_case && strcmp(p->name, class_name) != 0)
     {
-        if (MOF_stricmp(p->name, class_name) == 0)
-        {
-            if (fix_case && strcmp(p->name, class_name) != 0)
-            {
 #if 0
-                MOF_warning_printf("changing case of \"%s\" to \"%s\"",
-                    class_name, p->name);
+        MOF_warning_printf("changing case of \"%s\" to \"%s\"",
+            class_name, p->name);
 #endif
-                strcpy(class_name, p->name);
-            }
-            return p;
-        }
+        strcpy(class_name, p->name);
     }
 
-    return 0;
+    return p;
 }
 
 MOF_Class_Decl* MOF_Class_Decl::find_by_alias(
@@ -597,7 +655,11 @@ void MOF_Class_Decl::validate()
      * into a single list for easier processing).
      */
     
-    _build_all_features(this);
+    {
+        double start = MOF_Profile::start();
+        _build_all_features(this);
+        MOF_Profile::stop(MOF_Profile::BUILD_ALL_FEATURES, start);
+    }
 
     if (qual_mask & MOF_QT_ASSOCIATION)
         expected_scope |= MOF_SCOPE_ASSOCIATION;
@@ -660,7 +722,7 @@ void MOF_Class_Decl::validate()
             q; 
             q = (MOF_Qualifier_Info*)q->next)
         {
-            if (strcasecmp(q->qualifier->name, "EmbeddedInstance") != 0)
+            if (q->qualifier->symbol()->qual_id != MOF_QID_EMBEDDEDINSTANCE)
                 continue;
 
             _check_EmbeddedInstance_value(q->qualifier);
@@ -712,7 +774,7 @@ void MOF_Class_Decl::validate()
             for (MOF_Qualifier_Info* r = q->all_qualifiers; r;
                 r = (MOF_Qualifier_Info*)r->next)
             {
-                if (strcasecmp(r->qualifier->name, "EmbeddedInstance") != 0)
+                if (r->qualifier->symbol()->qual_id != MOF_QID_EMBEDDEDINSTANCE)
                     continue;
 
                 _check_EmbeddedInstance_value(r->qualifier);
@@ -846,16 +908,15 @@ void MOF_Class_Decl::validate()
 
 void MOF_Class_Decl::handle(MOF_Class_Decl* class_decl)
 {
+    double start = MOF_Profile::start();
     class_decl->validate();
+    MOF_Profile::stop(MOF_Profile::VALIDATE_CLASS, start);
 
     /*
      * Add class to list.
      */
 
-    if (MOF_Class_Decl::list)
-        MOF_Class_Decl::list->append(class_decl);
-    else
-        MOF_Class_Decl::list = class_decl;
+    MOF_append(MOF_Class_Decl::list, _list_tail, class_decl);
 
 #if 0
     class_decl->print();
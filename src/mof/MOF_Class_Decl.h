@@ -75,6 +75,11 @@ public:
 
     static void print_static_list();
 
+    /* Empties the list and forgets where it ended (the nodes themselves are
+       not freed). For when the nodes go away with their arena or a
+       repository load replaces the list. */
+    static void reset_list();
+
 #if 0
     static void print_nested_refs();
 #endif
@@ -26,12 +26,28 @@
 */
 
 #include "MOF_Element.h"
+#include "MOF_Arena.h"
+#include <new>
 
 MOF_Element::~MOF_Element()
 {
 
 }
 
+void* MOF_Element::operator new(size_t size)
+{
+    if (MOF_Arena::current)
+        return MOF_Arena::current->allocate(size);
+
+    return ::operator new(size);
+}
+
+void MOF_Element::operator delete(void* p)
+{
+    if (!MOF_Arena::contains(p))
+        ::operator delete(p);
+}
+
 void MOF_Element::append(MOF_Element* element)
 {
     MOF_ASSERT(this != 0);
@@ -67,14 +83,10 @@ MOF_Element* MOF_Element::clone() const
 MOF_Element* MOF_Element::clone_list() const
 {
     MOF_Element* list = 0;
+    MOF_Element* tail = 0;
 
     for (const MOF_Element* p = this; p; p = p->next)
-    {
-        if (list == 0)
-            list = clone();
-        else
-            list->append(clone());
-    }
+        MOF_append(list, tail, p->clone());
 
     return list;
 }
@@ -41,6 +41,11 @@ public:
 
     virtual ~MOF_Element();
 
+    /* From the current MOF_Arena, if there is one */
+    static void* operator new(size_t size);
+
+    static void operator delete(void* p);
+
     void append(MOF_Element* element);
 
     size_t list_size() const;
@@ -54,4 +59,29 @@ public:
     MOF_Element* next;
 };
 
+/* Appends element to the list with the given head in constant time, given a
+   tail that the caller keeps alongside the head (append() walks the whole
+   list). The tail is found again if it is not the end of the list, as when
+   the list was built elsewhere. */
+template<class T>
+inline void MOF_append(T*& head, T*& tail, T* element)
+{
+    if (!head)
+        tail = 0;
+    else if (!tail || tail->next)
+    {
+        for (tail = head; tail->next; tail = (T*)tail->next)
+            ;
+    }
+
+    element->next = 0;
+
+    if (tail)
+        tail->next = element;
+    else
+        head = element;
+
+    tail = element;
+}
+
 #endif /*_MOF_Element_h */
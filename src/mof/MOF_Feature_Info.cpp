@@ -27,12 +27,13 @@
 
 #include "MOF_Feature.h"
 #include "MOF_Feature_Info.h"
+#include "MOF_Profile.h"
 #include "MOF_Class_Decl.h"
 
 MOF_Feature_Info::MOF_Feature_Info() 
     : feature(0), class_origin(0), propagated(false)
 {
-
+    MOF_Profile::nodes[MOF_Profile::FEATURE_INFO]++;
 }
 
 MOF_Feature_Info::~MOF_Feature_Info()
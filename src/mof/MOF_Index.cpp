@@ -0,0 +1,482 @@
+/*
+**==============================================================================
+**
+** Copyright (c) 2003, 2004, 2005, 2006, Michael Brasher, Karl Schopmeyer
+** Copyright (c) 2008, Michael E. Brasher
+** 
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+** 
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+** 
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+**==============================================================================
+*/
+
+#include "MOF_Parser.h"
+#include "MOF_Profile.h"
+#include "MOF_String.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <cctype>
+#include <cstring>
+
+using namespace std;
+
+//==============================================================================
+//
+// Prescan
+//
+//     A MOF file is tokenized (skipping comments and string contents) just
+//     far enough to learn which files it includes, which classes it declares
+//     and which classes those need to see first: super classes, REF targets
+//     and EmbeddedInstance classes.
+//
+//==============================================================================
+
+enum Token_Kind { TOKEN_IDENT, TOKEN_STRING, TOKEN_OTHER };
+
+struct Token
+{
+    Token_Kind kind;
+    string text;
+};
+
+struct Scan
+{
+    vector<string> includes;
+    vector<string> classes;
+    vector<string> deps;
+    bool pragmas_only;
+};
+
+static string _lower(const string& s)
+{
+    string r = s;
+
+    for (size_t i = 0; i < r.size(); i++)
+        r[i] = tolower((unsigned char)r[i]);
+
+    return r;
+}
+
+static bool _is(const Token& t, const char* ident)
+{
+    return t.kind == TOKEN_IDENT && MOF_stricmp(t.text.c_str(), ident) == 0;
+}
+
+static bool _is(const Token& t, char c)
+{
+    return t.kind == TOKEN_OTHER && t.text.size() == 1 && t.text[0] == c;
+}
+
+static void _tokenize(const string& s, vector<Token>& tokens)
+{
+    size_t n = s.size();
+    size_t i = 0;
+
+    while (i < n)
+    {
+        char c = s[i];
+
+        if (isspace((unsigned char)c))
+        {
+            i++;
+        }
+        else if (c == '/' && i + 1 < n && s[i+1] == '/')
+        {
+            while (i < n && s[i] != '\n')
+                i++;
+        }
+        else if (c == '/' && i + 1 < n && s[i+1] == '*')
+        {
+            size_t end = s.find("*/", i + 2);
+            i = end == string::npos ? n : end + 2;
+        }
+        else if (c == '"' || c == '\'')
+        {
+            Token t;
+            t.kind = c == '"' ? TOKEN_STRING : TOKEN_OTHER;
+
+            for (i++; i < n && s[i] != c; i++)
+            {
+                if (s[i] == '\\' && i + 1 < n)
+                    i++;
+
+                t.text += s[i];
+            }
+
+            i++;
+            tokens.push_back(t);
+        }
+        else if (isalnum((unsigned char)c) || c == '_')
+        {
+            size_t start = i;
+
+            while (i < n && (isalnum((unsigned char)s[i]) || s[i] == '_'))
+                i++;
+
+            Token t;
+            t.kind = TOKEN_IDENT;
+            t.text = s.substr(start, i - start);
+            tokens.push_back(t);
+        }
+        else
+        {
+            Token t;
+            t.kind = TOKEN_OTHER;
+            t.text = c;
+            tokens.push_back(t);
+            i++;
+        }
+    }
+}
+
+static int _scan_file(const string& path, Scan& scan)
+{
+    FILE* is = fopen(path.c_str(), "rb");
+
+    if (!is)
+        return -1;
+
+    string text;
+    char buf[4096];
+    size_t n;
+
+    while ((n = fread(buf, 1, sizeof(buf), is)) > 0)
+        text.append(buf, n);
+
+    fclose(is);
+
+    vector<Token> t;
+    _tokenize(text, t);
+
+    scan.pragmas_only = true;
+    n = t.size();
+
+    for (size_t i = 0; i < n; i++)
+    {
+        // #pragma NAME ("VALUE")
+
+        if (_is(t[i], '#') && i + 5 < n && _is(t[i+1], "pragma") &&
+            _is(t[i+3], '(') && t[i+4].kind == TOKEN_STRING && 
+            _is(t[i+5], ')'))
+        {
+            if (_is(t[i+2], "include"))
+                scan.includes.push_back(t[i+4].text);
+
+            i += 5;
+            continue;
+        }
+
+        scan.pragmas_only = false;
+
+        // class NAME [: SUPER]
+
+        if (_is(t[i], "class") && i + 1 < n && t[i+1].kind == TOKEN_IDENT)
+        {
+            scan.classes.push_back(t[i+1].text);
+
+            if (i + 3 < n && _is(t[i+2], ':') && t[i+3].kind == TOKEN_IDENT)
+                scan.deps.push_back(t[i+3].text);
+
+            continue;
+        }
+
+        // CLASS REF NAME
+
+        if (t[i].kind == TOKEN_IDENT && i + 1 < n && _is(t[i+1], "ref"))
+        {
+            scan.deps.push_back(t[i].text);
+            continue;
+        }
+
+        // instance of CLASS
+
+        if (_is(t[i], "instance") && i + 2 < n && _is(t[i+1], "of") &&
+            t[i+2].kind == TOKEN_IDENT)
+        {
+            scan.deps.push_back(t[i+2].text);
+            continue;
+        }
+
+        // EmbeddedInstance ("CLASS")
+
+        if (_is(t[i], "EmbeddedInstance") && i + 2 < n && _is(t[i+1], '(') &&
+            t[i+2].kind == TOKEN_STRING)
+        {
+            scan.deps.push_back(t[i+2].text);
+            continue;
+        }
+    }
+
+    return 0;
+}
+
+//==============================================================================
+//
+// Class-to-file index
+//
+//     CIM schema files are named after the one class they declare (for
+//     example, Core/CIM_ManagedElement.mof). Other included files (qualifier
+//     declarations, user MOF files) are always parsed, in their original
+//     order.
+//
+//==============================================================================
+
+static string _base_name(const string& path)
+{
+    size_t slash = path.rfind('/');
+    string base = slash == string::npos ? path : path.substr(slash + 1);
+    size_t dot = base.rfind('.');
+
+    if (dot != string::npos && MOF_stricmp(base.c_str() + dot, ".mof") == 0)
+        base.erase(dot);
+
+    return base;
+}
+
+static string _dir_name(const string& path)
+{
+    size_t slash = path.rfind('/');
+    return slash == string::npos ? string() : path.substr(0, slash);
+}
+
+static bool _is_class_file(const string& path)
+{
+    string base = _base_name(path);
+    size_t underscore = base.find('_');
+
+    if (underscore == 0 || underscore == string::npos || 
+        underscore + 1 == base.size() || 
+        strncasecmp(base.c_str(), "qualifiers", 10) == 0)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < base.size(); i++)
+    {
+        if (!isalnum((unsigned char)base[i]) && base[i] != '_')
+            return false;
+    }
+
+    return true;
+}
+
+// Resolves an included file the way the lexer does: relative to the including
+// file first, then along the include path.
+
+static string _resolve(const string& dir, const string& name)
+{
+    string file = name;
+
+    for (size_t i = 0; i < file.size(); i++)
+    {
+        if (file[i] == '\\')
+            file[i] = '/';
+    }
+
+    vector<string> dirs;
+
+    if (dir.size())
+        dirs.push_back(dir);
+
+    for (size_t i = 0; i < MOF_num_include_paths; i++)
+        dirs.push_back(MOF_include_paths[i]);
+
+    for (size_t i = 0; i < dirs.size(); i++)
+    {
+        string path = dirs[i] + "/" + file;
+        FILE* is = fopen(path.c_str(), "rb");
+
+        if (is)
+        {
+            fclose(is);
+            return path;
+        }
+    }
+
+    return string();
+}
+
+struct Loader
+{
+    map<string, string> index;
+    vector<string> always;
+    set<string> declared;
+    set<string> active;
+    vector<string> order;
+    bool ok;
+
+    Loader() : ok(true) { }
+
+    void expand(const string& path, const string& dir, bool root);
+    void require(const string& class_name);
+    void require_all(const vector<string>& deps);
+    void declare(const Scan& scan);
+};
+
+// Include lists (files made up only of #pragma include) are replaced by the
+// files they include. Anything else is parsed whole.
+
+void Loader::expand(const string& path, const string& dir, bool root)
+{
+    Scan scan;
+
+    if (_scan_file(path, scan) != 0)
+    {
+        ok = false;
+        return;
+    }
+
+    if (!scan.pragmas_only || scan.includes.empty())
+    {
+        always.push_back(path);
+        return;
+    }
+
+    MOF_note_file(path.c_str());
+
+    for (size_t i = 0; ok && i < scan.includes.size(); i++)
+    {
+        string file = _resolve(root ? dir : _dir_name(path), scan.includes[i]);
+
+        if (file.empty())
+            ok = false;
+        else if (!_is_class_file(file))
+            expand(file, dir, false);
+        else if (index.find(_lower(_base_name(file))) == index.end())
+            index[_lower(_base_name(file))] = file;
+    }
+}
+
+void Loader::declare(const Scan& scan)
+{
+    for (size_t i = 0; i < scan.classes.size(); i++)
+        declared.insert(_lower(scan.classes[i]));
+}
+
+void Loader::require_all(const vector<string>& deps)
+{
+    for (size_t i = 0; ok && i < deps.size(); i++)
+        require(deps[i]);
+}
+
+// Schedules the file declaring the given class after the files declaring
+// everything it depends on.
+
+void Loader::require(const string& class_name)
+{
+    string key = _lower(class_name);
+
+    if (declared.count(key) || active.count(key))
+        return;
+
+    map<string, string>::const_iterator pos = index.find(key);
+    Scan scan;
+
+    if (pos == index.end() || _scan_file(pos->second, scan) != 0)
+    {
+        ok = false;
+        return;
+    }
+
+    // The file must declare the class it is named after (and nothing from
+    // an include).
+
+    bool found = false;
+
+    for (size_t i = 0; i < scan.classes.size(); i++)
+    {
+        if (_lower(scan.classes[i]) == key)
+            found = true;
+    }
+
+    if (!found || !scan.includes.empty())
+    {
+        ok = false;
+        return;
+    }
+
+    active.insert(key);
+    require_all(scan.deps);
+    active.erase(key);
+
+    order.push_back(pos->second);
+    declare(scan);
+}
+
+//==============================================================================
+//
+// MOF_parse_classes()
+//
+//==============================================================================
+
+int MOF_parse_classes(
+    const char* const* mof_files, 
+    size_t num_mof_files,
+    const char* const* class_names, 
+    size_t num_class_names)
+{
+    Loader loader;
+
+    if (num_class_names)
+    {
+        double start = MOF_Profile::start();
+        string dir = MOF_current_dir ? MOF_current_dir : "";
+
+        for (size_t i = 0; loader.ok && i < num_mof_files; i++)
+            loader.expand(mof_files[i], dir, true);
+
+        // Files parsed whole first see the classes they depend on:
+
+        for (size_t i = 0; loader.ok && i < loader.always.size(); i++)
+        {
+            Scan scan;
+
+            if (_scan_file(loader.always[i], scan) != 0)
+            {
+                loader.ok = false;
+                break;
+            }
+
+            loader.declare(scan);
+            loader.require_all(scan.deps);
+            loader.order.push_back(loader.always[i]);
+        }
+
+        for (size_t i = 0; loader.ok && i < num_class_names; i++)
+            loader.require(class_names[i]);
+
+        MOF_Profile::stop(MOF_Profile::SCAN, start);
+    }
+
+    // Anything the index cannot account for falls back to a full parse:
+
+    if (!num_class_names || !loader.ok)
+    {
+        for (size_t i = 0; i < num_mof_files; i++)
+            MOF_parse_file(mof_files[i]);
+
+        return 0;
+    }
+
+    for (size_t i = 0; i < loader.order.size(); i++)
+        MOF_parse_file(loader.order[i].c_str());
+
+    return 0;
+}
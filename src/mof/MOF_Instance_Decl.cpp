@@ -26,6 +26,8 @@
 */
 
 #include "MOF_Instance_Decl.h"
+#include "MOF_Arena.h"
+#include "MOF_Profile.h"
 #include "MOF_Class_Decl.h"
 #include "MOF_Error.h"
 #include "MOF_Indent.h"
@@ -34,18 +36,19 @@
 #include "REF_Parser.h"
 
 MOF_Instance_Decl* MOF_Instance_Decl::list = 0;
+static MOF_Instance_Decl* _list_tail = 0;
 
 MOF_Instance_Decl::MOF_Instance_Decl() : inst_name(0), class_name(0), 
     class_decl(0), alias(0), properties(0), all_features(0)
 {
-
+    MOF_Profile::nodes[MOF_Profile::INSTANCE_DECL]++;
 }
 
 MOF_Instance_Decl::~MOF_Instance_Decl()
 {
-    free(inst_name);
-    free(class_name);
-    free(alias);
+    MOF_free(inst_name);
+    MOF_free(class_name);
+    MOF_free(alias);
     properties->delete_list();
     all_features->delete_list();
 }
@@ -105,7 +108,7 @@ void _make_obj_ref(
      * Set class name:
      */
 
-    if ((obj_ref->class_name = strdup(inst_decl->class_name)) == 0)
+    if ((obj_ref->class_name = MOF_strdup(inst_decl->class_name)) == 0)
     {
         MOF_error("out of memory");
         return;
@@ -147,7 +150,7 @@ void _make_obj_ref(
              * Initialize MOF_Key_Value_Pair object.
              */
 
-            if ((pair->key = strdup(feature->name)) == 0)
+            if ((pair->key = MOF_strdup(feature->name)) == 0)
             {
                 MOF_error("out of memory");
                 return;
@@ -284,6 +287,7 @@ static void _build_all_features_list(
 {
     MOF_Feature_Info* p;
     MOF_Feature_Info* all_features = 0;
+    MOF_Feature_Info* tail = 0;
     MOF_Property* q;
 
     /*
@@ -302,7 +306,7 @@ static void _build_all_features_list(
 
         for (q = inst_decl->properties; q; q = (MOF_Property*)q->next)
         {
-            if (MOF_stricmp(feature->name, q->name) == 0)
+            if (feature->symbol() == q->symbol())
             {
                 inst_prop = q;
                 break;
@@ -504,10 +508,7 @@ static void _build_all_features_list(
          * Append to list:
          */
 
-        if (all_features)
-            all_features->append(new_feature_info);
-        else
-            all_features = new_feature_info;
+        MOF_append(all_features, tail, new_feature_info);
     }
 
     inst_decl->all_features = all_features;
@@ -535,7 +536,7 @@ static void _check_undefined_properties(
         {
             MOF_Feature* feature = q->feature;
 
-            if (MOF_stricmp(p->name, feature->name) == 0)
+            if (p->symbol() == feature->symbol())
             {
                 MOF_fix_case(p->name, feature->name);
 
@@ -565,7 +566,7 @@ static void _check_duplicate_properties(
     {
         for (q = inst_decl->properties; q != p; q = (MOF_Property*)q->next)
         {
-            if (MOF_stricmp(p->name, q->name) == 0)
+            if (p->symbol() == q->symbol())
                 MOF_error_printf("duplicate property: \"%s\"", p->name);
         }
     }
@@ -671,10 +672,7 @@ void MOF_Instance_Decl::handle(MOF_Instance_Decl* inst_decl)
      * Append instance to list:
      */
 
-    if (MOF_Instance_Decl::list)
-        MOF_Instance_Decl::list->append(inst_decl);
-    else
-        MOF_Instance_Decl::list = inst_decl;
+    MOF_append(MOF_Instance_Decl::list, _list_tail, inst_decl);
 
 #if 0
     _print(inst_decl);
@@ -709,6 +707,12 @@ void MOF_Instance_Decl::print() const
     printf("+ instance %s (%s)\n", inst_name, class_name);
 }
 
+void MOF_Instance_Decl::reset_list()
+{
+    list = 0;
+    _list_tail = 0;
+}
+
 void MOF_Instance_Decl::print_static_list()
 {
     MOF_Instance_Decl* p = MOF_Instance_Decl::list; 
@@ -60,6 +60,9 @@ public:
 
     static void print_static_list();
 
+    /* See MOF_Class_Decl::reset_list() */
+    static void reset_list();
+
     static MOF_Instance_Decl* list;
     char* inst_name;
     char* class_name;
@@ -26,6 +26,7 @@
 */
 
 #include "MOF_Key_Value_Pair.h"
+#include "MOF_Arena.h"
 #include "MOF_Feature_Info.h"
 #include "MOF_Class_Decl.h"
 #include "MOF_String.h"
@@ -36,7 +37,7 @@ MOF_Element* MOF_Key_Value_Pair::clone() const
 {
     MOF_Key_Value_Pair* tmp = new MOF_Key_Value_Pair;
 
-    tmp->key = strdup(key);
+    tmp->key = MOF_strdup(key);
     tmp->value = (MOF_Literal*)value->clone();
     tmp->is_array = is_array;
 
@@ -45,13 +46,14 @@ MOF_Element* MOF_Key_Value_Pair::clone() const
 
 MOF_Key_Value_Pair::~MOF_Key_Value_Pair()
 {
-    free(key);
+    MOF_free(key);
     delete value;
 }
 
 void MOF_Key_Value_Pair::validate(MOF_Class_Decl* class_decl)
 {
     MOF_Feature_Info* p;
+    const MOF_Symbol* sym = MOF_intern(key);
     int data_type = 0;
     int array_index = 0;
     bool is_key = false;
@@ -63,7 +65,7 @@ void MOF_Key_Value_Pair::validate(MOF_Class_Decl* class_decl)
 
     for (p = class_decl->all_features; p; p = (MOF_Feature_Info*)p->next)
     {
-        if (MOF_stricmp(p->feature->name, key) == 0)
+        if (p->feature->symbol() == sym)
         {
             if (p->feature->type == MOF_FEATURE_PROP)
             {
@@ -130,8 +132,8 @@ void MOF_Key_Value_Pair::validate(MOF_Class_Decl* class_decl)
             char* str = MOF_Object_Reference::normalize(value->string_value);
             MOF_ASSERT(str != 0);
 
-            free(value->string_value);
-            value->string_value = str;
+            MOF_free(value->string_value);
+            value->string_value = MOF_arena_string(str);
         }
     }
 }
@@ -31,12 +31,16 @@
 #include "MOF_Config.h"
 #include "MOF_Element.h"
 #include "MOF_Literal.h"
+#include "MOF_Profile.h"
 
 class MOF_LINKAGE MOF_Key_Value_Pair : public MOF_Element
 {
 public:
 
-    MOF_Key_Value_Pair() : key(0), value(0), is_array(false) { }
+    MOF_Key_Value_Pair() : key(0), value(0), is_array(false)
+    {
+        MOF_Profile::nodes[MOF_Profile::KEY_VALUE_PAIR]++;
+    }
 
     ~MOF_Key_Value_Pair();
 
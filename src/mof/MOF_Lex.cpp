@@ -587,6 +587,8 @@ char *yytext;
 #include <string.h>
 #include "MOF_Types.h"
 #include "MOF_Parser.h"
+#include "MOF_Profile.h"
+#include "MOF_Arena.h"
 #include "MOF_Yacc.h"
 #include "MOF_Lex_Utils.h"
 
@@ -1360,7 +1362,7 @@ YY_RULE_SETUP
 #line 442 "MOF.l"
 {
 
-    if ((MOF_lval.string_value = strdup(yytext)) == NULL)
+    if ((MOF_lval.string_value = MOF_strndup(yytext, yyleng)) == NULL)
 	MOF_error("out of memory");
 
     return TOK_IDENT;
@@ -1371,7 +1373,7 @@ YY_RULE_SETUP
 #line 450 "MOF.l"
 {
 
-    if ((MOF_lval.string_value = strdup(yytext)) == NULL)
+    if ((MOF_lval.string_value = MOF_strndup(yytext, yyleng)) == NULL)
 	MOF_error("out of memory");
 
     return TOK_ALIAS_IDENT;
@@ -2385,6 +2387,8 @@ static FILE* _find_and_open_included_file(
             *current_dir = '\0';
             strncat(current_dir, path, p - path);
             *current_dir_out = current_dir;
+            MOF_note_file(path);
+            MOF_Profile::enter_file(path);
 
 	    return stream;
         }
@@ -2413,6 +2417,8 @@ static FILE* _find_and_open_included_file(
             *current_dir = '\0';
             strncat(current_dir, path, p - path);
             *current_dir_out = current_dir;
+            MOF_note_file(path);
+            MOF_Profile::enter_file(path);
 
 	    return stream;
         }
@@ -2480,6 +2486,7 @@ int pop_include_file()
     {
 	free(MOF_file_name);
 	free(MOF_current_dir);
+	MOF_Profile::leave_file(ftell(YY_CURRENT_BUFFER->yy_input_file));
 	fclose(YY_CURRENT_BUFFER->yy_input_file);
 
 	yy_delete_buffer(YY_CURRENT_BUFFER);
@@ -26,6 +26,7 @@
 */
 
 #include "MOF_Literal.h"
+#include "MOF_Arena.h"
 #include "MOF_Yacc.h"
 #include "MOF_Error.h"
 #include "MOF_String.h"
@@ -35,7 +36,7 @@ MOF_Literal::~MOF_Literal()
     MOF_ASSERT(this != 0);
 
     if (value_type == TOK_STRING_VALUE)
-        free(string_value);
+        MOF_free(string_value);
 }
 
 static bool _test_value(
@@ -453,7 +454,7 @@ MOF_Element* MOF_Literal::clone() const
     tmp->value_type = value_type;
 
     if (value_type == TOK_STRING_VALUE)
-        tmp->string_value = strdup(string_value);
+        tmp->string_value = MOF_strdup(string_value);
     else
         tmp->int_value = int_value;
 
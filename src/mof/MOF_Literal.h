@@ -30,12 +30,17 @@
 
 #include "MOF_Config.h"
 #include "MOF_Element.h"
+#include "MOF_Profile.h"
 
 class MOF_LINKAGE MOF_Literal : public MOF_Element
 {
 public:
 
-    MOF_Literal() : value_type(0) { int_value = 0; }
+    MOF_Literal() : value_type(0)
+    {
+        int_value = 0;
+        MOF_Profile::nodes[MOF_Profile::LITERAL]++;
+    }
 
     virtual ~MOF_Literal();
 
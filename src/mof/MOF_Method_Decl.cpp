@@ -26,13 +26,14 @@
 */
 
 #include "MOF_Method_Decl.h"
+#include "MOF_Profile.h"
 #include "MOF_Error.h"
 #include "MOF_Data_Type.h"
 #include "MOF_Indent.h"
 
 MOF_Method_Decl::MOF_Method_Decl() : data_type(0), parameters(0) 
-{ 
-
+{
+    MOF_Profile::nodes[MOF_Profile::METHOD_DECL]++;
 }
 
 void MOF_Method_Decl::print() const
@@ -26,8 +26,9 @@
 */
 
 #include "MOF_Named_Element.h"
+#include "MOF_Arena.h"
 
-MOF_Named_Element::MOF_Named_Element() : name(0)
+MOF_Named_Element::MOF_Named_Element() : name(0), _symbol(0)
 {
 
 }
@@ -35,5 +36,5 @@ MOF_Named_Element::MOF_Named_Element() : name(0)
 MOF_Named_Element::~MOF_Named_Element()
 {
     if (name)
-        free(name);
+        MOF_free(name);
 }
@@ -30,6 +30,7 @@
 
 #include "MOF_Config.h"
 #include "MOF_Element.h"
+#include "MOF_Symbol.h"
 
 class MOF_LINKAGE MOF_Named_Element : public MOF_Element
 {
@@ -41,7 +42,20 @@ public:
 
     virtual MOF_Element* clone() const = 0;
 
+    /* The interned name (looked up the first time it is needed, or by
+       MOF_freeze()) */
+    const MOF_Symbol* symbol() const
+    {
+        if (!_symbol)
+            _symbol = MOF_intern(name);
+        return _symbol;
+    }
+
     char* name;
+
+private:
+
+    mutable const MOF_Symbol* _symbol;
 };
 
 #endif /*_MOF_Named_Element_h */
@@ -27,6 +27,8 @@
 
 #include <vector>
 #include "MOF_Object_Reference.h"
+#include "MOF_Arena.h"
+#include "MOF_Arena.h"
 #include "MOF_Error.h"
 #include "MOF_String.h"
 #include "MOF_Yacc.h"
@@ -36,12 +38,26 @@
 MOF_Object_Reference::~MOF_Object_Reference()
 {
     if (class_name)
-        free(class_name);
+        MOF_free(class_name);
 
     if (pairs)
         pairs->delete_list();
 }
 
+void* MOF_Object_Reference::operator new(size_t size)
+{
+    if (MOF_Arena::current)
+        return MOF_Arena::current->allocate(size);
+
+    return ::operator new(size);
+}
+
+void MOF_Object_Reference::operator delete(void* p)
+{
+    if (!MOF_Arena::contains(p))
+        ::operator delete(p);
+}
+
 void MOF_Object_Reference::validate()
 {
     MOF_Class_Decl* class_decl;
@@ -131,10 +147,7 @@ void MOF_Object_Reference::normalize()
          */
 
         for (i = 0; i < count; i++)
-            tmp_pairs[i]->next = 0;
-
-        for (i = 1; i < count; i++)
-            tmp_pairs[i-1]->append(tmp_pairs[i]);
+            tmp_pairs[i]->next = i + 1 < count ? tmp_pairs[i+1] : 0;
 
         MOF_ASSERT(tmp_pairs[0]->list_size() == count);
 
@@ -32,15 +32,24 @@
 #include "MOF_Element.h"
 #include "MOF_Literal.h"
 #include "MOF_Key_Value_Pair.h"
+#include "MOF_Profile.h"
 
 class MOF_LINKAGE MOF_Object_Reference
 {
 public:
 
-    MOF_Object_Reference() : class_name(0), pairs(0) { }
+    MOF_Object_Reference() : class_name(0), pairs(0)
+    {
+        MOF_Profile::nodes[MOF_Profile::OBJECT_REFERENCE]++;
+    }
 
     ~MOF_Object_Reference();
 
+    /* From the current MOF_Arena, if there is one */
+    static void* operator new(size_t size);
+
+    static void operator delete(void* p);
+
     void validate();
 
     void normalize();
@@ -41,7 +41,7 @@ int MOF_Parameter::compatible(
     MOF_Parameter* p1,
     MOF_Parameter* p2)
 {
-    if (MOF_stricmp(p1->name, p2->name) != 0)
+    if (p1->symbol() != p2->symbol())
         return -1;
 
     if (strcmp(p1->name, p2->name) != 0)
@@ -96,7 +96,7 @@ void MOF_Parameter::check_duplicates() const
     {
         for (q = this; q != p; q = (MOF_Parameter*)q->next)
         {
-            if (MOF_stricmp(p->name, q->name) == 0)
+            if (p->symbol() == q->symbol())
                 MOF_error_printf("duplicate parameter: \"%s\"", p->name);
         }
     }
@@ -32,12 +32,16 @@
 #include "MOF_Qualified_Element.h"
 #include "MOF_Qualifier.h"
 #include "MOF_Qualifier_Info.h"
+#include "MOF_Profile.h"
 
 class MOF_LINKAGE MOF_Parameter : public MOF_Qualified_Element
 {
 public:
 
-    MOF_Parameter() : data_type(0), ref_name(0) { }
+    MOF_Parameter() : data_type(0), ref_name(0)
+    {
+        MOF_Profile::nodes[MOF_Profile::PARAMETER]++;
+    }
 
     virtual MOF_Element* clone() const;
 
@@ -27,6 +27,7 @@
 
 #include <cstdio>
 #include "MOF_Parser.h"
+#include "MOF_Profile.h"
 
 using namespace std;
 
@@ -104,6 +105,9 @@ int MOF_parse_file(const char* mof_file)
         exit(1);
     }
 
+    MOF_note_file(mof_file);
+    MOF_Profile::enter_file(mof_file);
+
     // Parse the file.
 
     MOF_line_num = 1;
@@ -112,6 +116,7 @@ int MOF_parse_file(const char* mof_file)
 
     // Close the file.
 
+    MOF_Profile::leave_file(ftell(MOF_in));
     fclose(MOF_in);
     return 0;
 }
@@ -55,4 +55,55 @@ MOF_LINKAGE extern size_t MOF_num_generate_classes;
 MOF_LINKAGE FILE* MOF_open_file(const char* path, std::string& full_path);
 MOF_LINKAGE int MOF_parse_file(const char* mof_file);
 
+/* Records a file that the parser read (the lexer calls it for includes) */
+MOF_LINKAGE void MOF_note_file(const char* path);
+
+/* The files read by the parser (or that a repository loaded in their place
+   was built from), sorted and without duplicates */
+MOF_LINKAGE size_t MOF_num_files_read();
+MOF_LINKAGE const char* MOF_file_read(size_t i);
+
+/* Parses only as much of the given MOF files as the given classes need: the
+   files declaring them, their super classes, REF targets and EmbeddedInstance
+   classes (found through the include list, since CIM schema files are named
+   after their class). Falls back to parsing everything if some class cannot
+   be found that way. With no class names, parses all the files. */
+MOF_LINKAGE int MOF_parse_classes(
+    const char* const* mof_files, 
+    size_t num_mof_files,
+    const char* const* class_names, 
+    size_t num_class_names);
+
+/* Parses the given MOF files, or loads them from a precompiled repository in
+   cache_dir if one was written for the same files (and every file they
+   include is unchanged). A null or empty cache_dir disables the cache. */
+MOF_LINKAGE int MOF_parse_files_cached(
+    const char* const* mof_files, 
+    size_t num_mof_files,
+    const char* cache_dir);
+
+/* Like MOF_parse_files_cached() but with MOF_parse_classes() */
+MOF_LINKAGE int MOF_parse_classes_cached(
+    const char* const* mof_files, 
+    size_t num_mof_files,
+    const char* const* class_names, 
+    size_t num_class_names,
+    const char* cache_dir);
+
+MOF_LINKAGE int MOF_parse_file_cached(
+    const char* mof_file, 
+    const char* cache_dir);
+
+/* Until MOF_free_arena(), parse-tree nodes and their strings come from large
+   blocks rather than one malloc each. MOF_free_arena() releases them all at
+   once and empties the class, qualifier and instance lists, so nothing from
+   the session may be used afterwards. */
+MOF_LINKAGE void MOF_begin_arena();
+MOF_LINKAGE void MOF_free_arena();
+
+/* Looks up the symbol of every class, qualifier and instance element now
+   rather than on first use, after which the model may be shared read-only
+   between threads. Call it again after parsing or loading more. */
+MOF_LINKAGE void MOF_freeze();
+
 #endif /* _MOF_Parser_h */
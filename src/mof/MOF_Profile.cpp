@@ -0,0 +1,124 @@
+/*
+**==============================================================================
+**
+** Copyright (c) 2003, 2004, 2005, 2006, Michael Brasher, Karl Schopmeyer
+** Copyright (c) 2008, Michael E. Brasher
+** 
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+** 
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+** 
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+**==============================================================================
+*/
+
+#include "MOF_Profile.h"
+#include <time.h>
+
+bool MOF_Profile::enabled = false;
+size_t MOF_Profile::nodes[MOF_Profile::NUM_NODES];
+double MOF_Profile::phase_seconds[MOF_Profile::NUM_PHASES];
+size_t MOF_Profile::phase_calls[MOF_Profile::NUM_PHASES];
+std::vector<MOF_Profile::File> MOF_Profile::files;
+
+// The files being read, innermost last: index into files, when it started
+// and how long its includes took.
+
+struct Open_File
+{
+    size_t index;
+    double start;
+    double child_seconds;
+};
+
+static std::vector<Open_File> _open_files;
+
+const char* MOF_Profile::node_name(size_t node)
+{
+    static const char* const NAMES[NUM_NODES] =
+    {
+        "class_decl",
+        "instance_decl",
+        "qualifier_decl",
+        "property_decl",
+        "reference_decl",
+        "method_decl",
+        "parameter",
+        "property",
+        "qualifier",
+        "qualifier_info",
+        "feature_info",
+        "literal",
+        "key_value_pair",
+        "object_reference",
+    };
+
+    return node < NUM_NODES ? NAMES[node] : 0;
+}
+
+const char* MOF_Profile::phase_name(size_t phase)
+{
+    static const char* const NAMES[NUM_PHASES] =
+    {
+        "scan",
+        "validate_class",
+        "build_all_features",
+        "make_all_qualifiers",
+    };
+
+    return phase < NUM_PHASES ? NAMES[phase] : 0;
+}
+
+double MOF_Profile::now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void MOF_Profile::enter_file(const char* path)
+{
+    if (!enabled)
+        return;
+
+    File file;
+    file.path = path;
+    file.depth = _open_files.size();
+    file.bytes = 0;
+    file.seconds = 0;
+    file.self_seconds = 0;
+
+    Open_File open_file = { files.size(), now(), 0 };
+    files.push_back(file);
+    _open_files.push_back(open_file);
+}
+
+void MOF_Profile::leave_file(long bytes)
+{
+    if (!enabled || _open_files.empty())
+        return;
+
+    Open_File open_file = _open_files.back();
+    _open_files.pop_back();
+
+    File& file = files[open_file.index];
+    file.bytes = bytes;
+    file.seconds = now() - open_file.start;
+    file.self_seconds = file.seconds - open_file.child_seconds;
+
+    if (!_open_files.empty())
+        _open_files.back().child_seconds += file.seconds;
+}
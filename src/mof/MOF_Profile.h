@@ -0,0 +1,116 @@
+/*
+**==============================================================================
+**
+** Copyright (c) 2003, 2004, 2005, 2006, Michael Brasher, Karl Schopmeyer
+** Copyright (c) 2008, Michael E. Brasher
+** 
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+** 
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+** 
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+**==============================================================================
+*/
+
+#ifndef _MOF_Profile_h
+#define _MOF_Profile_h
+
+#include "MOF_Config.h"
+
+#ifndef SWIG
+#include <string>
+#include <vector>
+#endif
+
+/* Measurements for konkret --profile. The node counts are always kept (the
+   constructors bump them); the timings only when enabled is set. */
+struct MOF_LINKAGE MOF_Profile
+{
+    /* Parse-tree nodes, by type */
+    enum Node
+    {
+        CLASS_DECL,
+        INSTANCE_DECL,
+        QUALIFIER_DECL,
+        PROPERTY_DECL,
+        REFERENCE_DECL,
+        METHOD_DECL,
+        PARAMETER,
+        PROPERTY,
+        QUALIFIER,
+        QUALIFIER_INFO,
+        FEATURE_INFO,
+        LITERAL,
+        KEY_VALUE_PAIR,
+        OBJECT_REFERENCE,
+        NUM_NODES
+    };
+
+    /* Parts of parsing (these overlap: validating a class builds its
+       features, which makes qualifier lists) */
+    enum Phase
+    {
+        SCAN,
+        VALIDATE_CLASS,
+        BUILD_ALL_FEATURES,
+        MAKE_ALL_QUALIFIERS,
+        NUM_PHASES
+    };
+
+    /* A MOF file the lexer read (the same file may appear more than once) */
+    struct File
+    {
+        std::string path;
+        size_t depth;
+        long bytes;
+        double seconds;
+        double self_seconds;
+    };
+
+    static bool enabled;
+    static size_t nodes[NUM_NODES];
+    static double phase_seconds[NUM_PHASES];
+    static size_t phase_calls[NUM_PHASES];
+    static std::vector<File> files;
+
+    static const char* node_name(size_t node);
+    static const char* phase_name(size_t phase);
+
+    /* Monotonic clock in seconds */
+    static double now();
+
+    /* Returns now() if enabled (and 0 if not), to pass to stop() */
+    static double start()
+    {
+        return enabled ? now() : 0;
+    }
+
+    static void stop(Phase phase, double start)
+    {
+        if (enabled)
+        {
+            phase_seconds[phase] += now() - start;
+            phase_calls[phase]++;
+        }
+    }
+
+    /* The lexer calls these as it starts and finishes each file (bytes is
+       the offset it stopped at) */
+    static void enter_file(const char* path);
+    static void leave_file(long bytes);
+};
+
+#endif /* _MOF_Profile_h */
@@ -31,11 +31,17 @@
 #include "MOF_Config.h"
 #include "MOF_Qualified_Element.h"
 #include "MOF_Literal.h"
+#include "MOF_Profile.h"
 
 class MOF_LINKAGE MOF_Property : public MOF_Qualified_Element
 {
 public:
 
+    MOF_Property()
+    {
+        MOF_Profile::nodes[MOF_Profile::PROPERTY]++;
+    }
+
     virtual MOF_Element* clone() const;
 
     void print() const;
@@ -26,6 +26,8 @@
 */
 
 #include "MOF_Property_Decl.h"
+#include "MOF_Arena.h"
+#include "MOF_Profile.h"
 #include "MOF_String.h"
 #include "MOF_Error.h"
 #include "MOF_Qualifier_Decl.h"
@@ -35,7 +37,8 @@
 
 MOF_Property_Decl::MOF_Property_Decl() 
     : data_type(0), array_index(0), initializer(0) 
-{ 
+{
+    MOF_Profile::nodes[MOF_Profile::PROPERTY_DECL]++;
 }
 
 void MOF_Property_Decl::print() const
@@ -75,7 +78,7 @@ MOF_Element* MOF_Property_Decl::clone() const
         return 0;
 
     tmp->type = type;
-    tmp->name = strdup(name);
+    tmp->name = MOF_strdup(name);
     tmp->qualifiers = qualifiers;
     tmp->all_qualifiers = all_qualifiers;
     tmp->qual_mask = qual_mask;
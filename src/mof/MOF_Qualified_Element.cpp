@@ -26,6 +26,7 @@
 */
 
 #include "MOF_Qualified_Element.h"
+#include "MOF_Arena.h"
 
 MOF_Qualified_Element::MOF_Qualified_Element() 
     : qualifiers(0), all_qualifiers(0), qual_mask(0), owning_class(0)
@@ -35,12 +36,12 @@ MOF_Qualified_Element::MOF_Qualified_Element()
 
 MOF_Qualified_Element::~MOF_Qualified_Element()
 {
-    free(owning_class);
+    MOF_free(owning_class);
 }
 
 void MOF_Qualified_Element::set_owning_class(const char* owning_class_)
 {
-    owning_class = strdup(owning_class_);
+    owning_class = MOF_strdup(owning_class_);
 
     for (MOF_Qualifier* q = qualifiers; q; q = (MOF_Qualifier*)q->next)
         q->set_owning_class(owning_class_);
@@ -26,6 +26,8 @@
 */
 
 #include "MOF_Qualifier.h"
+#include "MOF_Arena.h"
+#include "MOF_Profile.h"
 #include "MOF_Error.h"
 #include "MOF_Yacc.h"
 #include "MOF_String.h"
@@ -41,8 +43,10 @@
 **------------------------------------------------------------------------------
 */
 
-MOF_Qualifier::MOF_Qualifier() : name(0), params(0), flavor(0), owning_class(0)
+MOF_Qualifier::MOF_Qualifier() :
+    name(0), params(0), flavor(0), owning_class(0), _symbol(0)
 {
+    MOF_Profile::nodes[MOF_Profile::QUALIFIER]++;
 }
 
 /*
@@ -55,8 +59,8 @@ MOF_Qualifier::MOF_Qualifier() : name(0), params(0), flavor(0), owning_class(0)
 
 MOF_Qualifier::~MOF_Qualifier()
 {
-    free(name);
-    free(owning_class);
+    MOF_free(name);
+    MOF_free(owning_class);
     params->delete_list();
 }
 
@@ -71,7 +75,7 @@ MOF_Qualifier::~MOF_Qualifier()
 MOF_Element* MOF_Qualifier::clone() const
 {
     MOF_Qualifier* tmp = new MOF_Qualifier();
-    tmp->name = strdup(name);
+    tmp->name = MOF_strdup(name);
     tmp->params = (MOF_Literal*)params->clone();
     tmp->owning_class = 0;
     return tmp;
@@ -205,7 +209,7 @@ void MOF_Qualifier::validate_list(int expected_scope)
     {
         for (q = this; q != p; q = (MOF_Qualifier*)q->next)
         {
-            if (strcmp(p->name, q->name) == 0)
+            if (p->symbol() == q->symbol())
                 MOF_error_printf("duplicate qualifier: \"%s\"", p->name);
         }
     }
@@ -236,9 +240,10 @@ void MOF_Qualifier::validate_list(int expected_scope)
 
 MOF_Qualifier *MOF_Qualifier::get(const char* name)
 {
+    const MOF_Symbol* sym = MOF_intern(name);
     MOF_Qualifier* p;
     for (p = this; p != 0; p = (MOF_Qualifier*)p->next) {
-        if (strcasecmp(p->name, name) == 0) {
+        if (p->symbol() == sym) {
             return p;
         }
     }
@@ -247,9 +252,10 @@ MOF_Qualifier *MOF_Qualifier::get(const char* name)
 
 bool MOF_Qualifier::has_key(const char* name)
 {
+    const MOF_Symbol* sym = MOF_intern(name);
     MOF_Qualifier* p;
     for (p = this; p != 0; p = (MOF_Qualifier*)p->next) {
-        if (strcasecmp(p->name, name) == 0) {
+        if (p->symbol() == sym) {
             return true;
         }
     }
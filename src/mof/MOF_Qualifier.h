@@ -30,6 +30,8 @@
 
 #include "MOF_Config.h"
 #include "MOF_Element.h"
+#include "MOF_Arena.h"
+#include "MOF_Symbol.h"
 #include "MOF_Literal.h"
 
 class MOF_Qualifier;
@@ -54,16 +56,29 @@ public:
 
     void set_owning_class(const char* owning_class_)
     {
-        owning_class = strdup(owning_class_);
+        owning_class = MOF_strdup(owning_class_);
     }
 
     MOF_Qualifier *get(const char *name);
     bool has_key(const char *name);
 
+    /* The interned name (looked up the first time it is needed, or by
+       MOF_freeze()) */
+    const MOF_Symbol* symbol() const
+    {
+        if (!_symbol)
+            _symbol = MOF_intern(name);
+        return _symbol;
+    }
+
     char* name;
     class MOF_Literal* params;
     MOF_mask flavor;
     char* owning_class;
+
+private:
+
+    mutable const MOF_Symbol* _symbol;
 };
 
 #endif /* _MOF_Qualifier_h */
@@ -26,15 +26,18 @@
 */
 
 #include "MOF_Qualifier_Decl.h"
+#include "MOF_Arena.h"
+#include "MOF_Profile.h"
 #include "MOF_Error.h"
 #include "MOF_String.h"
 
 MOF_Qualifier_Decl* MOF_Qualifier_Decl::list = 0;
+static MOF_Qualifier_Decl* _list_tail = 0;
 
 MOF_Qualifier_Decl::MOF_Qualifier_Decl()
     : data_type(0), array_index(0), initializer(0), scope(0), flavor(0)
 {
-
+    MOF_Profile::nodes[MOF_Profile::QUALIFIER_DECL]++;
 }
 
 MOF_Qualifier_Decl::~MOF_Qualifier_Decl()
@@ -45,7 +48,7 @@ MOF_Qualifier_Decl::~MOF_Qualifier_Decl()
 MOF_Element* MOF_Qualifier_Decl::clone() const
 {
     MOF_Qualifier_Decl* tmp = new MOF_Qualifier_Decl();
-    tmp->name = strdup(name);
+    tmp->name = MOF_strdup(name);
     tmp->data_type = data_type;
     tmp->array_index = array_index;
     tmp->initializer = (MOF_Literal*)initializer->clone();
@@ -57,11 +60,12 @@ MOF_Element* MOF_Qualifier_Decl::clone() const
 
 MOF_Qualifier_Decl* MOF_Qualifier_Decl::find(char* name)
 {
+    const MOF_Symbol* sym = MOF_intern(name);
     MOF_Qualifier_Decl* p;
 
     for (p = MOF_Qualifier_Decl::list; p; p = (MOF_Qualifier_Decl*)p->next)
     {
-        if (MOF_stricmp(p->name, name) == 0)
+        if (p->symbol() == sym)
         {
             if (strcmp(name, p->name) != 0)
             {
@@ -102,10 +106,7 @@ void MOF_Qualifier_Decl::handle(MOF_Qualifier_Decl* qual_decl)
 {
     qual_decl->validate();
 
-    if (MOF_Qualifier_Decl::list == 0)
-        MOF_Qualifier_Decl::list = qual_decl;
-    else
-        MOF_Qualifier_Decl::list->append(qual_decl);
+    MOF_append(MOF_Qualifier_Decl::list, _list_tail, qual_decl);
 }
 
 void MOF_Qualifier_Decl::print() const
@@ -113,6 +114,12 @@ void MOF_Qualifier_Decl::print() const
     printf("+ qualifier %s\n", name);
 }
 
+void MOF_Qualifier_Decl::reset_list()
+{
+    list = 0;
+    _list_tail = 0;
+}
+
 void MOF_Qualifier_Decl::print_static_list()
 {
     MOF_Qualifier_Decl* p = MOF_Qualifier_Decl::list; 
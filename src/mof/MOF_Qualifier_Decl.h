@@ -97,6 +97,9 @@ public:
 
     static MOF_Qualifier_Decl* find(char* name);
 
+    /* See MOF_Class_Decl::reset_list() */
+    static void reset_list();
+
     static MOF_Qualifier_Decl* list;
 
     int data_type;
@@ -26,6 +26,7 @@
 */
 
 #include "MOF_Qualifier_Info.h"
+#include "MOF_Profile.h"
 #include "MOF_Yacc.h"
 #include "MOF_Class_Decl.h"
 #include "MOF_Error.h"
@@ -35,7 +36,7 @@
 MOF_Qualifier_Info::MOF_Qualifier_Info() 
     : qualifier(0), flavor(0), propagated(false)
 {
-
+    MOF_Profile::nodes[MOF_Profile::QUALIFIER_INFO]++;
 }
 
 MOF_Qualifier_Info::~MOF_Qualifier_Info()
@@ -49,43 +50,41 @@ MOF_Element* MOF_Qualifier_Info::clone() const
     return 0;
 }
 
-struct MOF_Pair
-{
-    const char* name;
-    MOF_uint32 mask;
-};
+/*
+ * Qualifier bits indexed by MOF_Qualifier_ID (see MOF_Symbol.h).
+ */
 
-static MOF_Pair _pairs[] =
+static const MOF_mask _masks[MOF_QID_COUNT] =
 {
-    { "Abstract", MOF_QT_ABSTRACT },
-    { "Aggregate", MOF_QT_AGGREGATE },
-    { "Aggregation", MOF_QT_AGGREGATION },
-    { "Association", MOF_QT_ASSOCIATION },
-    { "Counter", MOF_QT_COUNTER },
-    { "Delete", MOF_QT_DELETE },
-    { "DN", MOF_QT_DN },
-    { "EmbeddedObject", MOF_QT_EMBEDDEDOBJECT },
-    { "Expensive", MOF_QT_EXPENSIVE },
-    { "Experimental", MOF_QT_EXPERIMENTAL },
-    { "Gauge", MOF_QT_GAUGE },
-    { "Ifdeleted", MOF_QT_IFDELETED },
-    { "In", MOF_QT_IN },
-    { "Indication", MOF_QT_INDICATION },
-    { "Invisible", MOF_QT_INVISIBLE },
-    { "Key", MOF_QT_KEY },
-    { "Large", MOF_QT_LARGE },
-    { "Octetstring", MOF_QT_OCTETSTRING },
-    { "Out", MOF_QT_OUT },
-    { "Read", MOF_QT_READ },
-    { "Required", MOF_QT_REQUIRED },
-    { "Static", MOF_QT_STATIC },
-    { "Terminal", MOF_QT_TERMINAL },
-    { "Weak", MOF_QT_WEAK },
-    { "Write", MOF_QT_WRITE }
+    0,
+    MOF_QT_ABSTRACT,
+    MOF_QT_AGGREGATE,
+    MOF_QT_AGGREGATION,
+    MOF_QT_ASSOCIATION,
+    MOF_QT_COUNTER,
+    MOF_QT_DELETE,
+    MOF_QT_DN,
+    MOF_QT_EMBEDDEDOBJECT,
+    MOF_QT_EXPENSIVE,
+    MOF_QT_EXPERIMENTAL,
+    MOF_QT_GAUGE,
+    MOF_QT_IFDELETED,
+    MOF_QT_IN,
+    MOF_QT_INDICATION,
+    MOF_QT_INVISIBLE,
+    MOF_QT_KEY,
+    MOF_QT_LARGE,
+    MOF_QT_OCTETSTRING,
+    MOF_QT_OUT,
+    MOF_QT_READ,
+    MOF_QT_REQUIRED,
+    MOF_QT_STATIC,
+    MOF_QT_TERMINAL,
+    MOF_QT_WEAK,
+    MOF_QT_WRITE,
+    0, /* MOF_QID_EMBEDDEDINSTANCE */
 };
 
-static const size_t NUM_PAIRS = (sizeof(_pairs) / sizeof(_pairs[0]));
-
 static MOF_mask _make_qual_mask(
     MOF_Qualifier_Info* qual_info_list,
     bool prop,
@@ -93,7 +92,6 @@ static MOF_mask _make_qual_mask(
 {
     MOF_Qualifier_Info* p;
     MOF_mask mask = 0;
-    size_t i;
 
     /*
      * Set bits for qualifiers whose default is true.
@@ -112,29 +110,27 @@ static MOF_mask _make_qual_mask(
 
     for (p = qual_info_list; p != 0; p = (MOF_Qualifier_Info*)p->next)
     {
-        for (i = 0; i < NUM_PAIRS; i++)
-        {
-            if (MOF_stricmp(_pairs[i].name, p->qualifier->name) == 0)
-            {
-                MOF_Literal* lit = p->qualifier->params;
-                bool flag = true;
+        MOF_mask bit = _masks[p->qualifier->symbol()->qual_id];
+        MOF_Literal* lit = p->qualifier->params;
+        bool flag = true;
 
-                /* 
-                 * Ignore errors (these are checked elsewhere). 
-                 */
+        if (!bit)
+            continue;
 
-                if (lit && (lit->next || lit->value_type != TOK_BOOL_VALUE))
-                    continue;
+        /* 
+         * Ignore errors (these are checked elsewhere). 
+         */
 
-                if (lit && !lit->bool_value)
-                    flag = false;
+        if (lit && (lit->next || lit->value_type != TOK_BOOL_VALUE))
+            continue;
 
-                if (flag)
-                    mask |= _pairs[i].mask;
-                else
-                    mask &= ~_pairs[i].mask;
-            }
-        }
+        if (lit && !lit->bool_value)
+            flag = false;
+
+        if (flag)
+            mask |= bit;
+        else
+            mask &= ~bit;
     }
 
     return mask;
@@ -142,13 +138,13 @@ static MOF_mask _make_qual_mask(
 
 MOF_Qualifier_Info* _find(
     MOF_Qualifier_Info* qual_info_list,
-    const char* name)
+    const MOF_Symbol* sym)
 {
     MOF_Qualifier_Info* p;
 
     for (p = qual_info_list; p; p = (MOF_Qualifier_Info*)p->next)
     {
-        if (strcmp(p->qualifier->name, name) == 0)
+        if (p->qualifier->symbol() == sym)
             return p;
     }
 
@@ -181,8 +177,10 @@ MOF_Qualifier_Info* MOF_Qualifier_Info::make_all_qualifiers(
     bool prop)
 {
     MOF_Qualifier_Info* all_qualifiers_list = 0;
+    MOF_Qualifier_Info* tail = 0;
     MOF_Qualifier_Info* qi;
     MOF_Qualifier* q;
+    double start = MOF_Profile::start();
 
     /*
      * Check for illegal qualifier overrides and append local qualifiers to
@@ -209,7 +207,7 @@ MOF_Qualifier_Info* MOF_Qualifier_Info::make_all_qualifiers(
          * attempt to change the value:
          */
 
-        qi = _find(inherited_qual_info_list, q->name);
+        qi = _find(inherited_qual_info_list, q->symbol());
 
         if (qi && 
             (qi->flavor & MOF_FLAVOR_DISABLEOVERRIDE) &&
@@ -258,10 +256,7 @@ MOF_Qualifier_Info* MOF_Qualifier_Info::make_all_qualifiers(
         else
             new_qi->flavor = MOF_Flavor::merge(q->flavor, qual_decl->flavor);
 
-        if (all_qualifiers_list == 0)
-            all_qualifiers_list = new_qi;
-        else
-            all_qualifiers_list->append(new_qi);
+        MOF_append(all_qualifiers_list, tail, new_qi);
     }
 
     /*
@@ -276,17 +271,14 @@ MOF_Qualifier_Info* MOF_Qualifier_Info::make_all_qualifiers(
          */
 
         if ((qi->flavor & MOF_FLAVOR_TOSUBCLASS) && 
-            !_find(all_qualifiers_list, qi->qualifier->name))
+            !_find(all_qualifiers_list, qi->qualifier->symbol()))
         {
             MOF_Qualifier_Info* new_qi;
             
             if ((new_qi = _clone_propagated(qi)) == 0)
                 MOF_error_printf("out of memory");
 
-            if (all_qualifiers_list == 0)
-                all_qualifiers_list = new_qi;
-            else
-                all_qualifiers_list->append(new_qi);
+            MOF_append(all_qualifiers_list, tail, new_qi);
         }
     }
 
@@ -296,6 +288,7 @@ MOF_Qualifier_Info* MOF_Qualifier_Info::make_all_qualifiers(
 
     *qual_mask = _make_qual_mask(all_qualifiers_list, prop, param_name != 0);
 
+    MOF_Profile::stop(MOF_Profile::MAKE_ALL_QUALIFIERS, start);
     return all_qualifiers_list;
 }
 
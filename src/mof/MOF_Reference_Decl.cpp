@@ -26,6 +26,7 @@
 */
 
 #include "MOF_Reference_Decl.h"
+#include "MOF_Profile.h"
 #include "MOF_Error.h"
 #include "MOF_Indent.h"
 #include "MOF_Class_Decl.h"
@@ -33,7 +34,8 @@
 
 MOF_Reference_Decl::MOF_Reference_Decl() 
     : class_name(0), class_decl(0), alias(0), obj_ref(0) 
-{ 
+{
+    MOF_Profile::nodes[MOF_Profile::REFERENCE_DECL]++;
 }
 
 void MOF_Reference_Decl::print() const
@@ -0,0 +1,1064 @@
+/*
+**==============================================================================
+**
+** Copyright (c) 2003, 2004, 2005, 2006, Michael Brasher, Karl Schopmeyer
+** Copyright (c) 2008, Michael E. Brasher
+** 
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+** 
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+** 
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+**==============================================================================
+*/
+
+#include "MOF_Repository.h"
+#include "MOF_Arena.h"
+#include "MOF_Parser.h"
+#include "MOF_Types.h"
+#include "MOF_Yacc.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <climits>
+#include <cerrno>
+#include <cctype>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+using namespace std;
+
+#define REPOSITORY_MAGIC "KMOFREP"
+#define REPOSITORY_VERSION 1
+#define REPOSITORY_BYTE_ORDER 0x01020304
+#define NULL_STRING 0xFFFFFFFF
+#define NULL_ID 0xFFFFFFFF
+
+#define FNV_INIT 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+//==============================================================================
+//
+// Files read by the parser
+//
+//==============================================================================
+
+static vector<string> _files;
+
+void MOF_note_file(const char* path)
+{
+    char buf[PATH_MAX];
+
+    if (realpath(path, buf))
+        _files.push_back(buf);
+    else
+        _files.push_back(path);
+}
+
+static void _sort_files()
+{
+    sort(_files.begin(), _files.end());
+    _files.erase(unique(_files.begin(), _files.end()), _files.end());
+}
+
+size_t MOF_num_files_read()
+{
+    _sort_files();
+    return _files.size();
+}
+
+const char* MOF_file_read(size_t i)
+{
+    return i < _files.size() ? _files[i].c_str() : 0;
+}
+
+static MOF_uint64 _hash_bytes(MOF_uint64 h, const void* data, size_t size)
+{
+    const unsigned char* p = (const unsigned char*)data;
+
+    while (size--)
+    {
+        h ^= *p++;
+        h *= FNV_PRIME;
+    }
+
+    return h;
+}
+
+static int _hash_file(const char* path, MOF_uint64* size, MOF_uint64* hash)
+{
+    struct stat st;
+    int fd;
+
+    if ((fd = open(path, O_RDONLY)) < 0)
+        return -1;
+
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    *size = st.st_size;
+    *hash = FNV_INIT;
+
+    if (st.st_size)
+    {
+        void* data = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (data == MAP_FAILED)
+        {
+            close(fd);
+            return -1;
+        }
+
+        *hash = _hash_bytes(*hash, data, st.st_size);
+        munmap(data, st.st_size);
+    }
+
+    close(fd);
+    return 0;
+}
+
+//==============================================================================
+//
+// Writer
+//
+//     Objects that are shared between classes (features and qualifiers) are
+//     written where they are owned and referred to by their index elsewhere.
+//     Classes are written in declaration order, so an object is always
+//     written before anything that refers to it (apart from the classes named
+//     by references, which are fixed up at the end).
+//
+//==============================================================================
+
+class Writer
+{
+public:
+
+    Writer() : num_qualifiers(0), num_features(0) { }
+
+    void put(const void* data, size_t size)
+    {
+        buf.append((const char*)data, size);
+    }
+
+    void put_u8(MOF_uint8 x) { put(&x, sizeof(x)); }
+
+    void put_u32(MOF_uint32 x) { put(&x, sizeof(x)); }
+
+    void put_s32(MOF_sint32 x) { put(&x, sizeof(x)); }
+
+    void put_u64(MOF_uint64 x) { put(&x, sizeof(x)); }
+
+    void put_str(const char* s)
+    {
+        if (s)
+        {
+            MOF_uint32 n = strlen(s);
+            put_u32(n);
+            put(s, n);
+        }
+        else
+            put_u32(NULL_STRING);
+    }
+
+    string buf;
+    map<const void*, MOF_uint32> qualifier_ids;
+    map<const void*, MOF_uint32> feature_ids;
+    map<const void*, MOF_uint32> class_ids;
+    MOF_uint32 num_qualifiers;
+    MOF_uint32 num_features;
+};
+
+static void _put_literals(Writer& w, const MOF_Literal* p)
+{
+    w.put_u32(p ? p->list_size() : 0);
+
+    for (; p; p = (const MOF_Literal*)p->next)
+    {
+        w.put_s32(p->value_type);
+
+        switch (p->value_type)
+        {
+            case TOK_INT_VALUE:
+                w.put_u64(p->int_value);
+                break;
+
+            case TOK_REAL_VALUE:
+                w.put(&p->real_value, sizeof(p->real_value));
+                break;
+
+            case TOK_CHAR_VALUE:
+                w.put_u32(p->char_value);
+                break;
+
+            case TOK_BOOL_VALUE:
+                w.put_u8(p->bool_value);
+                break;
+
+            case TOK_STRING_VALUE:
+                w.put_str(p->string_value);
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+static void _put_element(Writer& w, const MOF_Qualified_Element* e)
+{
+    w.put_str(e->name);
+    w.put_str(e->owning_class);
+    w.put_u32(e->qual_mask);
+    w.put_u32(e->qualifiers ? e->qualifiers->list_size() : 0);
+
+    for (const MOF_Qualifier* q = e->qualifiers; q; 
+        q = (const MOF_Qualifier*)q->next)
+    {
+        w.put_str(q->name);
+        w.put_str(q->owning_class);
+        w.put_u32(q->flavor);
+        _put_literals(w, q->params);
+        w.qualifier_ids[q] = w.num_qualifiers++;
+    }
+}
+
+static int _put_qualifier_infos(Writer& w, const MOF_Qualifier_Info* p)
+{
+    w.put_u32(p ? p->list_size() : 0);
+
+    for (; p; p = (const MOF_Qualifier_Info*)p->next)
+    {
+        map<const void*, MOF_uint32>::const_iterator i = 
+            w.qualifier_ids.find(p->qualifier);
+
+        if (i == w.qualifier_ids.end())
+            return -1;
+
+        w.put_u32(i->second);
+        w.put_u32(p->flavor);
+        w.put_u8(p->propagated);
+    }
+
+    return 0;
+}
+
+static MOF_uint32 _class_id(Writer& w, const MOF_Class_Decl* cd)
+{
+    map<const void*, MOF_uint32>::const_iterator i = w.class_ids.find(cd);
+    return i == w.class_ids.end() ? NULL_ID : i->second;
+}
+
+static int _put_feature(Writer& w, const MOF_Feature* f)
+{
+    w.put_s32(f->type);
+    _put_element(w, f);
+
+    switch (f->type)
+    {
+        case MOF_FEATURE_PROP:
+        {
+            const MOF_Property_Decl* p = (const MOF_Property_Decl*)f;
+            w.put_s32(p->data_type);
+            w.put_s32(p->array_index);
+            _put_literals(w, p->initializer);
+            break;
+        }
+
+        case MOF_FEATURE_REF:
+        {
+            const MOF_Reference_Decl* r = (const MOF_Reference_Decl*)f;
+            w.put_str(r->class_name);
+            w.put_str(r->alias);
+            w.put_u32(_class_id(w, r->class_decl));
+            w.put_u8(r->obj_ref != 0);
+
+            if (r->obj_ref)
+            {
+                const MOF_Key_Value_Pair* p = r->obj_ref->pairs;
+
+                w.put_str(r->obj_ref->class_name);
+                w.put_u32(p ? p->list_size() : 0);
+
+                for (; p; p = (const MOF_Key_Value_Pair*)p->next)
+                {
+                    w.put_str(p->key);
+                    w.put_u8(p->is_array);
+                    _put_literals(w, p->value);
+                }
+            }
+            break;
+        }
+
+        case MOF_FEATURE_METHOD:
+        {
+            const MOF_Method_Decl* m = (const MOF_Method_Decl*)f;
+            const MOF_Parameter* p = m->parameters;
+
+            w.put_s32(m->data_type);
+            w.put_u32(p ? p->list_size() : 0);
+
+            for (; p; p = (const MOF_Parameter*)p->next)
+            {
+                _put_element(w, p);
+                w.put_s32(p->data_type);
+                w.put_s32(p->array_index);
+                w.put_str(p->ref_name);
+
+                if (_put_qualifier_infos(w, p->all_qualifiers) != 0)
+                    return -1;
+            }
+            break;
+        }
+
+        default:
+            return -1;
+    }
+
+    w.feature_ids[f] = w.num_features++;
+    return _put_qualifier_infos(w, f->all_qualifiers);
+}
+
+static int _put_class(Writer& w, const MOF_Class_Decl* cd)
+{
+    _put_element(w, cd);
+    w.put_str(cd->alias);
+    w.put_str(cd->super_class_name);
+    w.put_str(cd->file_name);
+    w.put_u32(_class_id(w, cd->super_class));
+
+    // Local features:
+
+    w.put_u32(cd->features ? cd->features->list_size() : 0);
+
+    for (const MOF_Feature* f = cd->features; f; f = (const MOF_Feature*)f->next)
+    {
+        if (_put_feature(w, f) != 0)
+            return -1;
+    }
+
+    if (_put_qualifier_infos(w, cd->all_qualifiers) != 0)
+        return -1;
+
+    // All features (including the inherited ones):
+
+    const MOF_Feature_Info* p = cd->all_features;
+
+    w.put_u32(p ? p->list_size() : 0);
+
+    for (; p; p = (const MOF_Feature_Info*)p->next)
+    {
+        map<const void*, MOF_uint32>::const_iterator i = 
+            w.feature_ids.find(p->feature);
+        MOF_uint32 origin = _class_id(w, p->class_origin);
+
+        if (i == w.feature_ids.end() || origin == NULL_ID)
+            return -1;
+
+        w.put_u32(i->second);
+        w.put_u32(origin);
+        w.put_u8(p->propagated);
+    }
+
+    return 0;
+}
+
+int MOF_write_repository(const char* path)
+{
+    Writer w;
+
+    // Instances are not part of the repository.
+
+    if (MOF_Instance_Decl::list)
+        return -1;
+
+    // Header:
+
+    w.put(REPOSITORY_MAGIC, sizeof(REPOSITORY_MAGIC));
+    w.put_u32(REPOSITORY_VERSION);
+    w.put_u32(REPOSITORY_BYTE_ORDER);
+
+    // Files that went into it:
+
+    _sort_files();
+    const vector<string>& files = _files;
+
+    w.put_u32(files.size());
+
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        MOF_uint64 size;
+        MOF_uint64 hash;
+
+        if (_hash_file(files[i].c_str(), &size, &hash) != 0)
+            return -1;
+
+        w.put_str(files[i].c_str());
+        w.put_u64(size);
+        w.put_u64(hash);
+    }
+
+    // Qualifier declarations:
+
+    const MOF_Qualifier_Decl* qd = MOF_Qualifier_Decl::list;
+
+    w.put_u32(qd ? qd->list_size() : 0);
+
+    for (; qd; qd = (const MOF_Qualifier_Decl*)qd->next)
+    {
+        w.put_str(qd->name);
+        w.put_s32(qd->data_type);
+        w.put_s32(qd->array_index);
+        _put_literals(w, qd->initializer);
+        w.put_u32(qd->scope);
+        w.put_u32(qd->flavor);
+    }
+
+    // Classes:
+
+    const MOF_Class_Decl* cd;
+    MOF_uint32 num_classes = 0;
+
+    for (cd = MOF_Class_Decl::list; cd; cd = (const MOF_Class_Decl*)cd->next)
+        w.class_ids[cd] = num_classes++;
+
+    w.put_u32(num_classes);
+
+    for (cd = MOF_Class_Decl::list; cd; cd = (const MOF_Class_Decl*)cd->next)
+    {
+        if (_put_class(w, cd) != 0)
+            return -1;
+    }
+
+    // Write to a temporary file and rename it into place, so that readers
+    // never see a partial repository:
+
+    char tmp[MOF_PATH_SIZE];
+    snprintf(tmp, sizeof(tmp), "%s.%d", path, (int)getpid());
+
+    FILE* os = fopen(tmp, "wb");
+
+    if (!os)
+        return -1;
+
+    if (fwrite(w.buf.data(), 1, w.buf.size(), os) != w.buf.size())
+    {
+        fclose(os);
+        unlink(tmp);
+        return -1;
+    }
+
+    if (fclose(os) != 0 || rename(tmp, path) != 0)
+    {
+        unlink(tmp);
+        return -1;
+    }
+
+    return 0;
+}
+
+//==============================================================================
+//
+// Reader
+//
+//     Decodes a mapped repository. Strings are copied out of the mapping
+//     since the objects own (and eventually free) them. Any inconsistency
+//     makes the whole repository invalid.
+//
+//==============================================================================
+
+class Reader
+{
+public:
+
+    Reader(const char* data, size_t size) 
+        : _p(data), _end(data + size), _ok(true) { }
+
+    bool ok() const { return _ok; }
+
+    void fail() { _ok = false; }
+
+    void get(void* data, size_t size)
+    {
+        if (!_ok || (size_t)(_end - _p) < size)
+        {
+            _ok = false;
+            memset(data, 0, size);
+            return;
+        }
+
+        memcpy(data, _p, size);
+        _p += size;
+    }
+
+    MOF_uint8 get_u8() { MOF_uint8 x; get(&x, sizeof(x)); return x; }
+
+    MOF_uint32 get_u32() { MOF_uint32 x; get(&x, sizeof(x)); return x; }
+
+    MOF_sint32 get_s32() { MOF_sint32 x; get(&x, sizeof(x)); return x; }
+
+    MOF_uint64 get_u64() { MOF_uint64 x; get(&x, sizeof(x)); return x; }
+
+    // A count of items, each of which takes at least one byte:
+
+    MOF_uint32 get_count()
+    {
+        MOF_uint32 n = get_u32();
+
+        if (n > (size_t)(_end - _p))
+        {
+            _ok = false;
+            return 0;
+        }
+
+        return n;
+    }
+
+    char* get_str()
+    {
+        MOF_uint32 n = get_u32();
+
+        if (!_ok || n == NULL_STRING)
+            return 0;
+
+        if ((size_t)(_end - _p) < n)
+        {
+            _ok = false;
+            return 0;
+        }
+
+        char* s = MOF_strndup(_p, n);
+        _p += n;
+        return s;
+    }
+
+    vector<MOF_Qualifier*> qualifiers;
+    vector<MOF_Feature*> features;
+    vector<MOF_Class_Decl*> classes;
+    vector<pair<MOF_Reference_Decl*, MOF_uint32> > refs;
+
+private:
+    const char* _p;
+    const char* _end;
+    bool _ok;
+};
+
+static MOF_Literal* _get_literals(Reader& r)
+{
+    MOF_Literal* head = 0;
+    MOF_Literal* tail = 0;
+
+    for (MOF_uint32 n = r.get_count(); n && r.ok(); n--)
+    {
+        MOF_Literal* lit = new MOF_Literal();
+        int value_type = r.get_s32();
+
+        switch (value_type)
+        {
+            case TOK_INT_VALUE:
+                lit->int_value = (MOF_sint64)r.get_u64();
+                break;
+
+            case TOK_REAL_VALUE:
+                r.get(&lit->real_value, sizeof(lit->real_value));
+                break;
+
+            case TOK_CHAR_VALUE:
+                lit->char_value = (MOF_char16)r.get_u32();
+                break;
+
+            case TOK_BOOL_VALUE:
+                lit->bool_value = r.get_u8() != 0;
+                break;
+
+            case TOK_NULL_VALUE:
+                break;
+
+            case TOK_STRING_VALUE:
+                lit->string_value = r.get_str();
+                break;
+
+            default:
+                r.fail();
+                value_type = TOK_NULL_VALUE;
+                break;
+        }
+
+        lit->value_type = value_type;
+        MOF_append(head, tail, lit);
+    }
+
+    return head;
+}
+
+static void _get_element(Reader& r, MOF_Qualified_Element* e)
+{
+    MOF_Qualifier* tail = 0;
+
+    e->name = r.get_str();
+    e->owning_class = r.get_str();
+    e->qual_mask = r.get_u32();
+
+    for (MOF_uint32 n = r.get_count(); n && r.ok(); n--)
+    {
+        MOF_Qualifier* q = new MOF_Qualifier();
+        q->name = r.get_str();
+        q->owning_class = r.get_str();
+        q->flavor = r.get_u32();
+        q->params = _get_literals(r);
+        MOF_append(e->qualifiers, tail, q);
+        r.qualifiers.push_back(q);
+    }
+}
+
+static MOF_Qualifier_Info* _get_qualifier_infos(Reader& r)
+{
+    MOF_Qualifier_Info* head = 0;
+    MOF_Qualifier_Info* tail = 0;
+
+    for (MOF_uint32 n = r.get_count(); n && r.ok(); n--)
+    {
+        MOF_uint32 id = r.get_u32();
+
+        if (id >= r.qualifiers.size())
+        {
+            r.fail();
+            break;
+        }
+
+        MOF_Qualifier_Info* qi = new MOF_Qualifier_Info();
+        qi->qualifier = r.qualifiers[id];
+        qi->flavor = r.get_u32();
+        qi->propagated = r.get_u8() != 0;
+        MOF_append(head, tail, qi);
+    }
+
+    return head;
+}
+
+static MOF_Feature* _get_feature(Reader& r)
+{
+    MOF_Feature* f;
+    int type = r.get_s32();
+
+    switch (type)
+    {
+        case MOF_FEATURE_PROP:
+        {
+            MOF_Property_Decl* p = new MOF_Property_Decl();
+            _get_element(r, p);
+            p->data_type = r.get_s32();
+            p->array_index = r.get_s32();
+            p->initializer = _get_literals(r);
+            f = p;
+            break;
+        }
+
+        case MOF_FEATURE_REF:
+        {
+            MOF_Reference_Decl* ref = new MOF_Reference_Decl();
+            _get_element(r, ref);
+            ref->class_name = r.get_str();
+            ref->alias = r.get_str();
+            r.refs.push_back(make_pair(ref, r.get_u32()));
+
+            if (r.get_u8())
+            {
+                MOF_Key_Value_Pair* tail = 0;
+
+                ref->obj_ref = new MOF_Object_Reference();
+                ref->obj_ref->class_name = r.get_str();
+
+                for (MOF_uint32 n = r.get_count(); n && r.ok(); n--)
+                {
+                    MOF_Key_Value_Pair* p = new MOF_Key_Value_Pair();
+                    p->key = r.get_str();
+                    p->is_array = r.get_u8() != 0;
+                    p->value = _get_literals(r);
+                    MOF_append(ref->obj_ref->pairs, tail, p);
+                }
+            }
+            f = ref;
+            break;
+        }
+
+        case MOF_FEATURE_METHOD:
+        {
+            MOF_Method_Decl* m = new MOF_Method_Decl();
+            MOF_Parameter* tail = 0;
+
+            _get_element(r, m);
+            m->data_type = r.get_s32();
+
+            for (MOF_uint32 n = r.get_count(); n && r.ok(); n--)
+            {
+                MOF_Parameter* p = new MOF_Parameter();
+                _get_element(r, p);
+                p->data_type = r.get_s32();
+                p->array_index = r.get_s32();
+                p->ref_name = r.get_str();
+                p->all_qualifiers = _get_qualifier_infos(r);
+                MOF_append(m->parameters, tail, p);
+            }
+            f = m;
+            break;
+        }
+
+        default:
+            r.fail();
+            return 0;
+    }
+
+    f->type = type;
+    r.features.push_back(f);
+    f->all_qualifiers = _get_qualifier_infos(r);
+    return f;
+}
+
+static MOF_Class_Decl* _get_class(Reader& r)
+{
+    MOF_Class_Decl* cd = new MOF_Class_Decl();
+    MOF_Feature* tail = 0;
+    MOF_Feature_Info* info_tail = 0;
+
+    _get_element(r, cd);
+    cd->alias = r.get_str();
+    cd->super_class_name = r.get_str();
+    cd->file_name = r.get_str();
+
+    MOF_uint32 super_id = r.get_u32();
+
+    if (super_id != NULL_ID)
+    {
+        if (super_id >= r.classes.size())
+            r.fail();
+        else
+            cd->super_class = r.classes[super_id];
+    }
+
+    r.classes.push_back(cd);
+
+    // Local features:
+
+    for (MOF_uint32 n = r.get_count(); n && r.ok(); n--)
+    {
+        MOF_Feature* f = _get_feature(r);
+
+        if (f)
+            MOF_append(cd->features, tail, f);
+    }
+
+    cd->all_qualifiers = _get_qualifier_infos(r);
+
+    // All features:
+
+    for (MOF_uint32 n = r.get_count(); n && r.ok(); n--)
+    {
+        MOF_uint32 feature_id = r.get_u32();
+        MOF_uint32 origin_id = r.get_u32();
+        bool propagated = r.get_u8() != 0;
+
+        if (feature_id >= r.features.size() || origin_id >= r.classes.size())
+        {
+            r.fail();
+            break;
+        }
+
+        MOF_Feature_Info* info = new MOF_Feature_Info();
+        info->feature = r.features[feature_id];
+        info->class_origin = r.classes[origin_id];
+        info->propagated = propagated;
+        MOF_append(cd->all_features, info_tail, info);
+    }
+
+    return cd;
+}
+
+static int _check_files(Reader& r, vector<string>& files)
+{
+    for (MOF_uint32 n = r.get_count(); n && r.ok(); n--)
+    {
+        char* path = r.get_str();
+        MOF_uint64 size = r.get_u64();
+        MOF_uint64 hash = r.get_u64();
+        MOF_uint64 tmp_size;
+        MOF_uint64 tmp_hash;
+        struct stat st;
+        int status = 0;
+
+        // Compare sizes before reading the file:
+
+        if (!path || stat(path, &st) != 0 || (MOF_uint64)st.st_size != size ||
+            _hash_file(path, &tmp_size, &tmp_hash) != 0 || tmp_hash != hash)
+        {
+            status = -1;
+        }
+        else
+            files.push_back(path);
+
+        MOF_free(path);
+
+        if (status != 0)
+            return -1;
+    }
+
+    return r.ok() ? 0 : -1;
+}
+
+static int _read(Reader& r)
+{
+    char magic[sizeof(REPOSITORY_MAGIC)];
+
+    // Header:
+
+    r.get(magic, sizeof(magic));
+
+    if (memcmp(magic, REPOSITORY_MAGIC, sizeof(magic)) != 0 ||
+        r.get_u32() != REPOSITORY_VERSION ||
+        r.get_u32() != REPOSITORY_BYTE_ORDER)
+    {
+        return -1;
+    }
+
+    // Reject the repository if any file it was built from has changed:
+
+    vector<string> files;
+
+    if (_check_files(r, files) != 0)
+        return -1;
+
+    // Qualifier declarations:
+
+    MOF_Qualifier_Decl* qd_head = 0;
+    MOF_Qualifier_Decl* qd_tail = 0;
+
+    for (MOF_uint32 n = r.get_count(); n && r.ok(); n--)
+    {
+        MOF_Qualifier_Decl* qd = new MOF_Qualifier_Decl();
+        qd->name = r.get_str();
+        qd->data_type = r.get_s32();
+        qd->array_index = r.get_s32();
+        qd->initializer = _get_literals(r);
+        qd->scope = r.get_u32();
+        qd->flavor = r.get_u32();
+        MOF_append(qd_head, qd_tail, qd);
+    }
+
+    // Classes:
+
+    MOF_Class_Decl* head = 0;
+    MOF_Class_Decl* tail = 0;
+
+    for (MOF_uint32 n = r.get_count(); n && r.ok(); n--)
+        MOF_append(head, tail, _get_class(r));
+
+    // Classes named by references:
+
+    for (size_t i = 0; i < r.refs.size(); i++)
+    {
+        MOF_uint32 id = r.refs[i].second;
+
+        if (id == NULL_ID)
+            continue;
+
+        if (id >= r.classes.size())
+            return -1;
+
+        r.refs[i].first->class_decl = r.classes[id];
+    }
+
+    // A corrupt repository leaks what was decoded before the error was
+    // found; the caller reparses the MOF files instead.
+
+    if (!r.ok())
+        return -1;
+
+    MOF_Qualifier_Decl::reset_list();
+    MOF_Class_Decl::reset_list();
+    MOF_Qualifier_Decl::list = qd_head;
+    MOF_Class_Decl::list = head;
+    _files = files;
+    return 0;
+}
+
+int MOF_read_repository(const char* path)
+{
+    struct stat st;
+    int fd;
+
+    if (MOF_Class_Decl::list || MOF_Qualifier_Decl::list)
+        return -1;
+
+    if ((fd = open(path, O_RDONLY)) < 0)
+        return -1;
+
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    void* data = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED)
+        return -1;
+
+    Reader r((const char*)data, st.st_size);
+    int status = _read(r);
+
+    munmap(data, st.st_size);
+    return status;
+}
+
+//==============================================================================
+//
+// MOF_parse_files_cached()
+//
+//==============================================================================
+
+static int _make_dirs(const char* path)
+{
+    string tmp = path;
+    struct stat st;
+
+    for (size_t i = 1; i <= tmp.size(); i++)
+    {
+        if (i == tmp.size() || tmp[i] == '/')
+        {
+            string dir = tmp.substr(0, i);
+
+            if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST)
+                return -1;
+        }
+    }
+
+    return stat(path, &st) == 0 && S_ISDIR(st.st_mode) ? 0 : -1;
+}
+
+static string _full_path(const char* path)
+{
+    char buf[PATH_MAX];
+    return realpath(path, buf) ? buf : path;
+}
+
+// The repository is named after the files it was built from, the include
+// path and the classes asked for (not their content, so that a changed schema
+// replaces its repository rather than adding another).
+
+static string _repository_path(
+    const char* const* mof_files, 
+    size_t num_mof_files,
+    const char* const* class_names, 
+    size_t num_class_names,
+    const char* cache_dir)
+{
+    MOF_uint64 h = FNV_INIT;
+    MOF_uint32 version = REPOSITORY_VERSION;
+    char name[64];
+
+    h = _hash_bytes(h, &version, sizeof(version));
+
+    for (size_t i = 0; i < num_mof_files; i++)
+    {
+        string path = _full_path(mof_files[i]);
+        h = _hash_bytes(h, path.c_str(), path.size() + 1);
+    }
+
+    for (size_t i = 0; i < MOF_num_include_paths; i++)
+    {
+        string path = _full_path(MOF_include_paths[i]);
+        h = _hash_bytes(h, path.c_str(), path.size() + 1);
+    }
+
+    // Class names are compared without regard to case or order:
+
+    vector<string> classes;
+
+    for (size_t i = 0; i < num_class_names; i++)
+    {
+        string cn = class_names[i];
+
+        for (size_t j = 0; j < cn.size(); j++)
+            cn[j] = tolower((unsigned char)cn[j]);
+
+        classes.push_back(cn);
+    }
+
+    sort(classes.begin(), classes.end());
+    classes.erase(unique(classes.begin(), classes.end()), classes.end());
+
+    for (size_t i = 0; i < classes.size(); i++)
+        h = _hash_bytes(h, classes[i].c_str(), classes[i].size() + 1);
+
+    sprintf(name, "/%016llx.mofrep", (unsigned long long)h);
+    return string(cache_dir) + name;
+}
+
+int MOF_parse_classes_cached(
+    const char* const* mof_files, 
+    size_t num_mof_files,
+    const char* const* class_names, 
+    size_t num_class_names,
+    const char* cache_dir)
+{
+    // The cache only applies to a complete parse from scratch:
+
+    bool cache = cache_dir && *cache_dir && 
+        !MOF_Class_Decl::list && !MOF_Qualifier_Decl::list;
+
+    string path;
+
+    if (cache)
+    {
+        path = _repository_path(mof_files, num_mof_files, 
+            class_names, num_class_names, cache_dir);
+
+        if (MOF_read_repository(path.c_str()) == 0)
+            return 0;
+    }
+
+    _files.clear();
+
+    MOF_parse_classes(mof_files, num_mof_files, class_names, num_class_names);
+
+    // Failing to write the repository only costs the next run a parse.
+
+    if (cache && _make_dirs(cache_dir) == 0)
+        MOF_write_repository(path.c_str());
+
+    return 0;
+}
+
+int MOF_parse_files_cached(
+    const char* const* mof_files, 
+    size_t num_mof_files,
+    const char* cache_dir)
+{
+    return MOF_parse_classes_cached(mof_files, num_mof_files, 0, 0, cache_dir);
+}
+
+int MOF_parse_file_cached(
+    const char* mof_file, 
+    const char* cache_dir)
+{
+    return MOF_parse_files_cached(&mof_file, 1, cache_dir);
+}
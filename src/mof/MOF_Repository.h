@@ -0,0 +1,53 @@
+/*
+**==============================================================================
+**
+** Copyright (c) 2003, 2004, 2005, 2006, Michael Brasher, Karl Schopmeyer
+** Copyright (c) 2008, Michael E. Brasher
+** 
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+** 
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+** 
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+**==============================================================================
+*/
+
+#ifndef _MOF_Repository_h
+#define _MOF_Repository_h
+
+#include "MOF_Config.h"
+
+/*
+ * A precompiled repository holds everything the parser produced for a set
+ * of MOF files: qualifier declarations and classes with their features,
+ * qualifiers and resolved inheritance (all_features, all_qualifiers). It
+ * also lists every file that was read together with a hash of its content,
+ * so a stale repository is detected and rejected.
+ *
+ * Repositories are machine-local caches: they are written in native byte
+ * order and carry no compatibility guarantee across versions.
+ */
+
+/* Writes the classes and qualifier declarations parsed so far. Returns zero
+   on success. */
+MOF_LINKAGE int MOF_write_repository(const char* path);
+
+/* Loads a repository written by MOF_write_repository() into the (empty)
+   class and qualifier declaration lists. Returns zero on success, or -1 if
+   the repository is missing, corrupt or stale. */
+MOF_LINKAGE int MOF_read_repository(const char* path);
+
+#endif /* _MOF_Repository_h */
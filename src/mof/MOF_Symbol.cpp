@@ -0,0 +1,273 @@
+/*
+**==============================================================================
+**
+** Copyright (c) 2003, 2004, 2005, 2006, Michael Brasher, Karl Schopmeyer
+** Copyright (c) 2008, Michael E. Brasher
+** 
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+** 
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+** 
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+**==============================================================================
+*/
+
+#include "MOF_Symbol.h"
+#include "MOF_String.h"
+#include "MOF_Parser.h"
+#include "MOF_Class_Decl.h"
+#include "MOF_Feature_Info.h"
+#include "MOF_Method_Decl.h"
+#include "MOF_Parameter.h"
+#include "MOF_Instance_Decl.h"
+#include "MOF_Property.h"
+#include "MOF_Qualifier_Info.h"
+#include <ctype.h>
+#include <pthread.h>
+
+// Guards the table (names are looked up while classes are generated in
+// parallel):
+
+static pthread_mutex_t _lock = PTHREAD_MUTEX_INITIALIZER;
+
+static MOF_Symbol** _table = 0;
+static size_t _table_size = 0;
+static size_t _count = 0;
+
+static const char* _well_known[MOF_QID_COUNT] =
+{
+    0,
+    "abstract",
+    "aggregate",
+    "aggregation",
+    "association",
+    "counter",
+    "delete",
+    "dn",
+    "embeddedobject",
+    "expensive",
+    "experimental",
+    "gauge",
+    "ifdeleted",
+    "in",
+    "indication",
+    "invisible",
+    "key",
+    "large",
+    "octetstring",
+    "out",
+    "read",
+    "required",
+    "static",
+    "terminal",
+    "weak",
+    "write",
+    "embeddedinstance",
+};
+
+static size_t _hash(const char* name, size_t* length)
+{
+    // FNV-1a over the lower-cased name:
+
+    size_t h = 2166136261u;
+    const char* p;
+
+    for (p = name; *p; p++)
+    {
+        h ^= (unsigned char)tolower((unsigned char)*p);
+        h *= 16777619u;
+    }
+
+    *length = p - name;
+    return h;
+}
+
+static void _grow()
+{
+    size_t new_size = _table_size ? _table_size * 2 : 1024;
+    MOF_Symbol** new_table = (MOF_Symbol**)calloc(new_size, sizeof(MOF_Symbol*));
+
+    if (!new_table)
+    {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+
+    for (size_t i = 0; i < _table_size; i++)
+    {
+        MOF_Symbol* next;
+
+        for (MOF_Symbol* p = _table[i]; p; p = next)
+        {
+            next = p->chain;
+            p->chain = new_table[p->hash & (new_size - 1)];
+            new_table[p->hash & (new_size - 1)] = p;
+        }
+    }
+
+    free(_table);
+    _table = new_table;
+    _table_size = new_size;
+}
+
+static const MOF_Symbol* _intern(const char* name)
+{
+    size_t length;
+    size_t h = _hash(name, &length);
+
+    if (_table_size)
+    {
+        for (MOF_Symbol* p = _table[h & (_table_size - 1)]; p; p = p->chain)
+        {
+            if (p->hash == h && MOF_stricmp(p->name, name) == 0)
+                return p;
+        }
+    }
+
+    if (_count >= _table_size)
+        _grow();
+
+    // The symbol and its name share one allocation:
+
+    MOF_Symbol* sym = (MOF_Symbol*)malloc(sizeof(MOF_Symbol) + length + 1);
+
+    if (!sym)
+    {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+
+    char* str = (char*)(sym + 1);
+
+    for (size_t i = 0; i <= length; i++)
+        str[i] = tolower((unsigned char)name[i]);
+
+    sym->name = str;
+    sym->qual_id = MOF_QID_NONE;
+    sym->hash = h;
+    sym->chain = _table[h & (_table_size - 1)];
+    _table[h & (_table_size - 1)] = sym;
+    _count++;
+
+    return sym;
+}
+
+const MOF_Symbol* MOF_intern(const char* name)
+{
+    pthread_mutex_lock(&_lock);
+
+    if (!_table)
+    {
+        for (int i = MOF_QID_NONE + 1; i < MOF_QID_COUNT; i++)
+            ((MOF_Symbol*)_intern(_well_known[i]))->qual_id = i;
+    }
+
+    const MOF_Symbol* sym = _intern(name);
+    pthread_mutex_unlock(&_lock);
+
+    return sym;
+}
+
+//==============================================================================
+//
+// MOF_freeze()
+//
+//     Elements look up their symbols on first use, which writes to them. So
+//     that threads may share the parsed (or loaded) model read-only, look up
+//     every symbol beforehand.
+//
+//==============================================================================
+
+static void _freeze(const MOF_Qualified_Element* e)
+{
+    // Instances have no name:
+
+    if (e->name)
+        e->symbol();
+
+    for (const MOF_Qualifier* q = e->qualifiers; q; 
+        q = (const MOF_Qualifier*)q->next)
+    {
+        q->symbol();
+    }
+
+    for (const MOF_Qualifier_Info* qi = e->all_qualifiers; qi;
+        qi = (const MOF_Qualifier_Info*)qi->next)
+    {
+        qi->qualifier->symbol();
+    }
+}
+
+static void _freeze_feature(const MOF_Feature* mf)
+{
+    _freeze(mf);
+
+    const MOF_Method_Decl* md = dynamic_cast<const MOF_Method_Decl*>(mf);
+
+    if (md)
+    {
+        for (const MOF_Parameter* p = md->parameters; p; 
+            p = (const MOF_Parameter*)p->next)
+        {
+            _freeze(p);
+        }
+    }
+}
+
+void MOF_freeze()
+{
+    for (const MOF_Qualifier_Decl* p = MOF_Qualifier_Decl::list; p; 
+        p = (const MOF_Qualifier_Decl*)p->next)
+    {
+        p->symbol();
+    }
+
+    for (const MOF_Class_Decl* p = MOF_Class_Decl::list; p; 
+        p = (const MOF_Class_Decl*)p->next)
+    {
+        _freeze(p);
+
+        for (const MOF_Feature* q = p->features; q; 
+            q = (const MOF_Feature*)q->next)
+        {
+            _freeze_feature(q);
+        }
+
+        for (const MOF_Feature_Info* q = p->all_features; q; 
+            q = (const MOF_Feature_Info*)q->next)
+        {
+            _freeze_feature(q->feature);
+        }
+    }
+
+    for (const MOF_Instance_Decl* p = MOF_Instance_Decl::list; p; 
+        p = (const MOF_Instance_Decl*)p->next)
+    {
+        _freeze(p);
+
+        for (const MOF_Property* q = p->properties; q; 
+            q = (const MOF_Property*)q->next)
+        {
+            _freeze(q);
+        }
+
+        for (const MOF_Feature_Info* q = p->all_features; q; 
+            q = (const MOF_Feature_Info*)q->next)
+        {
+            _freeze_feature(q->feature);
+        }
+    }
+}
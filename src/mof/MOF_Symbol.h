@@ -0,0 +1,85 @@
+/*
+**==============================================================================
+**
+** Copyright (c) 2003, 2004, 2005, 2006, Michael Brasher, Karl Schopmeyer
+** Copyright (c) 2008, Michael E. Brasher
+** 
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+** 
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+** 
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+**==============================================================================
+*/
+
+#ifndef _MOF_Symbol_h
+#define _MOF_Symbol_h
+
+#include "MOF_Config.h"
+
+/* Qualifiers the compiler itself acts upon. The first 25 are in the same
+   order as the MOF_QT_* bits (see MOF_Qualifier_Decl.h). */
+enum MOF_Qualifier_ID
+{
+    MOF_QID_NONE,
+    MOF_QID_ABSTRACT,
+    MOF_QID_AGGREGATE,
+    MOF_QID_AGGREGATION,
+    MOF_QID_ASSOCIATION,
+    MOF_QID_COUNTER,
+    MOF_QID_DELETE,
+    MOF_QID_DN,
+    MOF_QID_EMBEDDEDOBJECT,
+    MOF_QID_EXPENSIVE,
+    MOF_QID_EXPERIMENTAL,
+    MOF_QID_GAUGE,
+    MOF_QID_IFDELETED,
+    MOF_QID_IN,
+    MOF_QID_INDICATION,
+    MOF_QID_INVISIBLE,
+    MOF_QID_KEY,
+    MOF_QID_LARGE,
+    MOF_QID_OCTETSTRING,
+    MOF_QID_OUT,
+    MOF_QID_READ,
+    MOF_QID_REQUIRED,
+    MOF_QID_STATIC,
+    MOF_QID_TERMINAL,
+    MOF_QID_WEAK,
+    MOF_QID_WRITE,
+    MOF_QID_EMBEDDEDINSTANCE,
+    MOF_QID_COUNT
+};
+
+/* An interned identifier. There is exactly one symbol per identifier
+   (ignoring case), so two names are equal exactly when their symbols are the
+   same pointer. Symbols are never freed (they outlive any arena). */
+struct MOF_Symbol
+{
+    /* The name in lower case */
+    const char* name;
+
+    /* One of MOF_Qualifier_ID (MOF_QID_NONE for all other names) */
+    int qual_id;
+
+    size_t hash;
+    MOF_Symbol* chain;
+};
+
+/* Returns the symbol for this name (adding it if new); thread-safe */
+MOF_LINKAGE const MOF_Symbol* MOF_intern(const char* name);
+
+#endif /* _MOF_Symbol_h */
@@ -182,6 +182,7 @@
 
 #include <cassert>
 #include "MOF_Types.h"
+#include "MOF_Arena.h"
 #include "REF_Parser.h"
 
 extern int MOF_lex();
@@ -1509,7 +1510,7 @@ yyreduce:
 #line 314 "MOF.y"
     {
 	MOF_trace("name:2");
-	(yyval.string_value) = strdup((yyvsp[0].string_value));
+	(yyval.string_value) = MOF_strdup((yyvsp[0].string_value));
 	MOF_ASSERT((yyval.string_value) != NULL);
     ;}
     break;
@@ -1518,7 +1519,7 @@ yyreduce:
 #line 320 "MOF.y"
     {
 	MOF_trace("name:3");
-	(yyval.string_value) = strdup((yyvsp[0].string_value));
+	(yyval.string_value) = MOF_strdup((yyvsp[0].string_value));
 	MOF_ASSERT((yyval.string_value) != NULL);
     ;}
     break;
@@ -1527,7 +1528,7 @@ yyreduce:
 #line 326 "MOF.y"
     {
 	MOF_trace("name:4");
-	(yyval.string_value) = strdup((yyvsp[0].string_value));
+	(yyval.string_value) = MOF_strdup((yyvsp[0].string_value));
 	MOF_ASSERT((yyval.string_value) != NULL);
     ;}
     break;
@@ -1536,7 +1537,7 @@ yyreduce:
 #line 332 "MOF.y"
     {
 	MOF_trace("name:5");
-	(yyval.string_value) = strdup((yyvsp[0].string_value));
+	(yyval.string_value) = MOF_strdup((yyvsp[0].string_value));
 	MOF_ASSERT((yyval.string_value) != NULL);
     ;}
     break;
@@ -1886,7 +1887,7 @@ yyreduce:
     {
 	MOF_trace("class_decl:1");
 	(yyval.class_decl) = (yyvsp[-2].class_decl);
-	(yyval.class_decl)->file_name = MOF_file_name ? strdup(MOF_file_name) : NULL;
+	(yyval.class_decl)->file_name = MOF_file_name ? MOF_strdup(MOF_file_name) : NULL;
 	(yyval.class_decl)->qualifiers = NULL;
 	(yyval.class_decl)->features = (yyvsp[-1].feature);
     ;}
@@ -1897,7 +1898,7 @@ yyreduce:
     {
 	MOF_trace("class_decl:2");
 	(yyval.class_decl) = (yyvsp[-2].class_decl);
-	(yyval.class_decl)->file_name = MOF_file_name ? strdup(MOF_file_name) : NULL;
+	(yyval.class_decl)->file_name = MOF_file_name ? MOF_strdup(MOF_file_name) : NULL;
 	(yyval.class_decl)->qualifiers = (yyvsp[-3].qual);
 	(yyval.class_decl)->features = (yyvsp[-1].feature);
     ;}
@@ -2670,7 +2671,7 @@ yyreduce:
 	(yyval.literal) = new MOF_Literal();
 	MOF_ASSERT((yyval.literal) != NULL);
 	(yyval.literal)->value_type = TOK_STRING_VALUE;
-	(yyval.literal)->string_value = (yyvsp[0].string_literal).escaped;
+	(yyval.literal)->string_value = MOF_arena_string((yyvsp[0].string_literal).escaped);
         free((yyvsp[0].string_literal).raw);
     ;}
     break;
@@ -12,10 +12,12 @@
 
 %{
 #include "MOF_Parser.h"
+#include "MOF_Repository.h"
 #include "MOF_Types.h"
 %}
 
 %include "MOF_Parser.h"
+%include "MOF_Repository.h"
 %include "MOF_Types.h"
 
 // Add methods for casting to children
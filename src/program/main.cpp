@@ -32,6 +32,7 @@
 #include <dirent.h>
 #include "mof/MOF_Parser.h"
 #include "mof/MOF_Options.h"
+#include "mof/MOF_Profile.h"
 #include <vector>
 #include <string>
 #include <cctype>
@@ -42,7 +43,17 @@
 #include <cassert>
 #include <fstream>
 #include <unistd.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <pthread.h>
+#include <cerrno>
+#include <climits>
 #include <memory>
+#include <algorithm>
 
 using namespace std;
 
@@ -60,20 +71,41 @@ vector<map<string,string> > aall;
 
 string eta, eti, etn, etm;
 string ofile;
+string library;
 
 bool around = false;
+bool cxx = false;
+bool split = false;
+long jobs = 0;
+string depfile;
+vector<string> inputs;
+bool profile = false;
+string profile_path;
 
-static void transform(string &text, const MOF_Class_Decl* cd, const MOF_Method_Decl* md);
+string extemplate(const char *filename);
+static string render_method(const MOF_Class_Decl* cd, const MOF_Method_Decl* md);
 
 static void substitute(
     string& text, 
     const string& pattern, 
     const string& replacement)
 {
+    string result;
+    size_t start = 0;
     size_t pos;
 
-    while ((pos = text.find(pattern)) != size_t(-1))
-        text = text.substr(0, pos) + string(replacement) + text.substr(pos + strlen(pattern.c_str()));
+    while ((pos = text.find(pattern, start)) != string::npos)
+    {
+        result.append(text, start, pos - start);
+        result += replacement;
+        start = pos + pattern.size();
+    }
+
+    if (start == 0)
+        return;
+
+    result.append(text, start, string::npos);
+    text.swap(result);
 }
 
 static void err(const char* format, ...)
@@ -89,6 +121,118 @@ static void err(const char* format, ...)
     exit(1);
 }
 
+// Messages about generated files go through note(). While a worker generates
+// a class they are held back, so that gen() can print them in class order.
+
+static pthread_key_t _notes_key;
+static pthread_once_t _notes_once = PTHREAD_ONCE_INIT;
+
+static void _notes_init()
+{
+    pthread_key_create(&_notes_key, NULL);
+}
+
+static void note(const char* format, ...)
+{
+    va_list ap;
+
+    pthread_once(&_notes_once, _notes_init);
+    string* notes = (string*)pthread_getspecific(_notes_key);
+
+    va_start(ap, format);
+
+    if (notes)
+    {
+        char buf[1024];
+        vsnprintf(buf, sizeof(buf), format, ap);
+        notes->append(buf);
+    }
+    else
+        vprintf(format, ap);
+
+    va_end(ap);
+}
+
+// Generated files are written to memory first and only replace a file whose
+// content differs, so that unchanged headers keep their timestamps and the
+// providers including them are not rebuilt.
+
+struct Output
+{
+    string path;
+    char* data;
+    size_t size;
+    FILE* os;
+};
+
+static vector<string> _outputs;
+static pthread_mutex_t _outputs_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static FILE* open_output(Output& out, const string& path)
+{
+    out.path = path;
+    out.data = NULL;
+    out.size = 0;
+    return out.os = open_memstream(&out.data, &out.size);
+}
+
+static bool _same_content(const char* path, const char* data, size_t size)
+{
+    struct stat st;
+
+    if (stat(path, &st) != 0 || (size_t)st.st_size != size)
+        return false;
+
+    FILE* is = fopen(path, "rb");
+
+    if (!is)
+        return false;
+
+    char buf[4096];
+    size_t pos = 0;
+    size_t n;
+
+    while ((n = fread(buf, 1, sizeof(buf), is)) > 0)
+    {
+        if (pos + n > size || memcmp(buf, data + pos, n) != 0)
+            break;
+
+        pos += n;
+    }
+
+    fclose(is);
+    return pos == size && n == 0;
+}
+
+static void write_output(const string& path, const char* data, size_t size)
+{
+    if (_same_content(path.c_str(), data, size))
+        note("Unchanged %s\n", path.c_str());
+    else
+    {
+        FILE* os = fopen(path.c_str(), "wb");
+
+        if (!os)
+            err("failed to open %s", path.c_str());
+
+        if (fwrite(data, 1, size, os) != size || fclose(os) != 0)
+            err("failed to write %s", path.c_str());
+
+        note("Created %s\n", path.c_str());
+    }
+
+    pthread_mutex_lock(&_outputs_lock);
+    _outputs.push_back(path);
+    pthread_mutex_unlock(&_outputs_lock);
+}
+
+static void close_output(Output& out)
+{
+    fclose(out.os);
+    write_output(out.path, out.data, out.size);
+    free(out.data);
+}
+
 static const char LINE39[] = "=======================================";
 
 static int put(FILE* os, const char* format, ...)
@@ -132,17 +276,46 @@ static int put(FILE* os, const char* format, ...)
     return 0;
 }
 
-static const MOF_Class_Decl* _find_class(const char* name)
+// Class names are looked up without regard to case:
+
+struct NoCase
+{
+    bool operator()(const string& x, const string& y) const
+    {
+        return strcasecmp(x.c_str(), y.c_str()) < 0;
+    }
+};
+
+typedef set<string, NoCase> Name_Set;
+
+// Indexes built before generation starts (and read-only after that): the
+// parsed classes by name, and the position of each class in classnames.
+
+static map<string, const MOF_Class_Decl*, NoCase> _class_index;
+static map<string, size_t, NoCase> _classname_index;
+static Name_Set _skeleton_names;
+
+static void index_classes()
 {
+    // (Already done when serving a request.)
+
+    if (_class_index.size())
+        return;
+
     for (const MOF_Class_Decl* p = MOF_Class_Decl::list; 
         p; 
         p = (const MOF_Class_Decl*)(p->next))
     {
-        if (strcasecmp(p->name, name) == 0)
-            return p;
+        _class_index.insert(make_pair(string(p->name), p));
     }
+}
 
-    return NULL;
+static const MOF_Class_Decl* _find_class(const char* name)
+{
+    map<string, const MOF_Class_Decl*, NoCase>::const_iterator pos = 
+        _class_index.find(name);
+
+    return pos == _class_index.end() ? NULL : pos->second;
 }
 
 static size_t find(vector<string>& v, const string& cn)
@@ -161,14 +334,26 @@ static bool contains(vector<string>& v, const string& cn)
     return find(v, cn) != (size_t)-1;
 }
 
+static void add_class(const string& cn, const string& al)
+{
+    _classname_index.insert(make_pair(cn, classnames.size()));
+    classnames.push_back(cn);
+    aliases.push_back(al);
+}
+
+static bool is_class(const string& cn)
+{
+    return _classname_index.find(cn) != _classname_index.end();
+}
+
 static const char* alias(const char* cn)
 {
-    size_t pos = find(classnames, cn);
+    map<string, size_t, NoCase>::const_iterator pos = _classname_index.find(cn);
 
-    if (pos == (size_t)-1)
+    if (pos == _classname_index.end())
         return cn;
 
-    return aliases[pos].c_str();
+    return aliases[pos->second].c_str();
 }
 
 static void direct_dependencies(const string& cn, vector<string>& deps)
@@ -211,28 +396,37 @@ static void direct_dependencies(const string& cn, vector<string>& deps)
     }
 }
 
-static void recursive_dependencies(const string& cn, vector<string>& deps)
+// Adds the classes that the given one depends on (its super classes, the
+// classes its references and method REF parameters refer to, and those
+// named by EmbeddedInstance parameters) to classnames. Each class is visited
+// once, in depth-first order, so the closure of all the requested classes
+// takes a single traversal.
+
+static void add_dependencies(
+    const string& cn, 
+    set<const MOF_Class_Decl*>& visited)
 {
     const MOF_Class_Decl* cd = _find_class(cn.c_str());
 
     if (!cd)
         err("unknown class: %s", cn.c_str());
 
-    if (contains(deps, cd->name))
+    if (!visited.insert(cd).second)
         return;
 
-    deps.push_back(cd->name);
+    if (!is_class(cd->name))
+        add_class(cd->name, cd->name);
 
     if (cd->super_class)
-        recursive_dependencies(cd->super_class->name, deps);
+        add_dependencies(cd->super_class->name, visited);
 
     for (MOF_Feature_Info* p=cd->all_features; p; p=(MOF_Feature_Info*)p->next)
     {
         MOF_Reference_Decl* mrd = dynamic_cast<MOF_Reference_Decl*>(p->feature);
 
-        if (mrd && !contains(deps, mrd->class_name))
+        if (mrd)
         {
-            recursive_dependencies(mrd->class_name, deps);
+            add_dependencies(mrd->class_name, visited);
             continue;
         }
 
@@ -246,17 +440,13 @@ static void recursive_dependencies(const string& cn, vector<string>& deps)
             {
                 if (p->data_type == TOK_REF)
                 {
-                    if (p->ref_name && !contains(deps, p->ref_name))
-                    {
-                        recursive_dependencies(p->ref_name, deps);
-                    }
+                    if (p->ref_name)
+                        add_dependencies(p->ref_name, visited);
                 }
                 else if (p->qualifiers->has_key("EmbeddedInstance"))
                 {
                     char *name = p->qualifiers->get("EmbeddedInstance")->params->string_value;
-                    if (!contains(deps, name)) {
-                        recursive_dependencies(name, deps);
-                    }
+                    add_dependencies(name, visited);
                 }
             }
             continue;
@@ -943,55 +1133,17 @@ static void gen_meth_stub(
     const MOF_Class_Decl* cd, 
     const MOF_Method_Decl* md)
 {
-    const char* sn = alias(cd->name);
-    const char* mn = md->name;
     const char* ktn = _ktype_name(md->data_type);
     char buf[1024];
 
     gen_meth_header(os, cd, md, false);
 
-    // $0=ktn $0=ktnu
-    const char BODY_LEAD[] =
-        "{\n"
-        "    $0 result = $1_INIT;\n"
-        "\n";
-    const char BODY_LEAD_AROUND[] =
-        "{\n"
-        "    $0 result = $1_INIT;\n"
-        "\n";
-
-    string text;
-    if (around)
-        text = BODY_LEAD_AROUND;
-/*        put(os, BODY_LEAD_AROUND, ktn, to_upper(buf, ktn), NULL);*/
-    else
-        text = BODY_LEAD;
-/*        put(os, BODY_LEAD, ktn, to_upper(buf, ktn), NULL);*/
-
-    if (!etm.empty()) {
-        text += etm;
-/*        put(os, etm.c_str(), ktn, to_upper(buf, ktn), NULL);*/
-    }
-
-    /* Replacements, including output arguments */
-    transform(text, cd, md);
-
-    /* Method credentials */
-    substitute(text, "<MNAME>", mn);
-    substitute(text, "<MTYPE>", ktn);
-    substitute(text, "<ALIAS>", sn);
-    substitute(text, "<CLASS>", cd->name);
+    /* Replacements, including output arguments, and method credentials */
+    string text = render_method(cd, md);
 
     /* Write */
     put(os, text.c_str(), ktn, to_upper(buf, ktn), NULL);
 
-/*    transform(text, cd, md);
-    substitute(text, "<ALIAS>", sn);
-    substitute(text, "<CLASS>", cd->name);
-    fprintf(os, "%s", text.c_str());
-
-    exmethod(os, cd, md);
-*/
     const char BODY_OUT[] =
         "    KSetStatus(status, ERR_NOT_SUPPORTED);\n"
         "    return result;\n"
@@ -1171,13 +1323,31 @@ static void gen_methods(FILE* os, const MOF_Class_Decl* cd, const char* sn)
         "    const CMPIArgs* in,\n"
         "    CMPIArgs* out)\n"
         "{\n"
+        "#ifdef __cplusplus\n"
+        "    $0Ref self = {};\n"
+        "#else\n"
         "    $0Ref self;\n"
+        "#endif\n"
         "\n"
         "    KReturnIf($0Ref_InitFromObjectPath(&self, cb, cop));\n"
         "\n";
 
     put(os, HEADER, sn, NULL);
 
+    // Only the method calls use the rest of the arguments:
+
+    if (num_methods == 0)
+    {
+        put(os, 
+            "    (void)mi;\n"
+            "    (void)cc;\n"
+            "    (void)cr;\n"
+            "    (void)meth;\n"
+            "    (void)in;\n"
+            "    (void)out;\n", 
+            NULL);
+    }
+
     for (p = cd->all_features; p; p = (MOF_Feature_Info*)p->next)
     {
 
@@ -1482,6 +1652,21 @@ static void gen_set(
         "    return 0;\n"
         "}\n"
         "\n";
+    /* $0=sn $1=pn $2=ctn $3=ktn */
+    const char FMT5[] =
+        "KINLINE void $0_SetInterned_$1(\n"
+        "    $0* self,\n"
+        "    KStringPool* pool,\n"
+        "    const char* s)\n"
+        "{\n"
+        "    if (self && self->__base.magic == KMAGIC)\n"
+        "    {\n"
+        "        $3* field = ($3*)&self->$1;\n"
+        "        KString_SetString(field, \n"
+        "            KStringPool_Intern(pool, self->__base.cb, s));\n"
+        "    }\n"
+        "}\n"
+        "\n";
 
     if (mpd->array_index == 0)
     {
@@ -1489,6 +1674,7 @@ static void gen_set(
         {
             put(os, FMT1, sn, pn, ctn, ktn, ext, NULL);
             put(os, FMT2, sn, pn, ctn, ktn, NULL);
+            put(os, FMT5, sn, pn, ctn, ktn, NULL);
         }
         else
             put(os, FMT1, sn, pn, ctn, ktn, ext, NULL);
@@ -1918,250 +2104,669 @@ static void gen_features(
     }
 }
 
-const char INSTANCE_PROVIDER[] =
-    "#include <konkret/konkret.h>\n"
-    "#include \"<ALIAS>.h\"\n"
-    "\n"
-    "static const CMPIBroker* _cb = NULL;\n"
-    "\n"
-    "static void <ALIAS>Initialize()\n"
-    "{\n"
-    "}\n"
-    "\n"
-    "static CMPIStatus <ALIAS>Cleanup(\n"
-    "    CMPIInstanceMI* mi,\n"
-    "    const CMPIContext* cc,\n"
-    "    CMPIBoolean term)\n"
-    "{\n"
-    "    CMReturn(CMPI_RC_OK);\n"
-    "}\n"
-    "\n"
-    "static CMPIStatus <ALIAS>EnumInstanceNames(\n"
-    "    CMPIInstanceMI* mi,\n"
-    "    const CMPIContext* cc,\n"
-    "    const CMPIResult* cr,\n"
-    "    const CMPIObjectPath* cop)\n"
-    "{\n"
-    "    return KDefaultEnumerateInstanceNames(\n"
-    "        _cb, mi, cc, cr, cop);\n"
-    "}\n"
-    "\n"
-    "static CMPIStatus <ALIAS>EnumInstances(\n"
-    "    CMPIInstanceMI* mi,\n"
-    "    const CMPIContext* cc,\n"
-    "    const CMPIResult* cr,\n"
-    "    const CMPIObjectPath* cop,\n"
-    "    const char** properties)\n"
-    "{\n"
-    "    CMReturn(CMPI_RC_OK);\n"
-    "}\n"
-    "\n"
-    "static CMPIStatus <ALIAS>GetInstance(\n"
-    "    CMPIInstanceMI* mi,\n"
-    "    const CMPIContext* cc,\n"
-    "    const CMPIResult* cr,\n"
-    "    const CMPIObjectPath* cop,\n"
-    "    const char** properties)\n"
-    "{\n"
-    "    return KDefaultGetInstance(\n"
-    "        _cb, mi, cc, cr, cop, properties);\n"
-    "}\n"
-    "\n"
-    "static CMPIStatus <ALIAS>CreateInstance(\n"
-    "    CMPIInstanceMI* mi,\n"
-    "    const CMPIContext* cc,\n"
-    "    const CMPIResult* cr,\n"
-    "    const CMPIObjectPath* cop,\n"
-    "    const CMPIInstance* ci)\n"
-    "{\n"
-    "    CMReturn(CMPI_RC_ERR_NOT_SUPPORTED);\n"
-    "}\n"
-    "\n"
-    "static CMPIStatus <ALIAS>ModifyInstance(\n"
-    "    CMPIInstanceMI* mi,\n"
-    "    const CMPIContext* cc,\n"
-    "    const CMPIResult* cr,\n"
-    "    const CMPIObjectPath* cop,\n"
-    "    const CMPIInstance* ci,\n"
-    "    const char** properties)\n"
-    "{\n"
-    "    CMReturn(CMPI_RC_ERR_NOT_SUPPORTED);\n"
-    "}\n"
-    "\n"
-    "static CMPIStatus <ALIAS>DeleteInstance(\n"
-    "    CMPIInstanceMI* mi,\n"
-    "    const CMPIContext* cc,\n"
-    "    const CMPIResult* cr,\n"
-    "    const CMPIObjectPath* cop)\n"
-    "{\n"
-    "    CMReturn(CMPI_RC_ERR_NOT_SUPPORTED);\n"
-    "}\n"
-    "\n"
-    "static CMPIStatus <ALIAS>ExecQuery(\n"
-    "    CMPIInstanceMI* mi,\n"
-    "    const CMPIContext* cc,\n"
-    "    const CMPIResult* cr,\n"
-    "    const CMPIObjectPath* cop,\n"
-    "    const char* lang,\n"
-    "    const char* query)\n"
-    "{\n"
-    "    CMReturn(CMPI_RC_ERR_NOT_SUPPORTED);\n"
-    "}\n"
-    "\n"
-    "CMInstanceMIStub(\n"
-    "    <ALIAS>,\n"
-    "    <CLASS>,\n"
-    "    _cb,\n"
-    "    <ALIAS>Initialize())\n"
-    "\n"
-    "static CMPIStatus <ALIAS>MethodCleanup(\n"
-    "    CMPIMethodMI* mi,\n"
-    "    const CMPIContext* cc,\n"
-    "    CMPIBoolean term)\n"
-    "{\n"
-    "    CMReturn(CMPI_RC_OK);\n"
-    "}\n"
-    "\n"
-    "static CMPIStatus <ALIAS>InvokeMethod(\n"
-    "    CMPIMethodMI* mi,\n"
-    "    const CMPIContext* cc,\n"
-    "    const CMPIResult* cr,\n"
-    "    const CMPIObjectPath* cop,\n"
-    "    const char* meth,\n"
-    "    const CMPIArgs* in,\n"
-    "    CMPIArgs* out)\n"
-    "{\n"
-    "    return <ALIAS>_DispatchMethod(\n"
-    "        _cb, mi, cc, cr, cop, meth, in, out);\n"
-    "}\n"
-    "\n"
-    "CMMethodMIStub(\n"
-    "    <ALIAS>,\n"
-    "    <CLASS>,\n"
-    "    _cb,\n"
-    "    <ALIAS>Initialize())\n";
+static void gen_requested(
+    FILE* os, 
+    const MOF_Class_Decl* cd,
+    const char* sn)
+{
+    vector<const MOF_Feature*> expensive;
 
-const char ASSOCIATION_PROVIDER[] =
-    "#include <konkret/konkret.h>\n"
-    "#include \"<ALIAS>.h\"\n"
-    "\n"
-    "static const CMPIBroker* _cb;\n"
-    "\n"
-    "static void <ALIAS>Initialize()\n"
-    "{\n"
-    "}\n"
-    "\n"
-    "static CMPIStatus <ALIAS>Cleanup( \n"
-    "    CMPIInstanceMI* mi,\n"
-    "    const CMPIContext* cc, \n"
-    "    CMPIBoolean term)\n"
-    "{\n"
-    "    CMReturn(CMPI_RC_OK);\n"
-    "}\n"
-    "\n"
-    "static CMPIStatus <ALIAS>EnumInstanceNames( \n"
-    "    CMPIInstanceMI* mi,\n"
-    "    const CMPIContext* cc,\n"
-    "    const CMPIResult* cr,\n"
-    "    const CMPIObjectPath* cop)\n"
-    "{\n"
-    "    return KDefaultEnumerateInstanceNames(\n"
-    "        _cb, mi, cc, cr, cop);\n"
-    "}\n"
+    // Generate a predicate per property telling whether the property is
+    // in the requested property list:
+
+    for (MOF_Feature_Info* p = cd->all_features; p; 
+        p = (MOF_Feature_Info*)p->next)
+    {
+        MOF_Feature* mf = p->feature;
+
+        if (dynamic_cast<MOF_Method_Decl*>(mf))
+            continue;
+
+        /* $0=sn $1=pn */
+        const char FMT[] =
+            "#define $0_IsRequested_$1(PROPERTIES) \\\n"
+            "    KRequested(PROPERTIES, \"$1\")\n"
+            "\n";
+
+        put(os, FMT, sn, mf->name, NULL);
+
+        if (mf->qual_mask & MOF_QT_EXPENSIVE)
+            expensive.push_back(mf);
+    }
+
+    if (expensive.empty())
+        return;
+
+    // Generate callback slots for the expensive properties and the
+    // function that invokes them for requested properties only:
+
+    put(os, "typedef struct _$0_Expensive\n{\n", sn, NULL);
+
+    for (size_t i = 0; i < expensive.size(); i++)
+    {
+        put(os, "    CMPIStatus (*$1)($0* self, void* data);\n", 
+            sn, expensive[i]->name, NULL);
+    }
+
+    put(os, "}\n$0_Expensive;\n\n", sn, NULL);
+
+    /* $0=sn */
+    const char HEADER[] =
+        "KINLINE CMPIStatus $0_ComputeExpensive(\n"
+        "    $0* self,\n"
+        "    const char** properties,\n"
+        "    const $0_Expensive* slots,\n"
+        "    void* data)\n"
+        "{\n";
+
+    put(os, HEADER, sn, NULL);
+
+    for (size_t i = 0; i < expensive.size(); i++)
+    {
+        /* $0=sn $1=pn */
+        const char FMT[] =
+            "    if (slots->$1 && KRequested(properties, \"$1\"))\n"
+            "        KReturnIf(slots->$1(self, data));\n"
+            "\n";
+
+        put(os, FMT, sn, expensive[i]->name, NULL);
+    }
+
+    put(os, "    KReturn(OK);\n}\n\n", NULL);
+}
+
+static void gen_ref_hash(
+    FILE* os,
+    const MOF_Class_Decl* cd,
+    const char* sn)
+{
+    vector<string> hash;
+    vector<string> equal;
+
+    // Hash and compare the key fields only, specialized on their types:
+
+    for (MOF_Feature_Info* p = cd->all_features; p;
+        p = (MOF_Feature_Info*)p->next)
+    {
+        MOF_Feature* mf = p->feature;
+        const char* pn = mf->name;
+        char buf[1024];
+
+        if (dynamic_cast<MOF_Method_Decl*>(mf) || !_is_key(cd, pn))
+            continue;
+
+        MOF_Property_Decl* mpd = dynamic_cast<MOF_Property_Decl*>(mf);
+
+        if (mpd && mpd->array_index)
+            continue;
+
+        if (!mpd)
+        {
+            sprintf(buf, "    h = KHashRef(h, &self->%s);\n", pn);
+            hash.push_back(buf);
+            sprintf(buf, "KRef_Equal(&x->%s, &y->%s)", pn, pn);
+            equal.push_back(buf);
+        }
+        else if (mpd->data_type == TOK_STRING)
+        {
+            sprintf(buf, "    h = KHashString(h, &self->%s);\n", pn);
+            hash.push_back(buf);
+            sprintf(buf, "KString_Equal(&x->%s, &y->%s)", pn, pn);
+            equal.push_back(buf);
+        }
+        else if (mpd->data_type == TOK_DATETIME)
+        {
+            sprintf(buf, "    h = KHashDateTime(h, &self->%s);\n", pn);
+            hash.push_back(buf);
+            sprintf(buf, "KDateTime_Equal(&x->%s, &y->%s)", pn, pn);
+            equal.push_back(buf);
+        }
+        else
+        {
+            sprintf(buf,
+                "    h = KHashValue(h, (const KValue*)&self->%s, "
+                "sizeof(self->%s.value));\n", pn, pn);
+            hash.push_back(buf);
+            sprintf(buf,
+                "KValue_Equal((const KValue*)&x->%s, (const KValue*)&y->%s, "
+                "sizeof(x->%s.value))", pn, pn, pn);
+            equal.push_back(buf);
+        }
+    }
+
+    /* $0=sn */
+    const char HASH[] =
+        "KINLINE CMPIUint32 $0_Hash(const $0* self)\n"
+        "{\n"
+        "    CMPIUint32 h = KHASH_INIT;\n";
+
+    put(os, HASH, sn, NULL);
+
+    if (hash.empty())
+        put(os, "    (void)self;\n", NULL);
+
+    for (size_t i = 0; i < hash.size(); i++)
+        fputs(hash[i].c_str(), os);
+
+    put(os, "    return h;\n}\n\n", NULL);
+
+    /* $0=sn */
+    const char EQUAL[] =
+        "KINLINE CMPIBoolean $0_Equal(const $0* x, const $0* y)\n"
+        "{\n";
+
+    put(os, EQUAL, sn, NULL);
+
+    if (equal.empty())
+        put(os, "    (void)x;\n    (void)y;\n    return 1;\n", NULL);
+
+    for (size_t i = 0; i < equal.size(); i++)
+    {
+        put(os, i == 0 ? "    return $0" : " &&\n        $0",
+            equal[i].c_str(), NULL);
+    }
+
+    if (!equal.empty())
+        put(os, ";\n", NULL);
+
+    put(os, "}\n\n", NULL);
+
+    // Define the map template keyed on this reference:
+
+    /* $0=sn */
+    const char MAP[] =
+        "#define $0Map_Define(NAME, VALUE) \\\n"
+        "    KMAP_DEFINE(NAME, $0, VALUE, $0_Hash, $0_Equal)\n"
+        "\n";
+
+    put(os, MAP, sn, NULL);
+}
+
+static void gen_names(
+    FILE* os,
+    const string& sn,
+    const vector<string>& names)
+{
+    put(os, "static const char* const $0[] =\n{\n", sn.c_str(), NULL);
+
+    for (size_t i = 0; i < names.size(); i++)
+        put(os, "    \"$0\",\n", names[i].c_str(), NULL);
+
+    put(os, "    NULL,\n};\n\n", NULL);
+}
+
+static void class_and_ancestors(const char* cn, vector<string>& isa)
+{
+    const MOF_Class_Decl* cd = _find_class(cn);
+
+    if (!cd)
+        isa.push_back(cn);
+
+    for (; cd; cd = cd->super_class)
+        isa.push_back(cd->name);
+}
+
+static void gen_assoc(
+    FILE* os,
+    const MOF_Class_Decl* cd,
+    const char* al)
+{
+    vector<const MOF_Reference_Decl*> refs;
+
+    for (MOF_Feature_Info* p = cd->all_features; p;
+        p = (MOF_Feature_Info*)p->next)
+    {
+        MOF_Reference_Decl* mrd = dynamic_cast<MOF_Reference_Decl*>(p->feature);
+
+        if (mrd)
+            refs.push_back(mrd);
+    }
+
+    // The classes whose relation to every role is known: the role classes
+    // and their superclasses. These come from the schema alone, so the
+    // header does not depend on what else is generated with it.
+
+    vector<string> classes;
+    Name_Set seen;
+
+    for (size_t i = 0; i < refs.size(); i++)
+    {
+        vector<string> isa;
+        class_and_ancestors(refs[i]->class_name, isa);
+
+        for (size_t j = 0; j < isa.size(); j++)
+        {
+            if (seen.insert(isa[j]).second)
+                classes.push_back(isa[j]);
+        }
+    }
+
+    gen_names(os, string("__") + al + "_classes", classes);
+
+    // Generate the class hierarchy of the association and of each role:
+
+    vector<string> isa;
+    class_and_ancestors(cd->name, isa);
+    gen_names(os, string("__") + al + "_isa", isa);
+
+    for (size_t i = 0; i < refs.size(); i++)
+    {
+        string prefix = string("__") + al + "_" + refs[i]->name;
+        vector<string> risa;
+        vector<string> subclasses;
+
+        class_and_ancestors(refs[i]->class_name, risa);
+        gen_names(os, prefix + "_isa", risa);
+
+        for (size_t j = 0; j < classes.size(); j++)
+        {
+            const MOF_Class_Decl* p = _find_class(classes[j].c_str());
+
+            for (p = p ? p->super_class : NULL; p; p = p->super_class)
+            {
+                if (strcasecmp(p->name, risa[0].c_str()) == 0)
+                {
+                    subclasses.push_back(classes[j]);
+                    break;
+                }
+            }
+        }
+
+        gen_names(os, prefix + "_subclasses", subclasses);
+    }
+
+    // Generate the association descriptor:
+
+    put(os, "static const KAssocRole __$0_roles[] =\n{\n", al, NULL);
+
+    for (size_t i = 0; i < refs.size(); i++)
+    {
+        put(os, "    { \"$1\", __$0_$1_isa, __$0_$1_subclasses },\n",
+            al, refs[i]->name, NULL);
+    }
+
+    put(os, "};\n\n", NULL);
+
+    /* $0=alias */
+    const char ASSOC[] =
+        "static const KAssoc __$0_assoc =\n"
+        "{\n"
+        "    __$0_isa,\n"
+        "    __$0_roles,\n"
+        "    sizeof(__$0_roles) / sizeof(__$0_roles[0]),\n"
+        "    __$0_classes,\n"
+        "};\n"
+        "\n";
+
+    put(os, ASSOC, al, NULL);
+
+    // Generate the traversal operations:
+
+    /* $0=alias */
+    const char OPERATIONS[] =
+        "KINLINE CMPIStatus $0_Associators(\n"
+        "    const CMPIBroker* cb,\n"
+        "    CMPIAssociationMI* mi,\n"
+        "    const CMPIContext* cc,\n"
+        "    const CMPIResult* cr,\n"
+        "    const CMPIObjectPath* cop,\n"
+        "    const char* assocClass,\n"
+        "    const char* resultClass,\n"
+        "    const char* role,\n"
+        "    const char* resultRole,\n"
+        "    const char** properties)\n"
+        "{\n"
+        "    return KAssociators(cb, mi, cc, cr, cop, &__$0_assoc,\n"
+        "        assocClass, resultClass, role, resultRole, properties);\n"
+        "}\n"
+        "\n"
+        "KINLINE CMPIStatus $0_AssociatorNames(\n"
+        "    const CMPIBroker* cb,\n"
+        "    CMPIAssociationMI* mi,\n"
+        "    const CMPIContext* cc,\n"
+        "    const CMPIResult* cr,\n"
+        "    const CMPIObjectPath* cop,\n"
+        "    const char* assocClass,\n"
+        "    const char* resultClass,\n"
+        "    const char* role,\n"
+        "    const char* resultRole)\n"
+        "{\n"
+        "    return KAssociatorNames(cb, mi, cc, cr, cop, &__$0_assoc,\n"
+        "        assocClass, resultClass, role, resultRole);\n"
+        "}\n"
+        "\n"
+        "KINLINE CMPIStatus $0_References(\n"
+        "    const CMPIBroker* cb,\n"
+        "    CMPIAssociationMI* mi,\n"
+        "    const CMPIContext* cc,\n"
+        "    const CMPIResult* cr,\n"
+        "    const CMPIObjectPath* cop,\n"
+        "    const char* assocClass,\n"
+        "    const char* role,\n"
+        "    const char** properties)\n"
+        "{\n"
+        "    return KReferences(cb, mi, cc, cr, cop, &__$0_assoc,\n"
+        "        assocClass, role, properties);\n"
+        "}\n"
+        "\n"
+        "KINLINE CMPIStatus $0_ReferenceNames(\n"
+        "    const CMPIBroker* cb,\n"
+        "    CMPIAssociationMI* mi,\n"
+        "    const CMPIContext* cc,\n"
+        "    const CMPIResult* cr,\n"
+        "    const CMPIObjectPath* cop,\n"
+        "    const char* assocClass,\n"
+        "    const char* role)\n"
+        "{\n"
+        "    return KReferenceNames(cb, mi, cc, cr, cop, &__$0_assoc,\n"
+        "        assocClass, role);\n"
+        "}\n"
+        "\n";
+
+    put(os, OPERATIONS, al, NULL);
+}
+
+const char INSTANCE_PROVIDER[] =
+    "#include <konkret/konkret.h>\n"
+    "#include \"<ALIAS>.h\"\n"
     "\n"
-    "static CMPIStatus <ALIAS>EnumInstances( \n"
-    "    CMPIInstanceMI* mi,\n"
-    "    const CMPIContext* cc, \n"
-    "    const CMPIResult* cr, \n"
-    "    const CMPIObjectPath* cop, \n"
-    "    const char** properties) \n"
+    "static const CMPIBroker* _cb = NULL;\n"
+    "\n"
+    "/* Strings shared by the instances of this provider */\n"
+    "static KUNUSED KStringPool _pool = KSTRINGPOOL_INIT;\n"
+    "\n"
+    "static void <ALIAS>Initialize()\n"
     "{\n"
-    "    CMReturn(CMPI_RC_OK);\n"
     "}\n"
     "\n"
-    "static CMPIStatus <ALIAS>GetInstance( \n"
-    "    CMPIInstanceMI* mi, \n"
+    "static CMPIStatus <ALIAS>Cleanup(\n"
+    "    CMPIInstanceMI* mi,\n"
     "    const CMPIContext* cc,\n"
-    "    const CMPIResult* cr, \n"
-    "    const CMPIObjectPath* cop, \n"
-    "    const char** properties) \n"
+    "    CMPIBoolean term)\n"
     "{\n"
-    "    return KDefaultGetInstance(\n"
-    "        _cb, mi, cc, cr, cop, properties);\n"
+    "    KStringPool_Clear(&_pool);\n"
+    "    KArenaReturn(KStatus(OK));\n"
     "}\n"
     "\n"
-    "static CMPIStatus <ALIAS>CreateInstance( \n"
-    "    CMPIInstanceMI* mi, \n"
-    "    const CMPIContext* cc, \n"
-    "    const CMPIResult* cr, \n"
-    "    const CMPIObjectPath* cop, \n"
-    "    const CMPIInstance* ci) \n"
-    "{\n"
-    "    CMReturn(CMPI_RC_ERR_NOT_SUPPORTED);\n"
-    "}\n"
+    "/* Identical requests that arrive while one runs share its results */\n"
     "\n"
-    "static CMPIStatus <ALIAS>ModifyInstance( \n"
-    "    CMPIInstanceMI* mi, \n"
-    "    const CMPIContext* cc, \n"
-    "    const CMPIResult* cr, \n"
-    "    const CMPIObjectPath* cop,\n"
-    "    const CMPIInstance* ci, \n"
-    "    const char**properties) \n"
+    "static CMPIStatus <ALIAS>EnumInstanceNamesOnce(\n"
+    "    CMPIInstanceMI* mi,\n"
+    "    const CMPIContext* cc,\n"
+    "    const CMPIResult* cr,\n"
+    "    const CMPIObjectPath* cop)\n"
     "{\n"
-    "    CMReturn(CMPI_RC_ERR_NOT_SUPPORTED);\n"
+    "    return KDefaultEnumerateInstanceNames(_cb, mi, cc, cr, cop);\n"
     "}\n"
     "\n"
-    "static CMPIStatus <ALIAS>DeleteInstance( \n"
-    "    CMPIInstanceMI* mi, \n"
-    "    const CMPIContext* cc, \n"
-    "    const CMPIResult* cr, \n"
-    "    const CMPIObjectPath* cop) \n"
+    "static CMPIStatus <ALIAS>EnumInstanceNames(\n"
+    "    CMPIInstanceMI* mi,\n"
+    "    const CMPIContext* cc,\n"
+    "    const CMPIResult* cr,\n"
+    "    const CMPIObjectPath* cop)\n"
     "{\n"
-    "    CMReturn(CMPI_RC_ERR_NOT_SUPPORTED);\n"
+    "    KArenaReturn(KSingleFlightEnumInstanceNames(\n"
+    "        _cb, mi, cc, cr, cop, <ALIAS>EnumInstanceNamesOnce));\n"
     "}\n"
     "\n"
-    "static CMPIStatus <ALIAS>ExecQuery(\n"
-    "    CMPIInstanceMI* mi, \n"
-    "    const CMPIContext* cc, \n"
-    "    const CMPIResult* cr, \n"
-    "    const CMPIObjectPath* cop, \n"
-    "    const char* lang, \n"
-    "    const char* query) \n"
+    "static CMPIStatus <ALIAS>EnumInstancesOnce(\n"
+    "    CMPIInstanceMI* mi,\n"
+    "    const CMPIContext* cc,\n"
+    "    const CMPIResult* cr,\n"
+    "    const CMPIObjectPath* cop,\n"
+    "    const char** properties)\n"
     "{\n"
-    "    CMReturn(CMPI_RC_ERR_NOT_SUPPORTED);\n"
+    "    CMReturn(CMPI_RC_OK);\n"
     "}\n"
     "\n"
-    "static CMPIStatus <ALIAS>AssociationCleanup( \n"
-    "    CMPIAssociationMI* mi,\n"
-    "    const CMPIContext* cc, \n"
-    "    CMPIBoolean term) \n"
+    "static CMPIStatus <ALIAS>EnumInstances(\n"
+    "    CMPIInstanceMI* mi,\n"
+    "    const CMPIContext* cc,\n"
+    "    const CMPIResult* cr,\n"
+    "    const CMPIObjectPath* cop,\n"
+    "    const char** properties)\n"
     "{\n"
-    "    CMReturn(CMPI_RC_OK);\n"
+    "    KArenaReturn(KSingleFlightEnumInstances(\n"
+    "        _cb, mi, cc, cr, cop, properties, <ALIAS>EnumInstancesOnce));\n"
     "}\n"
     "\n"
-    "static CMPIStatus <ALIAS>Associators(\n"
-    "    CMPIAssociationMI* mi,\n"
+    "static CMPIStatus <ALIAS>GetInstance(\n"
+    "    CMPIInstanceMI* mi,\n"
     "    const CMPIContext* cc,\n"
     "    const CMPIResult* cr,\n"
     "    const CMPIObjectPath* cop,\n"
-    "    const char* assocClass,\n"
-    "    const char* resultClass,\n"
-    "    const char* role,\n"
-    "    const char* resultRole,\n"
     "    const char** properties)\n"
     "{\n"
-    "    return KDefaultAssociators(\n"
+    "    KArenaReturn(KDefaultGetInstance(\n"
+    "        _cb, mi, cc, cr, cop, properties));\n"
+    "}\n"
+    "\n"
+    "static CMPIStatus <ALIAS>CreateInstance(\n"
+    "    CMPIInstanceMI* mi,\n"
+    "    const CMPIContext* cc,\n"
+    "    const CMPIResult* cr,\n"
+    "    const CMPIObjectPath* cop,\n"
+    "    const CMPIInstance* ci)\n"
+    "{\n"
+    "    KArenaReturn(KStatus(ERR_NOT_SUPPORTED));\n"
+    "}\n"
+    "\n"
+    "static CMPIStatus <ALIAS>ModifyInstance(\n"
+    "    CMPIInstanceMI* mi,\n"
+    "    const CMPIContext* cc,\n"
+    "    const CMPIResult* cr,\n"
+    "    const CMPIObjectPath* cop,\n"
+    "    const CMPIInstance* ci,\n"
+    "    const char** properties)\n"
+    "{\n"
+    "    KArenaReturn(KStatus(ERR_NOT_SUPPORTED));\n"
+    "}\n"
+    "\n"
+    "static CMPIStatus <ALIAS>DeleteInstance(\n"
+    "    CMPIInstanceMI* mi,\n"
+    "    const CMPIContext* cc,\n"
+    "    const CMPIResult* cr,\n"
+    "    const CMPIObjectPath* cop)\n"
+    "{\n"
+    "    KArenaReturn(KStatus(ERR_NOT_SUPPORTED));\n"
+    "}\n"
+    "\n"
+    "static CMPIStatus <ALIAS>ExecQuery(\n"
+    "    CMPIInstanceMI* mi,\n"
+    "    const CMPIContext* cc,\n"
+    "    const CMPIResult* cr,\n"
+    "    const CMPIObjectPath* cop,\n"
+    "    const char* lang,\n"
+    "    const char* query)\n"
+    "{\n"
+    "    /* Queries that fix every key are answered by <ALIAS>GetInstance */\n"
+    "    KArenaReturn(KDefaultExecQuery(\n"
+    "        _cb, mi, cc, cr, cop, lang, query, __<ALIAS>_sig,\n"
+    "        <ALIAS>GetInstance));\n"
+    "}\n"
+    "\n"
+    "CMInstanceMIStub(\n"
+    "    <ALIAS>,\n"
+    "    <CLASS>,\n"
+    "    _cb,\n"
+    "    <ALIAS>Initialize())\n"
+    "\n"
+    "static CMPIStatus <ALIAS>MethodCleanup(\n"
+    "    CMPIMethodMI* mi,\n"
+    "    const CMPIContext* cc,\n"
+    "    CMPIBoolean term)\n"
+    "{\n"
+    "    KArenaReturn(KStatus(OK));\n"
+    "}\n"
+    "\n"
+    "static CMPIStatus <ALIAS>InvokeMethod(\n"
+    "    CMPIMethodMI* mi,\n"
+    "    const CMPIContext* cc,\n"
+    "    const CMPIResult* cr,\n"
+    "    const CMPIObjectPath* cop,\n"
+    "    const char* meth,\n"
+    "    const CMPIArgs* in,\n"
+    "    CMPIArgs* out)\n"
+    "{\n"
+    "    KArenaReturn(<ALIAS>_DispatchMethod(\n"
+    "        _cb, mi, cc, cr, cop, meth, in, out));\n"
+    "}\n"
+    "\n"
+    "CMMethodMIStub(\n"
+    "    <ALIAS>,\n"
+    "    <CLASS>,\n"
+    "    _cb,\n"
+    "    <ALIAS>Initialize())\n";
+
+const char ASSOCIATION_PROVIDER[] =
+    "#include <konkret/konkret.h>\n"
+    "#include \"<ALIAS>.h\"\n"
+    "\n"
+    "static const CMPIBroker* _cb;\n"
+    "\n"
+    "/* Strings shared by the instances of this provider */\n"
+    "static KUNUSED KStringPool _pool = KSTRINGPOOL_INIT;\n"
+    "\n"
+    "static void <ALIAS>Initialize()\n"
+    "{\n"
+    "}\n"
+    "\n"
+    "static CMPIStatus <ALIAS>Cleanup( \n"
+    "    CMPIInstanceMI* mi,\n"
+    "    const CMPIContext* cc, \n"
+    "    CMPIBoolean term)\n"
+    "{\n"
+    "    KStringPool_Clear(&_pool);\n"
+    "    KArenaReturn(KStatus(OK));\n"
+    "}\n"
+    "\n"
+    "/* Identical requests that arrive while one runs share its results */\n"
+    "\n"
+    "static CMPIStatus <ALIAS>EnumInstanceNamesOnce(\n"
+    "    CMPIInstanceMI* mi,\n"
+    "    const CMPIContext* cc,\n"
+    "    const CMPIResult* cr,\n"
+    "    const CMPIObjectPath* cop)\n"
+    "{\n"
+    "    return KDefaultEnumerateInstanceNames(_cb, mi, cc, cr, cop);\n"
+    "}\n"
+    "\n"
+    "static CMPIStatus <ALIAS>EnumInstanceNames(\n"
+    "    CMPIInstanceMI* mi,\n"
+    "    const CMPIContext* cc,\n"
+    "    const CMPIResult* cr,\n"
+    "    const CMPIObjectPath* cop)\n"
+    "{\n"
+    "    KArenaReturn(KSingleFlightEnumInstanceNames(\n"
+    "        _cb, mi, cc, cr, cop, <ALIAS>EnumInstanceNamesOnce));\n"
+    "}\n"
+    "\n"
+    "static CMPIStatus <ALIAS>EnumInstancesOnce(\n"
+    "    CMPIInstanceMI* mi,\n"
+    "    const CMPIContext* cc,\n"
+    "    const CMPIResult* cr,\n"
+    "    const CMPIObjectPath* cop,\n"
+    "    const char** properties)\n"
+    "{\n"
+    "    CMReturn(CMPI_RC_OK);\n"
+    "}\n"
+    "\n"
+    "static CMPIStatus <ALIAS>EnumInstances(\n"
+    "    CMPIInstanceMI* mi,\n"
+    "    const CMPIContext* cc,\n"
+    "    const CMPIResult* cr,\n"
+    "    const CMPIObjectPath* cop,\n"
+    "    const char** properties)\n"
+    "{\n"
+    "    KArenaReturn(KSingleFlightEnumInstances(\n"
+    "        _cb, mi, cc, cr, cop, properties, <ALIAS>EnumInstancesOnce));\n"
+    "}\n"
+    "\n"
+    "static CMPIStatus <ALIAS>GetInstance( \n"
+    "    CMPIInstanceMI* mi, \n"
+    "    const CMPIContext* cc,\n"
+    "    const CMPIResult* cr, \n"
+    "    const CMPIObjectPath* cop, \n"
+    "    const char** properties) \n"
+    "{\n"
+    "    KArenaReturn(KDefaultGetInstance(\n"
+    "        _cb, mi, cc, cr, cop, properties));\n"
+    "}\n"
+    "\n"
+    "static CMPIStatus <ALIAS>CreateInstance( \n"
+    "    CMPIInstanceMI* mi, \n"
+    "    const CMPIContext* cc, \n"
+    "    const CMPIResult* cr, \n"
+    "    const CMPIObjectPath* cop, \n"
+    "    const CMPIInstance* ci) \n"
+    "{\n"
+    "    KArenaReturn(KStatus(ERR_NOT_SUPPORTED));\n"
+    "}\n"
+    "\n"
+    "static CMPIStatus <ALIAS>ModifyInstance( \n"
+    "    CMPIInstanceMI* mi, \n"
+    "    const CMPIContext* cc, \n"
+    "    const CMPIResult* cr, \n"
+    "    const CMPIObjectPath* cop,\n"
+    "    const CMPIInstance* ci, \n"
+    "    const char**properties) \n"
+    "{\n"
+    "    KArenaReturn(KStatus(ERR_NOT_SUPPORTED));\n"
+    "}\n"
+    "\n"
+    "static CMPIStatus <ALIAS>DeleteInstance( \n"
+    "    CMPIInstanceMI* mi, \n"
+    "    const CMPIContext* cc, \n"
+    "    const CMPIResult* cr, \n"
+    "    const CMPIObjectPath* cop) \n"
+    "{\n"
+    "    KArenaReturn(KStatus(ERR_NOT_SUPPORTED));\n"
+    "}\n"
+    "\n"
+    "static CMPIStatus <ALIAS>ExecQuery(\n"
+    "    CMPIInstanceMI* mi, \n"
+    "    const CMPIContext* cc, \n"
+    "    const CMPIResult* cr, \n"
+    "    const CMPIObjectPath* cop, \n"
+    "    const char* lang, \n"
+    "    const char* query) \n"
+    "{\n"
+    "    /* Queries that fix every key are answered by <ALIAS>GetInstance */\n"
+    "    KArenaReturn(KDefaultExecQuery(\n"
+    "        _cb, mi, cc, cr, cop, lang, query, __<ALIAS>_sig,\n"
+    "        <ALIAS>GetInstance));\n"
+    "}\n"
+    "\n"
+    "static CMPIStatus <ALIAS>AssociationCleanup( \n"
+    "    CMPIAssociationMI* mi,\n"
+    "    const CMPIContext* cc, \n"
+    "    CMPIBoolean term) \n"
+    "{\n"
+    "    KArenaReturn(KStatus(OK));\n"
+    "}\n"
+    "\n"
+    "static CMPIStatus <ALIAS>Associators(\n"
+    "    CMPIAssociationMI* mi,\n"
+    "    const CMPIContext* cc,\n"
+    "    const CMPIResult* cr,\n"
+    "    const CMPIObjectPath* cop,\n"
+    "    const char* assocClass,\n"
+    "    const char* resultClass,\n"
+    "    const char* role,\n"
+    "    const char* resultRole,\n"
+    "    const char** properties)\n"
+    "{\n"
+    "    KArenaReturn(<ALIAS>_Associators(\n"
     "        _cb,\n"
     "        mi,\n"
     "        cc,\n"
     "        cr,\n"
     "        cop,\n"
-    "        <ALIAS>_ClassName,\n"
     "        assocClass,\n"
     "        resultClass,\n"
     "        role,\n"
     "        resultRole,\n"
-    "        properties);\n"
+    "        properties));\n"
     "}\n"
     "\n"
     "static CMPIStatus <ALIAS>AssociatorNames(\n"
@@ -2174,17 +2779,16 @@ const char ASSOCIATION_PROVIDER[] =
     "    const char* role,\n"
     "    const char* resultRole)\n"
     "{\n"
-    "    return KDefaultAssociatorNames(\n"
+    "    KArenaReturn(<ALIAS>_AssociatorNames(\n"
     "        _cb,\n"
     "        mi,\n"
     "        cc,\n"
     "        cr,\n"
     "        cop,\n"
-    "        <ALIAS>_ClassName,\n"
     "        assocClass,\n"
     "        resultClass,\n"
     "        role,\n"
-    "        resultRole);\n"
+    "        resultRole));\n"
     "}\n"
     "\n"
     "static CMPIStatus <ALIAS>References(\n"
@@ -2196,16 +2800,15 @@ const char ASSOCIATION_PROVIDER[] =
     "    const char* role,\n"
     "    const char** properties)\n"
     "{\n"
-    "    return KDefaultReferences(\n"
+    "    KArenaReturn(<ALIAS>_References(\n"
     "        _cb,\n"
     "        mi,\n"
     "        cc,\n"
     "        cr,\n"
     "        cop,\n"
-    "        <ALIAS>_ClassName,\n"
     "        assocClass,\n"
     "        role,\n"
-    "        properties);\n"
+    "        properties));\n"
     "}\n"
     "\n"
     "static CMPIStatus <ALIAS>ReferenceNames(\n"
@@ -2216,15 +2819,14 @@ const char ASSOCIATION_PROVIDER[] =
     "    const char* assocClass,\n"
     "    const char* role)\n"
     "{\n"
-    "    return KDefaultReferenceNames(\n"
+    "    KArenaReturn(<ALIAS>_ReferenceNames(\n"
     "        _cb,\n"
     "        mi,\n"
     "        cc,\n"
     "        cr,\n"
     "        cop,\n"
-    "        <ALIAS>_ClassName,\n"
     "        assocClass,\n"
-    "        role);\n"
+    "        role));\n"
     "}\n"
     "\n"
     "CMInstanceMIStub( \n"
@@ -2245,73 +2847,152 @@ const char INDICATION_PROVIDER[] =
     "\n"
     "static const CMPIBroker* _cb = NULL;\n"
     "\n"
+    "/* Delivers indications while they are enabled (guarded by _lock) */\n"
+    "static KIndicationQueue* _queue = NULL;\n"
+    "static pthread_mutex_t _lock = PTHREAD_MUTEX_INITIALIZER;\n"
+    "\n"
+    "/* Namespace of the subscriptions (from the first filter activated) */\n"
+    "static char* _ns = NULL;\n"
+    "\n"
+    "/* Filters of the active subscriptions */\n"
+    "static KFilters _filters = KFILTERS_INIT(__<ALIAS>_sig);\n"
+    "\n"
     "static void <ALIAS>Initialize()\n"
     "{\n"
     "}\n"
     "\n"
+    "/* Call this to raise an indication; it never blocks on the CIMOM */\n"
+    "static KUNUSED CMPIStatus <ALIAS>Deliver(\n"
+    "    const <ALIAS>* self,\n"
+    "    const char* key)\n"
+    "{\n"
+    "    CMPIInstance* ci;\n"
+    "    CMPIStatus st = KSTATUS_INIT;\n"
+    "\n"
+    "    /* Skip indications that no subscriber wants */\n"
+    "    if (!KFilters_Match(&_filters, &self->__base))\n"
+    "        CMReturn(CMPI_RC_OK);\n"
+    "\n"
+    "    if (!(ci = <ALIAS>_ToInstance(self, &st)))\n"
+    "        return st;\n"
+    "\n"
+    "    pthread_mutex_lock(&_lock);\n"
+    "\n"
+    "    if (_queue)\n"
+    "        st = KIndicationQueue_Deliver(_queue, ci, key);\n"
+    "\n"
+    "    pthread_mutex_unlock(&_lock);\n"
+    "\n"
+    "    /* The queue keeps a clone */\n"
+    "    CMRelease(ci);\n"
+    "    return st;\n"
+    "}\n"
+    "\n"
     "static CMPIStatus <ALIAS>IndicationCleanup(\n"
     "    CMPIIndicationMI* mi,\n"
     "    const CMPIContext* cc,\n"
     "    CMPIBoolean term)\n"
     "{\n"
-    "    CMReturn(CMPI_RC_OK);\n"
+    "    pthread_mutex_lock(&_lock);\n"
+    "    KIndicationQueue_Delete(_queue);\n"
+    "    _queue = NULL;\n"
+    "    free(_ns);\n"
+    "    _ns = NULL;\n"
+    "    pthread_mutex_unlock(&_lock);\n"
+    "    KFilters_Clear(&_filters);\n"
+    "    KArenaReturn(KStatus(OK));\n"
     "}\n"
     "\n"
     "static CMPIStatus <ALIAS>AuthorizeFilter(\n"
     "    CMPIIndicationMI* mi,\n"
     "    const CMPIContext* cc,\n"
     "    const CMPISelectExp* se,\n"
-    "    const char* ns,\n"
+    "    const char* className,\n"
     "    const CMPIObjectPath* op,\n"
     "    const char* user)\n"
     "{\n"
-    "    CMReturn(CMPI_RC_OK);\n"
+    "    KArenaReturn(KStatus(OK));\n"
     "}\n"
     "\n"
     "static CMPIStatus <ALIAS>MustPoll(\n"
     "    CMPIIndicationMI* mi,\n"
     "    const CMPIContext* cc,\n"
     "    const CMPISelectExp* se,\n"
-    "    const char* ns, \n"
+    "    const char* className, \n"
     "    const CMPIObjectPath* op)\n"
     "{\n"
-    "    CMReturn(CMPI_RC_ERR_NOT_SUPPORTED);\n"
+    "    KArenaReturn(KStatus(ERR_NOT_SUPPORTED));\n"
     "}\n"
     "\n"
     "static CMPIStatus <ALIAS>ActivateFilter(\n"
     "    CMPIIndicationMI* mi,\n"
     "    const CMPIContext* cc,\n"
     "    const CMPISelectExp* se,\n"
-    "    const char* ns,\n"
+    "    const char* className,\n"
     "    const CMPIObjectPath* op,\n"
     "    CMPIBoolean firstActivation)\n"
     "{\n"
-    "    CMReturn(CMPI_RC_OK);\n"
+    "    const char* ns = KNameSpace(op);\n"
+    "\n"
+    "    pthread_mutex_lock(&_lock);\n"
+    "\n"
+    "    if (!_ns && ns && *ns)\n"
+    "        _ns = strdup(ns);\n"
+    "\n"
+    "    pthread_mutex_unlock(&_lock);\n"
+    "\n"
+    "    KArenaReturn(KFilters_Activate(&_filters, se));\n"
     "}\n"
     "\n"
     "static CMPIStatus <ALIAS>DeActivateFilter(\n"
     "    CMPIIndicationMI* mi,\n"
     "    const CMPIContext* cc,\n"
     "    const CMPISelectExp* se,\n"
-    "    const char* ns,\n"
+    "    const char* className,\n"
     "    const CMPIObjectPath* op,\n"
     "    CMPIBoolean lastActivation)\n"
     "{\n"
-    "    CMReturn(CMPI_RC_OK);\n"
+    "    KArenaReturn(KFilters_Deactivate(&_filters, se));\n"
     "}\n"
     "\n"
     "static CMPIStatus <ALIAS>EnableIndications(\n"
     "    CMPIIndicationMI* mi, \n"
     "    const CMPIContext* cc)\n"
     "{\n"
-    "    CMReturn(CMPI_RC_OK);\n"
+    "    CMPIStatus st = KSTATUS_INIT;\n"
+    "    const char* ns;\n"
+    "    CMPIData data;\n"
+    "\n"
+    "    pthread_mutex_lock(&_lock);\n"
+    "\n"
+    "    /* Without a filter yet, use the namespace of the context */\n"
+    "    if (!(ns = _ns))\n"
+    "    {\n"
+    "        data = CMGetContextEntry(cc, CMPIInitNameSpace, NULL);\n"
+    "\n"
+    "        if (data.type == CMPI_string && data.value.string)\n"
+    "            ns = KChars(data.value.string);\n"
+    "    }\n"
+    "\n"
+    "    if (!_queue &&\n"
+    "        (!ns || !(_queue = KIndicationQueue_New(_cb, cc, ns, NULL))))\n"
+    "    {\n"
+    "        KSetStatus(&st, ERR_FAILED);\n"
+    "    }\n"
+    "\n"
+    "    pthread_mutex_unlock(&_lock);\n"
+    "    KArenaReturn(st);\n"
     "}\n"
     "\n"
     "static CMPIStatus <ALIAS>DisableIndications(\n"
     "    CMPIIndicationMI* mi, \n"
     "    const CMPIContext* cc)\n"
     "{\n"
-    "    CMReturn(CMPI_RC_OK);\n"
+    "    pthread_mutex_lock(&_lock);\n"
+    "    KIndicationQueue_Delete(_queue);\n"
+    "    _queue = NULL;\n"
+    "    pthread_mutex_unlock(&_lock);\n"
+    "    KArenaReturn(KStatus(OK));\n"
     "}\n"
     "\n"
     "CMIndicationMIStub(\n"
@@ -2321,292 +3002,1248 @@ const char INDICATION_PROVIDER[] =
     "    <ALIAS>Initialize())\n";
 
 
-static void expropers_decls(string &chunk, map<string,string> prules, const MOF_Class_Decl* cd)
+//==============================================================================
+//
+// Templates
+//
+//     Provider and method templates and the -R, -P, -O and -i rules are
+//     compiled once into literal text and placeholders, then rendered for each
+//     class (or method) in a single pass. Each rule replaces its pattern in
+//     the template and in the text inserted by the rules before it, so the
+//     text of a rule is compiled against the rules after it only. <ALIAS>,
+//     <CLASS>, <MNAME> and <MTYPE> apply to everything.
+//
+//==============================================================================
+
+enum Slot
 {
-    string append;
+    SLOT_TEXT = -1,
+    SLOT_ALIAS = -2,
+    SLOT_CLASS = -3,
+    SLOT_MNAME = -4,
+    SLOT_MTYPE = -5,
+    SLOT_TYPE = -6,
+    SLOT_NAME = -7
+};
+
+// Literal text, or a placeholder (the index of a rule or one of the slots
+// above) along with the pattern it replaces:
+
+struct Segment
+{
+    int slot;
+    string text;
+};
 
-    for (MOF_Feature_Info* p = cd->all_features; p;
-        p = (MOF_Feature_Info*)p->next)
+struct Template
+{
+    vector<Segment> segments;
+    size_t size;
+};
+
+struct Pattern
+{
+    string text;
+    int slot;
+};
+
+struct Rule
+{
+    char kind;
+    string pattern;
+    string file;
+    Template text;
+    map<string, Template> types;
+};
+
+// What placeholders stand for (null leaves the pattern as it is):
+
+struct Values
+{
+    const MOF_Class_Decl* cd;
+    const MOF_Method_Decl* md;
+    const char* alias;
+    const char* mname;
+    const char* mtype;
+    const char* type;
+    const char* name;
+};
+
+static vector<Rule> _rules;
+static Template _method_template;
+static Template _association_template;
+static Template _indication_template;
+static Template _instance_template;
+
+static void _add_literal(Template& t, const string& text, size_t pos, size_t n)
+{
+    if (!n)
+        return;
+
+    Segment seg;
+    seg.slot = SLOT_TEXT;
+    seg.text = text.substr(pos, n);
+    t.segments.push_back(seg);
+    t.size += n;
+}
+
+static void compile(
+    Template& t, 
+    const string& text, 
+    const vector<Pattern>& patterns)
+{
+    size_t start = 0;
+
+    t.segments.clear();
+    t.size = 0;
+
+    for (size_t i = 0; i < text.size(); )
     {
-        MOF_Feature* mf = p->feature;
+        const Pattern* match = NULL;
 
-        if (strcasecmp(cd->name, p->class_origin->name) != 0)
+        for (size_t j = 0; j < patterns.size(); j++)
+        {
+            const string& p = patterns[j].text;
+
+            if (p.size() && p[0] == text[i] && text.compare(i, p.size(), p) == 0)
+            {
+                match = &patterns[j];
+                break;
+            }
+        }
+
+        if (!match)
+        {
+            i++;
             continue;
+        }
+
+        _add_literal(t, text, start, i - start);
+
+        Segment seg;
+        seg.slot = match->slot;
+        seg.text = match->text;
+        t.segments.push_back(seg);
+
+        i += match->text.size();
+        start = i;
+    }
+
+    _add_literal(t, text, start, text.size() - start);
+}
+
+// The patterns for text inserted by rule N-1 (rule 0 for templates), with
+// TYPE and NAME (if any) standing for <PTYPE> and <PNAME> or the like:
+
+static vector<Pattern> _patterns(size_t n, const char* type, const char* name)
+{
+    vector<Pattern> patterns;
+    Pattern p;
+
+    if (type)
+    {
+        p.text = type;
+        p.slot = SLOT_TYPE;
+        patterns.push_back(p);
+        p.text = name;
+        p.slot = SLOT_NAME;
+        patterns.push_back(p);
+    }
+
+    for (size_t i = n; i < _rules.size(); i++)
+    {
+        p.text = _rules[i].pattern;
+        p.slot = (int)i;
+        patterns.push_back(p);
+    }
+
+    const char* const names[] = { "<MNAME>", "<MTYPE>", "<ALIAS>", "<CLASS>" };
+    const int slots[] = { SLOT_MNAME, SLOT_MTYPE, SLOT_ALIAS, SLOT_CLASS };
+
+    for (size_t i = 0; i < 4; i++)
+    {
+        p.text = names[i];
+        p.slot = slots[i];
+        patterns.push_back(p);
+    }
+
+    return patterns;
+}
+
+static void _compile_types(
+    Rule& rule, 
+    const map<string,string>& types, 
+    size_t n,
+    const char* type, 
+    const char* name)
+{
+    vector<Pattern> patterns = _patterns(n, type, name);
+    map<string,string>::const_iterator p;
+
+    for (p = types.begin(); p != types.end(); p++)
+        compile(rule.types[p->first], p->second, patterns);
+}
+
+static const char METHOD_BODY_LEAD[] =
+    "{\n"
+    "    $0 result = $1_INIT;\n"
+    "\n";
+
+// Compiles the rules (in command line order) and the templates, before any
+// worker starts rendering them:
+
+static void compile_templates()
+{
+    vector<pair<string,string> >::iterator ri = rall.begin();
+    vector<pair<string,map<string,string> > >::iterator pi = pall.begin();
+    vector<pair<string,map<string,string> > >::iterator oi = oall.begin();
+    vector<pair<string,map<string,string> > >::iterator ii = iall.begin();
+
+    for (size_t i = 0; i < torder.size(); i++)
+    {
+        Rule rule;
+        rule.kind = torder[i];
+
+        if (rule.kind == 'R')
+        {
+            rule.pattern = ri->first;
+            rule.file = (ri++)->second;
+        }
+        else if (rule.kind == 'P')
+            rule.pattern = (pi++)->first;
+        else if (rule.kind == 'O')
+            rule.pattern = (oi++)->first;
+        else
+            rule.pattern = (ii++)->first;
+
+        _rules.push_back(rule);
+    }
+
+    pi = pall.begin();
+    oi = oall.begin();
+    ii = iall.begin();
+
+    for (size_t i = 0; i < _rules.size(); i++)
+    {
+        Rule& rule = _rules[i];
+
+        switch (rule.kind)
+        {
+            case 'R':
+                compile(rule.text, extemplate(rule.file.c_str()), 
+                    _patterns(i + 1, NULL, NULL));
+                break;
+            case 'P':
+                _compile_types(rule, (pi++)->second, i + 1, 
+                    "<PTYPE>", "<PNAME>");
+                break;
+            case 'O':
+                _compile_types(rule, (oi++)->second, i + 1, 
+                    "<MOTYPE>", "<MONAME>");
+                break;
+            case 'i':
+                _compile_types(rule, (ii++)->second, i + 1, 
+                    "<MITYPE>", "<MINAME>");
+                break;
+        }
+    }
+
+    vector<Pattern> patterns = _patterns(0, NULL, NULL);
+
+    compile(_method_template, METHOD_BODY_LEAD + etm, patterns);
+    compile(_association_template, 
+        eta.empty() ? ASSOCIATION_PROVIDER : eta, patterns);
+    compile(_indication_template, 
+        etn.empty() ? INDICATION_PROVIDER : etn, patterns);
+    compile(_instance_template, eti.empty() ? INSTANCE_PROVIDER : eti, patterns);
+}
+
+static void _render(const Template& t, const Values& v, string& out);
+
+static string _rule_type(int data_type, int array_index)
+{
+    string type = _ktype_name(data_type);
+
+    if (array_index != 0)
+        type += "A";
+
+    return type;
+}
+
+static void _render_type(
+    const Rule& rule, 
+    const string& type, 
+    const char* name,
+    const Values& v, 
+    string& out)
+{
+    map<string, Template>::const_iterator pos = rule.types.find(type);
+
+    if (pos == rule.types.end())
+        return;
+
+    Values tmp = v;
+    tmp.type = type.c_str();
+    tmp.name = name;
+    _render(pos->second, tmp, out);
+}
+
+// Properties declared by this class, after those of its super classes:
+
+static void _render_properties(
+    const Rule& rule, 
+    const MOF_Class_Decl* cd, 
+    const Values& v, 
+    string& out)
+{
+    if (cd->super_class)
+        _render_properties(rule, cd->super_class, v, out);
+
+    for (MOF_Feature_Info* p = cd->all_features; p;
+        p = (MOF_Feature_Info*)p->next)
+    {
+        if (strcasecmp(cd->name, p->class_origin->name) != 0)
+            continue;
+
+        MOF_Property_Decl* pd = dynamic_cast<MOF_Property_Decl*>(p->feature);
+
+        if (pd)
+        {
+            string type = _rule_type(pd->data_type, pd->array_index);
+            _render_type(rule, type, pd->name, v, out);
+        }
+    }
+}
+
+static void _render_rule(
+    const Rule& rule, 
+    const string& pattern, 
+    const Values& v, 
+    string& out)
+{
+    if (rule.kind == 'R')
+    {
+        _render(rule.text, v, out);
+        return;
+    }
+
+    if (rule.kind == 'P')
+    {
+        _render_properties(rule, v.cd, v, out);
+        return;
+    }
+
+    // Argument rules only apply to methods:
+
+    if (!v.md)
+    {
+        out += pattern;
+        return;
+    }
+
+    MOF_mask mask = rule.kind == 'O' ? MOF_QT_OUT : MOF_QT_IN;
+
+    for (MOF_Parameter* p = v.md->parameters; p; p = (MOF_Parameter*)p->next)
+    {
+        if (p->qual_mask & mask)
+        {
+            string type = _rule_type(p->data_type, p->array_index);
+            _render_type(rule, type, p->name, v, out);
+        }
+    }
+}
+
+static void _render(const Template& t, const Values& v, string& out)
+{
+    for (size_t i = 0; i < t.segments.size(); i++)
+    {
+        const Segment& seg = t.segments[i];
+        const char* value = NULL;
+
+        switch (seg.slot)
+        {
+            case SLOT_TEXT:
+                out += seg.text;
+                continue;
+            case SLOT_ALIAS:
+                value = v.alias;
+                break;
+            case SLOT_CLASS:
+                value = v.cd->name;
+                break;
+            case SLOT_MNAME:
+                value = v.mname;
+                break;
+            case SLOT_MTYPE:
+                value = v.mtype;
+                break;
+            case SLOT_TYPE:
+                value = v.type;
+                break;
+            case SLOT_NAME:
+                value = v.name;
+                break;
+            default:
+                _render_rule(_rules[seg.slot], seg.text, v, out);
+                continue;
+        }
+
+        out += value ? value : seg.text.c_str();
+    }
+}
+
+// Renders a provider template (md null) or the method template:
+
+static string render(
+    const Template& t, 
+    const MOF_Class_Decl* cd, 
+    const MOF_Method_Decl* md)
+{
+    Values v;
+    v.cd = cd;
+    v.md = md;
+    v.alias = alias(cd->name);
+    v.mname = md ? md->name : NULL;
+    v.mtype = md ? _ktype_name(md->data_type) : NULL;
+    v.type = NULL;
+    v.name = NULL;
+
+    for (size_t i = 0; i < _rules.size(); i++)
+    {
+        const char* pattern = _rules[i].pattern.c_str();
+
+        switch (_rules[i].kind)
+        {
+            case 'R':
+                note("%s replaced for %s\n", pattern, _rules[i].file.c_str());
+                break;
+            case 'P':
+                note("%s transformed to properties.\n", pattern);
+                break;
+            case 'O':
+                if (md)
+                    note("%s transformed to method output arguments.\n", 
+                        pattern);
+                break;
+            case 'i':
+                if (md)
+                    note("%s transformed to method input arguments.\n", 
+                        pattern);
+                break;
+        }
+    }
+
+    string out;
+    out.reserve(t.size);
+    _render(t, v, out);
+    return out;
+}
+
+static string render_method(const MOF_Class_Decl* cd, const MOF_Method_Decl* md)
+{
+    return render(_method_template, cd, md);
+}
+
+// In library mode, make a provider use the broker and string pool of the
+// library rather than its own:
+
+static void share_library_state(string& text)
+{
+    if (library.empty())
+        return;
+
+    string cb =
+        "#include \"" + library + ".h\"\n"
+        "\n"
+        "#define _cb " + library + "_cb\n";
+
+    substitute(text, "static const CMPIBroker* _cb = NULL;\n", cb);
+    substitute(text, "static const CMPIBroker* _cb;\n", cb);
+
+    substitute(text,
+        "static KUNUSED KStringPool _pool = KSTRINGPOOL_INIT;\n",
+        "#define _pool " + library + "_pool\n");
+
+    // The library clears the pool once all of its MIs are cleaned up:
+
+    substitute(text, "    KStringPool_Clear(&_pool);\n", "");
+}
+
+static bool less_nocase(const string& x, const string& y)
+{
+    return strcasecmp(x.c_str(), y.c_str()) < 0;
+}
+
+static void gen_library()
+{
+    const char* lib = library.c_str();
+    string path;
+    Output out;
+    FILE* os;
+
+    // Generate comment box:
+
+    const char BOX[] =
+        "/*\n"
+        "**$0$0\n"
+        "**\n"
+        "** CAUTION: This file generated by KonkretCMPI. Please do not edit.\n"
+        "**\n"
+        "**$0$0\n"
+        "*/\n"
+        "\n";
+
+    // Write the header shared by the providers of the library:
+
+    path = library + ".h";
+
+    if (!(os = open_output(out, path)))
+        err("failed to open %s for write", path.c_str());
+
+    put(os, BOX, LINE39, NULL);
+
+    /* $0=lib */
+    const char HEADER[] =
+        "#ifndef _konkrete_$0_h\n"
+        "#define _konkrete_$0_h\n"
+        "\n"
+        "#include <konkret/konkret.h>\n"
+        "\n"
+        "/* Shared by every provider in the $0 library */\n"
+        "KEXTERN const CMPIBroker* $0_cb;\n"
+        "KEXTERN KStringPool $0_pool;\n"
+        "\n"
+        "#endif /* _konkrete_$0_h */\n";
+
+    put(os, HEADER, lib, NULL);
+    close_output(out);
+
+    // Write the dispatcher:
+
+    path = library + ".c";
+
+    if (!(os = open_output(out, path)))
+        err("failed to open %s for write", path.c_str());
+
+    put(os, BOX, LINE39, NULL);
+
+    /* $0=lib */
+    const char SOURCE[] =
+        "#include <konkret/konkret.h>\n"
+        "#include \"$0.h\"\n"
+        "\n"
+        "const CMPIBroker* $0_cb = NULL;\n"
+        "\n"
+        "KStringPool $0_pool = KSTRINGPOOL_INIT;\n"
+        "\n";
+
+    put(os, SOURCE, lib, NULL);
+
+    // Sort the classes for KLibrary's binary search:
+
+    vector<string> classes = skeletons;
+    sort(classes.begin(), classes.end(), less_nocase);
+
+    // Declare the entry points of each class's provider:
+
+    for (size_t i = 0; i < classes.size(); i++)
+    {
+        const MOF_Class_Decl* cd = _find_class(classes[i].c_str());
+        vector<const char*> types;
+
+        if (cd->qual_mask & MOF_QT_ASSOCIATION)
+        {
+            types.push_back("Instance");
+            types.push_back("Association");
+        }
+        else if (cd->qual_mask & MOF_QT_INDICATION)
+            types.push_back("Indication");
+        else
+        {
+            types.push_back("Instance");
+            types.push_back("Method");
+        }
+
+        for (size_t j = 0; j < types.size(); j++)
+        {
+            /* $0=class $1=type */
+            const char FMT[] =
+                "CMPI_EXTERN_C CMPI$1MI* $0_Create_$1MI(\n"
+                "    const CMPIBroker* mb,\n"
+                "    const CMPIContext* cc,\n"
+                "    CMPIStatus* st);\n"
+                "\n";
+
+            put(os, FMT, cd->name, types[j], NULL);
+        }
+    }
+
+    // Generate the class table:
+
+    put(os, "static KLibraryClass _classes[] =\n{\n", NULL);
+
+    for (size_t i = 0; i < classes.size(); i++)
+    {
+        const MOF_Class_Decl* cd = _find_class(classes[i].c_str());
+        bool assoc = cd->qual_mask & MOF_QT_ASSOCIATION;
+        bool ind = cd->qual_mask & MOF_QT_INDICATION;
+        string cn = cd->name;
+
+        /* $0=class $1=instance $2=method $3=association $4=indication */
+        const char FMT[] =
+            "    KLIBRARYCLASS_INIT(\n"
+            "        \"$0\",\n"
+            "        $1,\n"
+            "        $2,\n"
+            "        $3,\n"
+            "        $4),\n";
+
+        put(os, FMT, 
+            cd->name,
+            ind ? "NULL" : (cn + "_Create_InstanceMI").c_str(),
+            ind || assoc ? "NULL" : (cn + "_Create_MethodMI").c_str(),
+            assoc ? (cn + "_Create_AssociationMI").c_str() : "NULL",
+            ind ? (cn + "_Create_IndicationMI").c_str() : "NULL",
+            NULL);
+    }
+
+    put(os, "};\n\n", NULL);
+
+    /* $0=lib */
+    const char STUBS[] =
+        "static KLibrary _library = KLIBRARY_INIT(_classes, &$0_pool);\n"
+        "\n"
+        "KLibraryMIStub(\n"
+        "    $0,\n"
+        "    _library,\n"
+        "    $0_cb)\n"
+        "\n";
+
+    put(os, STUBS, lib, NULL);
+
+    // Write out the combined KONKRET_REGISTRATION_BLOCK() macro:
+
+    fprintf(os, "KONKRET_REGISTRATION_BLOCK(\n");
+
+    for (size_t i = 0; i < classes.size(); i++)
+    {
+        const MOF_Class_Decl* cd = _find_class(classes[i].c_str());
+        const char* provider_types;
+
+        if (cd->qual_mask & MOF_QT_ASSOCIATION)
+            provider_types = "instance association";
+        else if (cd->qual_mask & MOF_QT_INDICATION)
+            provider_types = "indication";
+        else
+            provider_types = "instance method";
+
+        if (i)
+            fprintf(os, "    \";\"\n");
+
+        fprintf(os, "    KONKRET_REGISTRATION_ENTRY(\"%s\", \"%s\", \"%s\", \"%s\")%s\n",
+            "root/cimv2", cd->name, lib, provider_types,
+            i + 1 == classes.size() ? ")" : "");
+    }
+
+    close_output(out);
+}
+
+static void gen_provider(const MOF_Class_Decl* cd)
+{
+    const char* sn = alias(cd->name);
+    FILE* os;
+
+    // Form source file name
+
+    char path[1024];
+    if (ofile.length()<=0) {
+        sprintf(path, "%sProvider.c", sn);
+    } else {
+        sprintf(path, "%s", ofile.c_str());
+    }
+
+    if ((os = fopen(path, "r")))
+    {
+        fclose(os);
+        note("Skipped %s (already exists)\n", path);
+        return;
+    }
+
+    // Open stubs source file:
+
+    if (!(os = fopen(path, "w")))
+    {
+        err("failed to open %s for write", path);
+    }
+
+    // Generate provider source file.
+
+    if (cd->qual_mask & MOF_QT_ASSOCIATION)
+    {
+        // Association provider:
+        string text = render(_association_template, cd, NULL);
+        share_library_state(text);
+        fprintf(os, "%s", text.c_str());
+    }
+    else if (cd->qual_mask & MOF_QT_INDICATION)
+    {
+        // Indication provider:
+        string text = render(_indication_template, cd, NULL);
+        share_library_state(text);
+        fprintf(os, "%s", text.c_str());
+    }
+    else
+    {
+        // Instance provider:
+        string text = render(_instance_template, cd, NULL);
+        share_library_state(text);
+        fprintf(os, "%s", text.c_str());
+    }
+
+    // Generate method stubs.
+
+    fprintf(os, "\n");
+    gen_meth_stubs(os, cd);
+
+    // The library registers all of its classes (see gen_library()):
+
+    if (library.size())
+    {
+        fclose(os);
+        note("Created %s\n", path);
+        return;
+    }
+
+    // Write out KONKRET_REGISTRATION() macro:
+
+    string provider_types;
+
+    if (cd->qual_mask & MOF_QT_ASSOCIATION)
+        provider_types = "instance association";
+    else if (cd->qual_mask & MOF_QT_INDICATION)
+        provider_types = "indication";
+    else
+        provider_types = "instance method";
+
+    fprintf(os, "KONKRET_REGISTRATION(\n");
+    fprintf(os, "    \"%s\",\n", "root/cimv2");
+    fprintf(os, "    \"%s\",\n", cd->name);
+    fprintf(os, "    \"%s\",\n", cd->name);
+    fprintf(os, "    \"%s\")\n", provider_types.c_str());
+
+    // Close the file:
+    fclose(os);
+    note("Created %s\n", path);
+}
+
+// A wrapper member that forwards to one of the generated C functions (PARAMS
+// are its parameters after self and ARGS their names):
+
+struct CxxFunc
+{
+    string ret;
+    string name;
+    string params;
+    string args;
+};
+
+static void add_cxx_func(
+    vector<CxxFunc>& funcs,
+    const string& ret,
+    const string& name,
+    const string& params = string(),
+    const string& args = string())
+{
+    CxxFunc f;
+    f.ret = ret;
+    f.name = name;
+    f.params = params;
+    f.args = args;
+    funcs.push_back(f);
+}
+
+static void cxx_funcs(
+    const MOF_Class_Decl* cd,
+    const MOF_Feature* mf,
+    vector<CxxFunc>& funcs)
+{
+    const char* pn = mf->name;
+    const MOF_Property_Decl* mpd = dynamic_cast<const MOF_Property_Decl*>(mf);
+    const MOF_Reference_Decl* mrd = 
+        dynamic_cast<const MOF_Reference_Decl*>(mf);
+
+    // These mirror gen_features(), which generates the C functions:
+
+    if (!mpd)
+    {
+        string rt = string("const ::") + alias(mrd->class_name) + "Ref* x";
+
+        add_cxx_func(funcs, "void", string("SetObjectPath_") + pn, 
+            "const CMPIObjectPath* x", "x");
+        add_cxx_func(funcs, "CMPIStatus", string("Set_") + pn, rt, "x");
+        add_cxx_func(funcs, "void", string("Null_") + pn);
+        add_cxx_func(funcs, "void", string("Clr_") + pn);
+        return;
+    }
+
+    const char* ext = mpd->data_type == TOK_STRING ? "String" : "";
+    string ctn = _ctype_name(mpd->data_type);
+    string ktn = _ktype_name(mpd->data_type);
+
+    if (mpd->array_index == 0)
+    {
+        add_cxx_func(funcs, "void", string("Set") + ext + "_" + pn, 
+            ctn + " x", "x");
+
+        if (mpd->data_type == TOK_STRING)
+        {
+            add_cxx_func(funcs, "void", string("Set_") + pn, 
+                "const char* s", "s");
+            add_cxx_func(funcs, "void", string("SetInterned_") + pn, 
+                "KStringPool* pool, const char* s", "pool, s");
+        }
+
+        add_cxx_func(funcs, "void", string("Null_") + pn);
+    }
+    else
+    {
+        add_cxx_func(funcs, "CMPIBoolean", string("Init_") + pn, 
+            "CMPICount count", "count");
+        add_cxx_func(funcs, "void", string("InitNull_") + pn);
+        add_cxx_func(funcs, "CMPIBoolean", string("Set") + ext + "_" + pn, 
+            "CMPICount i, " + ctn + " x", "i, x");
+        add_cxx_func(funcs, ktn, string("Get") + ext + "_" + pn, 
+            "CMPICount i", "i");
+
+        if (mpd->data_type == TOK_STRING)
+        {
+            add_cxx_func(funcs, "CMPIBoolean", string("Set_") + pn, 
+                "CMPICount i, const char* s", "i, s");
+            add_cxx_func(funcs, "const char*", string("Get_") + pn, 
+                "CMPICount i", "i");
+        }
+
+        add_cxx_func(funcs, "CMPIBoolean", string("Null_") + pn, 
+            "CMPICount i", "i");
+    }
+
+    add_cxx_func(funcs, "void", string("Clr_") + pn);
+}
+
+static void gen_cxx_class(
+    FILE* os,
+    const MOF_Class_Decl* cd,
+    const char* sn,
+    bool ref)
+{
+    // Collect the fields in the order of the feature list:
+
+    vector<const MOF_Feature*> fields;
+
+    for (MOF_Feature_Info* p = cd->all_features; p;
+        p = (MOF_Feature_Info*)p->next)
+    {
+        MOF_Feature* mf = p->feature;
+
+        if (dynamic_cast<MOF_Method_Decl*>(mf))
+            continue;
+
+        if (ref && !_is_key(cd, mf->name))
+            continue;
+
+        fields.push_back(mf);
+    }
+
+    // Field metadata (offsets and type tags):
+
+    if (fields.size())
+    {
+        put(os, "constexpr Field __$0_fields[] =\n{\n", sn, NULL);
+
+        for (size_t i = 0; i < fields.size(); i++)
+        {
+            const MOF_Feature* mf = fields[i];
+            const MOF_Property_Decl* mpd = 
+                dynamic_cast<const MOF_Property_Decl*>(mf);
+            bool key = _is_key(cd, mf->name);
+            KTag tag;
+            char buf[8];
+
+            if (!mpd)
+                tag = KTYPE_REFERENCE | (key ? KTAG_KEY : 0);
+            else if (mpd->qualifiers->has_key("EmbeddedInstance"))
+                tag = _ktag(TOK_INSTANCE, mpd->array_index, key, false, false);
+            else
+                tag = _ktag(mpd->data_type, mpd->array_index, key, false, false);
+
+            sprintf(buf, "0x%02x", tag);
+
+            put(os, "    { \"$0\", offsetof(::$1, $0), $2 },\n", 
+                mf->name, sn, buf, NULL);
+        }
+
+        put(os, "};\n\n", NULL);
+    }
+
+    // Class header and the common members:
+
+    /* $0=sn $1=cn $2=num-fields $3=fields */
+    const char HEADER[] =
+        "class $0\n"
+        "{\n"
+        "public:\n"
+        "\n"
+        "    typedef ::$0 CType;\n"
+        "\n"
+        "    static constexpr const char* ClassName() { return \"$1\"; }\n"
+        "\n"
+        "    static constexpr size_t NumFields = $2;\n"
+        "\n"
+        "    static constexpr const Field* Fields() { return $3; }\n"
+        "\n"
+        "    $0(const CMPIBroker* cb, const char* ns) : _self{}\n"
+        "    {\n"
+        "        ::$0_Init(&_self, cb, ns);\n"
+        "    }\n"
+        "\n"
+        "    CMPIStatus InitFromInstance(\n"
+        "        const CMPIBroker* cb, const CMPIInstance* x)\n"
+        "    {\n"
+        "        return ::$0_InitFromInstance(&_self, cb, x);\n"
+        "    }\n"
+        "\n"
+        "    CMPIStatus InitFromObjectPath(\n"
+        "        const CMPIBroker* cb, const CMPIObjectPath* x)\n"
+        "    {\n"
+        "        return ::$0_InitFromObjectPath(&_self, cb, x);\n"
+        "    }\n"
+        "\n"
+        "    Handle<CMPIInstance> ToInstance(CMPIStatus* st = nullptr) const\n"
+        "    {\n"
+        "        return Handle<CMPIInstance>(::$0_ToInstance(&_self, st));\n"
+        "    }\n"
+        "\n"
+        "    Handle<CMPIObjectPath> ToObjectPath(CMPIStatus* st = nullptr) const\n"
+        "    {\n"
+        "        return Handle<CMPIObjectPath>(::$0_ToObjectPath(&_self, st));\n"
+        "    }\n"
+        "\n"
+        "    void Print(FILE* os) const\n"
+        "    {\n"
+        "        ::$0_Print(&_self, os);\n"
+        "    }\n"
+        "\n"
+        "    const char* NameSpace()\n"
+        "    {\n"
+        "        return ::$0_NameSpace(&_self);\n"
+        "    }\n"
+        "\n"
+        "    CType* c() { return &_self; }\n"
+        "\n"
+        "    const CType* c() const { return &_self; }\n"
+        "\n";
+
+    char num[32];
+    sprintf(num, "%u", (unsigned)fields.size());
+    string fp = fields.size() ? string("__") + sn + "_fields" : "nullptr";
+
+    put(os, HEADER, sn, cd->name, num, fp.c_str(), NULL);
+
+    if (ref)
+    {
+        /* $0=sn */
+        const char HASH[] =
+            "    CMPIUint32 Hash() const\n"
+            "    {\n"
+            "        return ::$0_Hash(&_self);\n"
+            "    }\n"
+            "\n"
+            "    bool Equal(const $0& x) const\n"
+            "    {\n"
+            "        return ::$0_Equal(&_self, &x._self) ? true : false;\n"
+            "    }\n"
+            "\n";
+
+        put(os, HASH, sn, NULL);
+    }
+
+    // Per-field accessors and forwarders to the C functions:
+
+    for (size_t i = 0; i < fields.size(); i++)
+    {
+        const MOF_Feature* mf = fields[i];
+        vector<CxxFunc> funcs;
+
+        /* $0=pn */
+        const char FIELD[] =
+            "    const decltype(CType::$0)& Field_$0() const\n"
+            "    {\n"
+            "        return _self.$0;\n"
+            "    }\n"
+            "\n";
+
+        put(os, FIELD, mf->name, NULL);
+
+        cxx_funcs(cd, mf, funcs);
+
+        for (size_t j = 0; j < funcs.size(); j++)
+        {
+            const CxxFunc& f = funcs[j];
+            string args = f.args.empty() ? "" : ", " + f.args;
+
+            /* $0=sn $1=ret $2=func $3=params $4=args */
+            const char FUNC[] =
+                "    $1 $2($3)\n"
+                "    {\n"
+                "        return ::$0_$2(&_self$4);\n"
+                "    }\n"
+                "\n";
+
+            put(os, FUNC, sn, f.ret.c_str(), f.name.c_str(), 
+                f.params.c_str(), args.c_str(), NULL);
+        }
+    }
+
+    // Visitors over the fields (called with the Field and the value, which
+    // the non-const one may modify):
+
+    for (int c = 0; c < 2; c++)
+    {
+        put(os, "    template<class V>\n    void Visit(V&& v)$0\n    {\n", 
+            c ? "" : " const", NULL);
+
+        if (fields.empty())
+            put(os, "        (void)v;\n", NULL);
+
+        for (size_t i = 0; i < fields.size(); i++)
+        {
+            char idx[32];
+            sprintf(idx, "%u", (unsigned)i);
+            put(os, "        v(__$0_fields[$1], _self.$2);\n", 
+                sn, idx, fields[i]->name, NULL);
+        }
+
+        put(os, "    }\n\n", NULL);
+    }
+
+    /* $0=sn */
+    const char TRAILER[] =
+        "private:\n"
+        "    CType _self;\n"
+        "};\n"
+        "\n";
+
+    put(os, TRAILER, sn, NULL);
+}
+
+static void gen_cxx(const MOF_Class_Decl* cd, const char* al)
+{
+    string path = string(al) + ".hpp";
+    string rn = string(al) + "Ref";
+
+    Output out;
+    FILE* os = open_output(out, path);
+
+    if (!os)
+        err("failed to open %s", path.c_str());
+
+    const char BOX[] =
+        "/*\n"
+        "**$0$0\n"
+        "**\n"
+        "** CAUTION: This file generated by KonkretCMPI. Please do not edit.\n"
+        "**\n"
+        "**$0$0\n"
+        "*/\n"
+        "\n";
+
+    put(os, BOX, LINE39, NULL);
+
+    /* $0=al */
+    const char HEADER[] =
+        "#ifndef _konkrete_$0_hpp\n"
+        "#define _konkrete_$0_hpp\n"
+        "\n"
+        "#include <konkret/konkret.hpp>\n"
+        "#include \"$0.h\"\n"
+        "\n"
+        "namespace konkret {\n"
+        "namespace schema {\n"
+        "\n";
 
-        // CIM_Class_Property:
+    put(os, HEADER, al, NULL);
 
-        MOF_Property_Decl* pd = dynamic_cast<MOF_Property_Decl*>(mf);
+    gen_cxx_class(os, cd, rn.c_str(), true);
+    gen_cxx_class(os, cd, al, false);
 
-        if (pd)
-        {
-            const char* pn = pd->name;
-            const char* ktn = _ktype_name(pd->data_type);
-            
-            string type;
-            if (pd->array_index == 0) {
-                // is not array
-                type = string(_ktype_name(pd->data_type));
-            } else {
-                // is array
-                type = string(_ktype_name(pd->data_type))+string("A");
-            }
+    /* $0=al */
+    const char TRAILER[] =
+        "}\n"
+        "}\n"
+        "\n"
+        "#endif /* _konkrete_$0_hpp */\n";
 
-            if (prules.find(type) != prules.end()) {
-                // type has mapping rule
-                append = prules[type];
-                substitute(append, "<PTYPE>", type);
-                substitute(append, "<PNAME>", pd->name);
-                chunk+=append;
-            }
-        }
-    }
-    return;
+    put(os, TRAILER, al, NULL);
+
+    close_output(out);
 }
 
-static void expropers_recursive(string &chunk, const map<string,string> prules, const MOF_Class_Decl* cd)
+// With --split, the header keeps declarations (and the trivial setters) and
+// the bodies of the other inline functions move to <ALIAS>.c, along with the
+// static tables they use (the signatures become external, since providers
+// refer to them). The generated code is regular enough to split as
+// text: functions start with a KINLINE line and end with "}" in the first
+// column, tables start with "static const" and end with "};".
+
+static bool _starts_with(const string& s, const char* prefix)
 {
-    if (cd->super_class) {
-        expropers_recursive(chunk, prules, cd->super_class);
-    }
-    expropers_decls(chunk, prules, cd);
-    return;
+    return s.compare(0, strlen(prefix), prefix) == 0;
 }
 
-static void expropers(string &text, const pair<string,map<string,string> > pset, const MOF_Class_Decl* cd)
+static bool _keep_inline(const vector<string>& lines)
 {
-    string chunk;
-    expropers_recursive(chunk, pset.second, cd);
-    substitute(text, pset.first, chunk);
-    return;
+    const string& head = lines[0];
+
+    if (!_starts_with(head, "KINLINE void ") || lines.size() > 12)
+        return false;
+
+    size_t pos = head.find('(');
+    return pos != string::npos && head.rfind("_Set_", pos) != string::npos;
 }
 
-static void exoutputarg(string &text, const pair<string,map<string,string> > oset, const MOF_Class_Decl* cd, const MOF_Method_Decl* md)
+static void gen_split(
+    const char* al, 
+    const string& text, 
+    string& header, 
+    string& source)
 {
-    string chunk;
+    const char BOX[] =
+        "/*\n"
+        "**$0$0\n"
+        "**\n"
+        "** CAUTION: This file generated by KonkretCMPI. Please do not edit.\n"
+        "**\n"
+        "**$0$0\n"
+        "*/\n"
+        "\n"
+        "#include \"$1.h\"\n"
+        "\n";
 
-    const char* ktn = _ktype_name(md->data_type);
-    map<string,string> orules = oset.second;
+    vector<string> lines;
 
-    for (MOF_Parameter* p = md->parameters; p; p = (MOF_Parameter*)p->next)
+    for (size_t pos = 0; pos < text.size(); )
     {
-        string append;
-        bool out = p->qual_mask & MOF_QT_OUT;
-        if (!out) continue;
-
-        string type;
-        if (p->array_index == 0) {
-            // is not array
-            type = string(_ktype_name(p->data_type));
-        } else {
-            // is array
-            type = string(_ktype_name(p->data_type))+string("A");
-        }
-
-        if (orules.find(type) != orules.end()) {
-            // type has mapping rule
-            append = orules[type];
-            substitute(append, "<MOTYPE>", type);
-            substitute(append, "<MONAME>", p->name);
-            chunk+=append;
-        }
+        size_t end = text.find('\n', pos);
+        end = end == string::npos ? text.size() : end + 1;
+        lines.push_back(text.substr(pos, end - pos));
+        pos = end;
     }
-    
-    substitute(text, oset.first, chunk);
-    return;
-}
 
-static void exinputarg(string &text, const pair<string,map<string,string> > iset, const MOF_Class_Decl* cd, const MOF_Method_Decl* md)
-{
-    string chunk;
+    source = BOX;
+    substitute(source, "$0", LINE39);
+    substitute(source, "$1", al);
 
-    const char* ktn = _ktype_name(md->data_type);
-    map<string,string> irules = iset.second;
+    bool guarded = false;
 
-    for (MOF_Parameter* p = md->parameters; p; p = (MOF_Parameter*)p->next)
+    for (size_t i = 0; i < lines.size(); i++)
     {
-        string append;
-        bool in = p->qual_mask & MOF_QT_IN;
-        if (!in) continue;
+        const string& line = lines[i];
 
-        string type;
-        if (p->array_index == 0) {
-            // is not array
-            type = string(_ktype_name(p->data_type));
-        } else {
-            // is array
-            type = string(_ktype_name(p->data_type))+string("A");
-        }
+        // Give the declarations C linkage (after the includes):
 
-        if (irules.find(type) != irules.end()) {
-            // type has mapping rule
-            append = irules[type];
-            substitute(append, "<MITYPE>", type);
-            substitute(append, "<MINAME>", p->name);
-            chunk+=append;
+        if (!guarded && line == "\n" && i && _starts_with(lines[i-1], "#include"))
+        {
+            header += "\n#ifdef __cplusplus\nextern \"C\" {\n#endif\n";
+            guarded = true;
         }
-    }
-    
-    substitute(text, iset.first, chunk);
-    return;
-}
-
-
-static void exreplace(string &text, const pair<string,string> rrule)
-{
-    ifstream rchunk(rrule.second.c_str(), ios::in|ios::ate|ios::binary);
-    if (!rchunk) {
-        err("problem opening file %s", rrule.first.c_str());
-    }
-    streampos length = rchunk.tellg();
-    rchunk.seekg(0,ios::beg);
 
-    string templ;
-    templ.reserve(length);
-    templ.assign(istreambuf_iterator<char>(rchunk),istreambuf_iterator<char>());
+        if (guarded && _starts_with(line, "#endif /* _konkrete_"))
+            header += "#ifdef __cplusplus\n}\n#endif\n\n";
 
-    rchunk.close();
-    substitute(text, rrule.first.c_str(), templ);
-    return;
-}
+        if (_starts_with(line, "static const "))
+        {
+            // Providers refer to the signatures, so these become external:
 
-static void transform(string &text, const MOF_Class_Decl* cd, const MOF_Method_Decl* md)
-{
-    
-    vector<pair<string,string> >::iterator ri = rall.begin();
-    vector<pair<string,map<string,string> > >::iterator pi = pall.begin();
-    vector<pair<string,map<string,string> > >::iterator oi = oall.begin();
-    vector<pair<string,map<string,string> > >::iterator ii = iall.begin();
-    for (vector<char>::iterator t = torder.begin(); t != torder.end(); t++) {
-        switch (*t) {
-        case 'R':
-            printf("%s replaced for %s\n", (*ri).first.c_str(), (*ri).second.c_str());
-            exreplace(text, *ri);
-            ri++;
-        break;
-        case 'P':
-            printf("%s transformed to properties.\n", (*pi).first.c_str());
-            expropers(text, *pi, cd);
-            pi++;
-        break;
-        case 'O':
-            if (NULL == md) break; /* Run only with valid method declaration */
-            printf("%s transformed to method output arguments.\n", (*oi).first.c_str());
-            exoutputarg(text, *oi, cd, md);
-            oi++;
-        break;
-        case 'i':
-            if (NULL == md) break; /* Run only with valid method declaration */
-            printf("%s transformed to method input arguments.\n", (*ii).first.c_str());
-            exinputarg(text, *ii, cd, md);
-            ii++;
-        break;
-
-        }
-    }
-    return;
-}
+            const char SIG[] = "static const unsigned char ";
 
-static void gen_provider(const MOF_Class_Decl* cd)
-{
-    const char* sn = alias(cd->name);
-    FILE* os;
+            if (_starts_with(line, SIG))
+            {
+                string name = line.substr(strlen(SIG));
+                name = name.substr(0, name.find(' '));
+                header += "KEXTERN const unsigned char " + name + ";\n\n";
+                source += line.substr(strlen("static "));
+                i++;
+            }
 
-    // Form source file name
+            for (; i < lines.size(); i++)
+            {
+                source += lines[i];
 
-    char path[1024];
-    if (ofile.length()<=0) {
-        sprintf(path, "%sProvider.c", sn);
-    } else {
-        sprintf(path, "%s", ofile.c_str());
-    }
+                if (lines[i] == "};\n")
+                    break;
+            }
 
-    if ((os = fopen(path, "r")))
-    {
-        fclose(os);
-        printf("Skipped %s (already exists)\n", path);
-        return;
-    }
+            source += "\n";
 
-    // Open stubs source file:
+            // (And the blank line after it.)
 
-    if (!(os = fopen(path, "w")))
-    {
-        err("failed to open %s for write", path);
-    }
+            if (i + 1 < lines.size() && lines[i+1] == "\n")
+                i++;
 
-    // Generate provider source file.
+            continue;
+        }
 
-    if (cd->qual_mask & MOF_QT_ASSOCIATION)
-    {
-        // Association provider:
-        string text;
-        if (eta.empty())
+        if (!_starts_with(line, "KINLINE "))
         {
-            text = ASSOCIATION_PROVIDER;
-        } else {
-            text = eta;
+            header += line;
+            continue;
         }
-        transform(text, cd, NULL);
-        substitute(text, "<ALIAS>", sn);
-        substitute(text, "<CLASS>", cd->name);
-        fprintf(os, "%s", text.c_str());
-    }
-    else if (cd->qual_mask & MOF_QT_INDICATION)
-    {
-        // Indication provider:
-        string text;
-        if (etn.empty())
+
+        vector<string> func;
+
+        for (; i < lines.size(); i++)
         {
-            text = INDICATION_PROVIDER;
-        } else {
-            text = etn;
+            func.push_back(lines[i]);
+
+            if (lines[i] == "}\n")
+                break;
         }
-        transform(text, cd, NULL);
-        substitute(text, "<ALIAS>", sn);
-        substitute(text, "<CLASS>", cd->name);
-        fprintf(os, "%s", text.c_str());
-    }
-    else
-    {
-        // Instance provider:
-        string text;
-        if (eti.empty())
+
+        if (_keep_inline(func))
         {
-            text = INSTANCE_PROVIDER;
-        } else {
-            text = eti;
+            for (size_t j = 0; j < func.size(); j++)
+                header += func[j];
+
+            continue;
         }
-        transform(text, cd, NULL);
-        substitute(text, "<ALIAS>", sn);
-        substitute(text, "<CLASS>", cd->name);
-        fprintf(os, "%s", text.c_str());
-    }
 
-    // Generate method stubs.
+        // Declaration in the header, definition in the source:
 
-    fprintf(os, "\n");
-    gen_meth_stubs(os, cd);
+        size_t j;
 
-    // Write out KONKRET_REGISTRATION() macro:
+        for (j = 0; j < func.size() && func[j] != "{\n"; j++)
+        {
+            string decl = func[j];
 
-    string provider_types;
+            if (j == 0)
+            {
+                source += decl.substr(strlen("KINLINE "));
+                decl = "KEXTERN " + decl.substr(strlen("KINLINE "));
+            }
+            else
+                source += decl;
 
-    if (cd->qual_mask & MOF_QT_ASSOCIATION)
-        provider_types = "instance association";
-    else if (cd->qual_mask & MOF_QT_INDICATION)
-        provider_types = "indication";
-    else
-        provider_types = "instance method";
+            if (j + 1 < func.size() && func[j+1] == "{\n")
+                decl.insert(decl.size() - 1, ";");
 
-    fprintf(os, "KONKRET_REGISTRATION(\n");
-    fprintf(os, "    \"%s\",\n", "root/cimv2");
-    fprintf(os, "    \"%s\",\n", cd->name);
-    fprintf(os, "    \"%s\",\n", cd->name);
-    fprintf(os, "    \"%s\")\n", provider_types.c_str());
+            header += decl;
+        }
 
-    // Close the file:
-    fclose(os);
-    printf("Created %s\n", path);
+        for (; j < func.size(); j++)
+            source += func[j];
+
+        source += "\n";
+    }
 }
 
 static void gen1(const MOF_Class_Decl* cd, const char* al)
@@ -2623,7 +4260,8 @@ static void gen1(const MOF_Class_Decl* cd, const char* al)
 
     // Open output file
 
-    FILE* os = fopen(path, "wb");
+    Output out;
+    FILE* os = open_output(out, path);
 
     if (!os)
         err("failed to open %s", path);
@@ -2673,6 +4311,7 @@ static void gen1(const MOF_Class_Decl* cd, const char* al)
     gen_object_path(os, cd, rn, true);
     gen_ns(os, rn);
     gen_features(os, cd, rn, true);
+    gen_ref_hash(os, cd, rn);
 
     // Generate class:
 
@@ -2683,6 +4322,7 @@ static void gen1(const MOF_Class_Decl* cd, const char* al)
     gen_object_path(os, cd, cn, false);
     gen_ns(os, cn);
     gen_features(os, cd, cn, false);
+    gen_requested(os, cd, cn);
 
     // Generate methods:
     gen_methods(os, cd, cn);
@@ -2691,6 +4331,11 @@ static void gen1(const MOF_Class_Decl* cd, const char* al)
 
     fprintf(os, "#define %s_ClassName \"%s\"\n\n", al, cd->name);
 
+    // Generate association traversal:
+
+    if (cd->qual_mask & MOF_QT_ASSOCIATION)
+        gen_assoc(os, cd, al);
+
     // Trailer:
 
     const char TRAILER[] =
@@ -2700,25 +4345,294 @@ static void gen1(const MOF_Class_Decl* cd, const char* al)
 
     // Close file:
 
-    fclose(os);
+    if (split)
+    {
+        string header;
+        string source;
+
+        fclose(os);
+        gen_split(al, string(out.data, out.size), header, source);
+        free(out.data);
 
-    printf("Created %s\n", path);
+        write_output(path, header.data(), header.size());
+        write_output(string(al) + ".c", source.data(), source.size());
+    }
+    else
+        close_output(out);
 
-    if (contains(skeletons, cd->name))
+    if (cxx)
+        gen_cxx(cd, al);
+
+    if (_skeleton_names.count(cd->name))
         gen_provider(cd);
 }
 
+// Classes are generated by a pool of workers. Nothing they share changes
+// while they run (the parsed classes, classnames and aliases and the options
+// are all read-only by then) and each class writes its own files.
+
+struct Job
+{
+    const MOF_Class_Decl* cd;
+    const char* al;
+    string notes;
+    bool done;
+};
+
+static vector<Job> _jobs;
+static size_t _next_job;
+static pthread_mutex_t _jobs_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t _jobs_done = PTHREAD_COND_INITIALIZER;
+
+static void* _worker(void*)
+{
+    pthread_once(&_notes_once, _notes_init);
+
+    for (;;)
+    {
+        pthread_mutex_lock(&_jobs_lock);
+        size_t i = _next_job++;
+        pthread_mutex_unlock(&_jobs_lock);
+
+        if (i >= _jobs.size())
+            break;
+
+        Job& job = _jobs[i];
+        pthread_setspecific(_notes_key, &job.notes);
+        gen1(job.cd, job.al);
+        pthread_setspecific(_notes_key, NULL);
+
+        pthread_mutex_lock(&_jobs_lock);
+        job.done = true;
+        pthread_cond_broadcast(&_jobs_done);
+        pthread_mutex_unlock(&_jobs_lock);
+    }
+
+    return NULL;
+}
+
 static void gen()
 {
     for (size_t i = 0; i < classnames.size(); i++)
     {
-        const MOF_Class_Decl* cd;
+        Job job;
         string cn = classnames[i];
 
-        if (!(cd = _find_class(cn.c_str())))
-            err("unknown class: %s", cn.c_str());
+        if (!(job.cd = _find_class(cn.c_str())))
+            err("unknown class: %s", cn.c_str());
+
+        job.al = aliases[i].c_str();
+        job.done = false;
+        _jobs.push_back(job);
+    }
+
+    long n = jobs ? jobs : sysconf(_SC_NPROCESSORS_ONLN);
+
+    // All skeletons share one file with -o (the first one wins):
+
+    if (ofile.size() || n < 1)
+        n = 1;
+
+    if ((size_t)n > _jobs.size())
+        n = _jobs.size();
+
+    if (n <= 1)
+    {
+        for (size_t i = 0; i < _jobs.size(); i++)
+            gen1(_jobs[i].cd, _jobs[i].al);
+
+        return;
+    }
+
+    vector<pthread_t> threads(n);
+
+    for (long i = 0; i < n; i++)
+    {
+        if (pthread_create(&threads[i], NULL, _worker, NULL) != 0)
+            err("failed to create thread");
+    }
+
+    // Print what each class generated, in order:
+
+    for (size_t i = 0; i < _jobs.size(); i++)
+    {
+        pthread_mutex_lock(&_jobs_lock);
+
+        while (!_jobs[i].done)
+            pthread_cond_wait(&_jobs_done, &_jobs_lock);
+
+        pthread_mutex_unlock(&_jobs_lock);
+        fputs(_jobs[i].notes.c_str(), stdout);
+    }
+
+    for (long i = 0; i < n; i++)
+        pthread_join(threads[i], NULL);
+}
+
+static void _put_depfile_path(FILE* os, const string& path)
+{
+    for (size_t i = 0; i < path.size(); i++)
+    {
+        if (path[i] == ' ' || path[i] == '#' || path[i] == '\\')
+            fputc('\\', os);
+        else if (path[i] == '$')
+            fputc('$', os);
+
+        fputc(path[i], os);
+    }
+}
+
+// Writes the generated files (not the skeletons, which belong to the user) as
+// the targets of every MOF and template file that went into them. Make or
+// Ninja (with restat) then reruns konkret only when one of those changes.
+
+static void gen_depfile()
+{
+    FILE* os = fopen(depfile.c_str(), "wb");
+
+    if (!os)
+        err("failed to open %s", depfile.c_str());
+
+    sort(_outputs.begin(), _outputs.end());
+
+    for (size_t i = 0; i < _outputs.size(); i++)
+    {
+        if (i)
+            fputc(' ', os);
+
+        _put_depfile_path(os, _outputs[i]);
+    }
+
+    fputc(':', os);
+
+    vector<string> deps = inputs;
+
+    for (size_t i = 0; i < MOF_num_files_read(); i++)
+        deps.push_back(MOF_file_read(i));
+
+    for (size_t i = 0; i < deps.size(); i++)
+    {
+        fputs(" \\\n  ", os);
+        _put_depfile_path(os, deps[i]);
+    }
+
+    fputc('\n', os);
+
+    if (fclose(os) != 0)
+        err("failed to write %s", depfile.c_str());
+
+    printf("Created %s\n", depfile.c_str());
+}
+
+// With --profile, run() ends each of its phases with _phase() and the timings
+// (along with the parser's) are written as JSON by gen_profile().
+
+static vector<pair<string, double> > _phases;
+static double _phase_start;
+static double _run_start;
+
+static void _phase(const char* name)
+{
+    if (!profile)
+        return;
+
+    double now = MOF_Profile::now();
+    _phases.push_back(pair<string, double>(name, now - _phase_start));
+    _phase_start = now;
+}
+
+static void _put_json_string(FILE* os, const string& str)
+{
+    fputc('"', os);
+
+    for (size_t i = 0; i < str.size(); i++)
+    {
+        unsigned char c = str[i];
+
+        if (c == '"' || c == '\\')
+            fprintf(os, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(os, "\\u%04x", c);
+        else
+            fputc(c, os);
+    }
+
+    fputc('"', os);
+}
+
+static void gen_profile()
+{
+    FILE* os = stderr;
+
+    if (profile_path.size() && !(os = fopen(profile_path.c_str(), "wb")))
+        err("failed to open %s", profile_path.c_str());
+
+    fprintf(os, "{\n");
+    fprintf(os, "  \"seconds\": %.6f,\n", MOF_Profile::now() - _run_start);
+
+    // Phases of the run:
+
+    fprintf(os, "  \"phases\": [");
+
+    for (size_t i = 0; i < _phases.size(); i++)
+    {
+        fprintf(os, "%s\n    { \"name\": ", i ? "," : "");
+        _put_json_string(os, _phases[i].first);
+        fprintf(os, ", \"seconds\": %.6f }", _phases[i].second);
+    }
+
+    fprintf(os, "\n  ],\n");
+
+    // Parts of parsing (which overlap):
+
+    fprintf(os, "  \"parse\": [");
+
+    for (size_t i = 0; i < MOF_Profile::NUM_PHASES; i++)
+    {
+        fprintf(os, "%s\n    { \"name\": \"%s\", \"seconds\": %.6f, "
+            "\"calls\": %lu }", i ? "," : "", MOF_Profile::phase_name(i),
+            MOF_Profile::phase_seconds[i], 
+            (unsigned long)MOF_Profile::phase_calls[i]);
+    }
+
+    fprintf(os, "\n  ],\n");
+
+    // Files in the order the lexer read them:
+
+    fprintf(os, "  \"files\": [");
+
+    for (size_t i = 0; i < MOF_Profile::files.size(); i++)
+    {
+        const MOF_Profile::File& file = MOF_Profile::files[i];
+
+        fprintf(os, "%s\n    { \"path\": ", i ? "," : "");
+        _put_json_string(os, file.path);
+        fprintf(os, ", \"depth\": %lu, \"bytes\": %ld, \"seconds\": %.6f, "
+            "\"self_seconds\": %.6f }", (unsigned long)file.depth, file.bytes, 
+            file.seconds, file.self_seconds);
+    }
+
+    fprintf(os, "\n  ],\n");
+
+    // Parse-tree nodes allocated, by type:
+
+    fprintf(os, "  \"nodes\": {");
+
+    for (size_t i = 0; i < MOF_Profile::NUM_NODES; i++)
+    {
+        fprintf(os, "%s\n    \"%s\": %lu", i ? "," : "", 
+            MOF_Profile::node_name(i), (unsigned long)MOF_Profile::nodes[i]);
+    }
+
+    fprintf(os, "\n  }\n");
+    fprintf(os, "}\n");
+
+    if (os != stderr)
+    {
+        if (fclose(os) != 0)
+            err("failed to write %s", profile_path.c_str());
 
-        gen1(cd, aliases[i].c_str());
+        printf("Created %s\n", profile_path.c_str());
     }
 }
 
@@ -2781,12 +4695,31 @@ static int _find_schema_mof(const char* path, string& schema_mof)
     return -1;
 }
 
+// Where precompiled schemas are kept (empty if disabled):
+
+static string _cache_dir()
+{
+    const char* dir = getenv("KONKRET_CACHE_DIR");
+
+    if (dir)
+        return dir;
+
+    if ((dir = getenv("XDG_CACHE_HOME")) && *dir)
+        return string(dir) + "/konkret";
+
+    if ((dir = getenv("HOME")) && *dir)
+        return string(dir) + "/.cache/konkret";
+
+    return string();
+}
+
 string extemplate(const char *filename)
 {
     ifstream pt(filename, ios::in|ios::ate|ios::binary);
     if (!pt) {
         err("problem opening file %s", filename);
     }
+    inputs.push_back(filename);
     streampos length = pt.tellg();
     pt.seekg(0,ios::beg);
 
@@ -2798,9 +4731,444 @@ string extemplate(const char *filename)
     return(templ);
 }
 
+//==============================================================================
+//
+// Server mode
+//
+//     "konkret --serve SOCKET" parses the schema once and then generates for
+//     the clients that connect to the Unix socket SOCKET. Each request runs in
+//     a process forked from the server (sharing the parsed schema), as if
+//     konkret had been run with the request's arguments in the request's
+//     directory. When KONKRET_SERVER names such a socket, konkret forwards its
+//     command line there, and runs locally instead if no server answers or
+//     if the server has loaded a different schema.
+//
+//     Messages are made of frames: a type byte, a 32-bit big-endian length
+//     and the data. A request is a 'D' frame (the directory), 'V' frames
+//     (NAME=VALUE for the environment variables in _server_env), 'A' frames
+//     (the arguments) and an empty 'G' frame. The reply is 'O' and 'E' frames
+//     (standard output and error) followed by an 'X' frame (the exit status)
+//     or, for a request the server cannot serve, an 'R' frame.
+//
+//==============================================================================
+
+#define SERVER_REFUSED 125
+
+static const char* const _server_env[] =
+{
+    "KONKRET_SCHEMA_DIR",
+    "KONKRET_CACHE_DIR",
+};
+
+#define NUM_SERVER_ENV (sizeof(_server_env) / sizeof(_server_env[0]))
+
+// Set in request processes, along with what the server parsed:
+
+static bool _served = false;
+static vector<string> _served_schema;
+
+static int run(int argc, char** argv);
+
+static int _write_all(int fd, const void* data, size_t size)
+{
+    const char* p = (const char*)data;
+
+    while (size)
+    {
+        ssize_t n = write(fd, p, size);
+
+        if (n < 0 && errno == EINTR)
+            continue;
+
+        if (n <= 0)
+            return -1;
+
+        p += n;
+        size -= n;
+    }
+
+    return 0;
+}
+
+static int _read_all(int fd, void* data, size_t size)
+{
+    char* p = (char*)data;
+
+    while (size)
+    {
+        ssize_t n = read(fd, p, size);
+
+        if (n < 0 && errno == EINTR)
+            continue;
+
+        if (n <= 0)
+            return -1;
+
+        p += n;
+        size -= n;
+    }
+
+    return 0;
+}
+
+static int _put_frame(int fd, char type, const void* data, size_t size)
+{
+    unsigned char head[5];
+
+    head[0] = type;
+    head[1] = (unsigned char)(size >> 24);
+    head[2] = (unsigned char)(size >> 16);
+    head[3] = (unsigned char)(size >> 8);
+    head[4] = (unsigned char)size;
+
+    if (_write_all(fd, head, sizeof(head)) != 0)
+        return -1;
+
+    return _write_all(fd, data, size);
+}
+
+static int _put_frame(int fd, char type, const string& data)
+{
+    return _put_frame(fd, type, data.data(), data.size());
+}
+
+static int _get_frame(int fd, char& type, string& data)
+{
+    unsigned char head[5];
+
+    if (_read_all(fd, head, sizeof(head)) != 0)
+        return -1;
+
+    type = head[0];
+    size_t size = 
+        ((size_t)head[1] << 24) | (head[2] << 16) | (head[3] << 8) | head[4];
+
+    data.resize(size);
+
+    return size ? _read_all(fd, &data[0], size) : 0;
+}
+
+static int _socket_address(const char* path, struct sockaddr_un& addr)
+{
+    if (strlen(path) >= sizeof(addr.sun_path))
+        return -1;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    return 0;
+}
+
+// Forwards the command line to the server at path, returning -1 (without
+// having printed anything) if konkret should run locally instead.
+
+static int forward(const char* path, int argc, char** argv, int& status)
+{
+    struct sockaddr_un addr;
+    int fd;
+
+    if (_socket_address(path, addr) != 0 || 
+        (fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+    {
+        return -1;
+    }
+
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    // Send the request:
+
+    char cwd[PATH_MAX];
+    int r = getcwd(cwd, sizeof(cwd)) ? _put_frame(fd, 'D', cwd, strlen(cwd)) : -1;
+
+    for (size_t i = 0; r == 0 && i < NUM_SERVER_ENV; i++)
+    {
+        const char* value = getenv(_server_env[i]);
+
+        if (value)
+            r = _put_frame(fd, 'V', string(_server_env[i]) + "=" + value);
+    }
+
+    for (int i = 1; r == 0 && i < argc; i++)
+        r = _put_frame(fd, 'A', argv[i], strlen(argv[i]));
+
+    if (r == 0)
+        r = _put_frame(fd, 'G', "", 0);
+
+    // The output is held back until the server has accepted the request:
+
+    string out;
+    string errs;
+    char type;
+    string data;
+
+    while (r == 0 && _get_frame(fd, type, data) == 0)
+    {
+        if (type == 'O')
+            out += data;
+        else if (type == 'E')
+            errs += data;
+        else if (type == 'X' && data.size() == 4)
+        {
+            const unsigned char* p = (const unsigned char*)data.data();
+            status = (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+
+            close(fd);
+            fwrite(out.data(), 1, out.size(), stdout);
+            fwrite(errs.data(), 1, errs.size(), stderr);
+            return 0;
+        }
+        else
+            break;
+    }
+
+    close(fd);
+    return -1;
+}
+
+// What a server has parsed: the MOF files and the include path.
+
+static vector<string> _schema(const vector<string>& mofs)
+{
+    vector<string> schema;
+    char buf[PATH_MAX];
+
+    for (size_t i = 0; i < mofs.size(); i++)
+        schema.push_back(realpath(mofs[i].c_str(), buf) ? buf : mofs[i]);
+
+    schema.push_back("-I");
+
+    for (size_t i = 0; i < MOF_num_include_paths; i++)
+    {
+        const char* path = MOF_include_paths[i];
+        schema.push_back(realpath(path, buf) ? buf : path);
+    }
+
+    return schema;
+}
+
+// Runs one request in a child process, relaying its output:
+
+static void _handle(int fd)
+{
+    string dir;
+    vector<string> env;
+    vector<string> args;
+    char type;
+    string data;
+
+    do
+    {
+        if (_get_frame(fd, type, data) != 0)
+            return;
+
+        if (type == 'D')
+            dir = data;
+        else if (type == 'V')
+            env.push_back(data);
+        else if (type == 'A')
+            args.push_back(data);
+        else if (type != 'G')
+            return;
+    }
+    while (type != 'G');
+
+    int out[2];
+    int errs[2];
+
+    if (pipe(out) != 0 || pipe(errs) != 0)
+        return;
+
+    pid_t pid = fork();
+
+    if (pid < 0)
+        return;
+
+    if (pid == 0)
+    {
+        close(fd);
+        dup2(out[1], 1);
+        dup2(errs[1], 2);
+        close(out[0]);
+        close(out[1]);
+        close(errs[0]);
+        close(errs[1]);
+
+        if (chdir(dir.c_str()) != 0)
+            err("failed to change directory to %s", dir.c_str());
+
+        for (size_t i = 0; i < NUM_SERVER_ENV; i++)
+            unsetenv(_server_env[i]);
+
+        for (size_t i = 0; i < env.size(); i++)
+        {
+            size_t pos = env[i].find('=');
+            string name = env[i].substr(0, pos);
+            setenv(name.c_str(), env[i].c_str() + pos + 1, 1);
+        }
+
+        vector<char*> argv;
+        argv.push_back((char*)arg0);
+
+        for (size_t i = 0; i < args.size(); i++)
+            argv.push_back((char*)args[i].c_str());
+
+        argv.push_back(NULL);
+
+        // Start over with the options:
+
+        _served = true;
+        MOF_num_include_paths = 0;
+        optind = 0;
+
+        exit(run(argv.size() - 1, &argv[0]));
+    }
+
+    close(out[1]);
+    close(errs[1]);
+
+    struct pollfd fds[2];
+    fds[0].fd = out[0];
+    fds[0].events = POLLIN;
+    fds[1].fd = errs[0];
+    fds[1].events = POLLIN;
+
+    for (int n = 2; n; )
+    {
+        if (poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            break;
+        }
+
+        for (int i = 0; i < 2; i++)
+        {
+            if (fds[i].fd < 0 || !fds[i].revents)
+                continue;
+
+            char buf[4096];
+            ssize_t size = read(fds[i].fd, buf, sizeof(buf));
+
+            if (size > 0)
+                _put_frame(fd, i ? 'E' : 'O', buf, size);
+            else if (size == 0 || errno != EINTR)
+            {
+                close(fds[i].fd);
+                fds[i].fd = -1;
+                n--;
+            }
+        }
+    }
+
+    int status;
+
+    if (waitpid(pid, &status, 0) != pid)
+        return;
+
+    if (WIFEXITED(status) && WEXITSTATUS(status) == SERVER_REFUSED)
+    {
+        _put_frame(fd, 'R', "", 0);
+        return;
+    }
+
+    int code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    unsigned char buf[4];
+    buf[0] = (unsigned char)(code >> 24);
+    buf[1] = (unsigned char)(code >> 16);
+    buf[2] = (unsigned char)(code >> 8);
+    buf[3] = (unsigned char)code;
+    _put_frame(fd, 'X', buf, sizeof(buf));
+}
+
+static int serve(const char* path, const vector<string>& schema)
+{
+    struct sockaddr_un addr;
+    int fd;
+
+    if (_socket_address(path, addr) != 0)
+        err("socket path too long: %s", path);
+
+    if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+        err("failed to create socket");
+
+    unlink(path);
+
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(fd, SOMAXCONN) != 0)
+    {
+        err("failed to listen on %s", path);
+    }
+
+    _served_schema = schema;
+
+    // Connections are handled by children that nobody waits for:
+
+    signal(SIGCHLD, SIG_IGN);
+
+    printf("Serving on %s\n", path);
+    fflush(stdout);
+
+    for (;;)
+    {
+        int conn = accept(fd, NULL, NULL);
+
+        if (conn < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+
+            err("failed to accept connection on %s", path);
+        }
+
+        pid_t pid = fork();
+
+        if (pid == 0)
+        {
+            close(fd);
+            signal(SIGCHLD, SIG_DFL);
+            _handle(conn);
+            _exit(0);
+        }
+
+        close(conn);
+    }
+
+    return 0;
+}
+
 int main(int argc, char** argv)
 {
     arg0 = argv[0];
+
+    // Hand the command line to a running server, if there is one:
+
+    const char* server = getenv("KONKRET_SERVER");
+    int status;
+
+    if (server && *server)
+    {
+        bool serving = false;
+
+        for (int i = 1; i < argc; i++)
+        {
+            if (strncmp(argv[i], "--serve", 7) == 0)
+                serving = true;
+        }
+
+        if (!serving && forward(server, argc, argv, status) == 0)
+            return status;
+    }
+
+    return run(argc, argv);
+}
+
+static int run(int argc, char** argv)
+{
     const char USAGE[] =
         "Usage: %s [OPTIONS] CLASS=ALIAS[!]...\n"
         "\n"
@@ -2811,24 +5179,49 @@ int main(int argc, char** argv)
         "  -i STR=FILE Replace STR with method input arguments.\n"
         "  -I DIR      Search for included MOF files in this directory\n"
         "  -m FILE     Add MOF file to list of MOFs to parse\n"
-        "  -v          Print the version\n"
+        "  -v, --version\n"
+        "              Print the version\n"
         "  -s CLASS    Write provider skeleton for CLASS to <ALIAS>Provider.c\n"
         "              (or use CLASS=ALIAS! form instead).\n"
         "  -o FILE     Write main skeleton to custom FILE.\n"
         "  -k          Use __status instead of status for result reporting.\n"
         "  -f FILE     Read CLASS=ALIAS[!] argumetns the given file.\n"
-        "  -h          Print this help message\n"
+        "  -h, --help  Print this help message\n"
         "  -a FILE     Template for association provider\n"
         "  -c FILE     Template for class instance provider\n"
         "  -n FILE     Template for indication provider\n"
         "  -M FILE     Template for method provider\n"
+        "  -L LIB      Build the skeletons into one provider library, LIB, with\n"
+        "              a shared broker and a dispatcher (LIB.c and LIB.h).\n"
+        "  -x          Also write C++11 wrappers for each class to <ALIAS>.hpp\n"
+        "  -j, --jobs N\n"
+        "              Generate N classes at a time (default: one per CPU)\n"
+        "  -d, --depfile FILE\n"
+        "              Write a Make/Ninja depfile naming the generated headers\n"
+        "              and every MOF and template file they were made from.\n"
+        "  --profile[=FILE]\n"
+        "              Write phase timings, the time and size of each MOF file\n"
+        "              parsed and counts of parse-tree nodes as JSON to FILE\n"
+        "              (or standard error).\n"
+        "  --split     Keep only declarations (and trivial setters) in <ALIAS>.h\n"
+        "              and write the function bodies to <ALIAS>.c, which must\n"
+        "              then be built along with the providers.\n"
+        "  --serve SOCKET\n"
+        "              Parse the schema (see -I and -m) once and generate for\n"
+        "              clients connecting to the Unix socket SOCKET.\n"
         "\n"
         "ENVIRONMENT VARIABLES:\n"
         "  KONKRET_SCHEMA_DIR -- searched for schema MOF files\n"
+        "  KONKRET_CACHE_DIR -- holds precompiled schemas (default:\n"
+        "      $XDG_CACHE_HOME/konkret or ~/.cache/konkret; empty to disable)\n"
+        "  KONKRET_SERVER -- socket of a konkret --serve to forward to (if it\n"
+        "      has the same schema; konkret runs by itself otherwise)\n"
         "\n";
     string schema_mof;
     vector<string> mofs;
 
+    _run_start = _phase_start = MOF_Profile::now();
+
     // Turn on MOF warnings.
 
     MOF_Options::warn = true;
@@ -2892,10 +5285,39 @@ int main(int argc, char** argv)
 
     vector<string> args;
 
-    for (int opt; (opt = getopt(argc, argv, "P:R:I:m:vhs:f:a:c:n:o:kM:O:i:")) != -1; )
+    enum { OPT_SERVE = 256, OPT_SPLIT, OPT_PROFILE };
+    const struct option LONG_OPTIONS[] =
+    {
+        { "depfile", required_argument, NULL, 'd' },
+        { "help", no_argument, NULL, 'h' },
+        { "jobs", required_argument, NULL, 'j' },
+        { "profile", optional_argument, NULL, OPT_PROFILE },
+        { "serve", required_argument, NULL, OPT_SERVE },
+        { "split", no_argument, NULL, OPT_SPLIT },
+        { "version", no_argument, NULL, 'v' },
+        { NULL, 0, NULL, 0 },
+    };
+    const char OPTIONS[] = "P:R:I:m:vhs:f:a:c:n:o:kM:O:i:L:xj:d:";
+    string serve_path;
+
+    for (int opt; 
+        (opt = getopt_long(argc, argv, OPTIONS, LONG_OPTIONS, NULL)) != -1; )
     {
         switch (opt)
         {
+            case OPT_SERVE:
+                serve_path = optarg;
+                break;
+            case OPT_SPLIT:
+                split = true;
+                break;
+            case OPT_PROFILE:
+                profile = true;
+                MOF_Profile::enabled = true;
+
+                if (optarg)
+                    profile_path = optarg;
+                break;
             case 'o':
             {
                 ofile = string(optarg);
@@ -2935,6 +5357,7 @@ int main(int argc, char** argv)
                         tlist[ptype] = pcode;
                 }
                 pmap.close();
+                inputs.push_back(pfilename);
 
                 pall.push_back(pair<string,map<string, string> >(token, tlist));
 
@@ -3000,6 +5423,7 @@ int main(int argc, char** argv)
                         tlist[otype] = ocode;
                 }
                 omap.close();
+                inputs.push_back(ofilename);
 
                 oall.push_back(pair<string,map<string, string> >(token, tlist));
 
@@ -3040,6 +5464,7 @@ int main(int argc, char** argv)
                         tlist[itype] = icode;
                 }
                 imap.close();
+                inputs.push_back(ifilename);
 
                 iall.push_back(pair<string,map<string, string> >(token, tlist));
 
@@ -3145,6 +5570,7 @@ int main(int argc, char** argv)
                 }
 
                 fclose(is);
+                inputs.push_back(optarg);
                 break;
             }
             case 'a':
@@ -3162,6 +5588,24 @@ int main(int argc, char** argv)
             case 'k':
                 around = true;
                 break;
+            case 'L':
+                library = optarg;
+                break;
+            case 'x':
+                cxx = true;
+                break;
+            case 'd':
+                depfile = optarg;
+                break;
+            case 'j':
+            {
+                char* end;
+                jobs = strtol(optarg, &end, 10);
+
+                if (*end || jobs < 1)
+                    err("invalid -j option: %s", optarg);
+                break;
+            }
 
             default:
                 err("invalid option: %c; try -h for help", opt);
@@ -3169,9 +5613,22 @@ int main(int argc, char** argv)
         }
     }
 
-    if (args.size() == 0 && optind == argc)
+    if (serve_path.size())
+    {
+        if (args.size() || optind != argc || torder.size() || 
+            eta.size() || eti.size() || etn.size() || etm.size() || 
+            ofile.size() || library.size() || skeletons.size() || 
+            around || cxx || split || jobs || depfile.size())
+        {
+            err("--serve only takes the -I and -m options; the rest come "
+                "with each request");
+        }
+    }
+    else if (args.size() == 0 && optind == argc)
         err("insufficient command line arguments. Try -h for help");
 
+    _phase("options");
+
     // Print using message:
 
     printf("Using: %s\n", schema_mof.c_str());
@@ -3198,8 +5655,7 @@ int main(int argc, char** argv)
             skeletons.push_back(cn);
         }
 
-        classnames.push_back(cn);
-        aliases.push_back(al);
+        add_class(cn, al);
     }
 
     // There must be at least one MOF file.
@@ -3207,38 +5663,65 @@ int main(int argc, char** argv)
     if (mofs.size() == 0)
         err("no MOF files to parse. Try -h for help");
 
-    // Parse all the MOF files:
+    // A server has parsed its schema already (but not necessarily this one):
 
-    for (size_t i = 0; i < mofs.size(); i++)
+    if (_served)
     {
-        MOF_parse_file(mofs[i].c_str());
+        if (_schema(mofs) != _served_schema)
+            exit(SERVER_REFUSED);
     }
+    // Parse what the classes need from the MOF files (or load it precompiled),
+    // into an arena since the classes live as long as we do:
+    else
+    {
+        vector<const char*> files;
+        vector<const char*> names;
 
-    // Calculate dependencies (updating classnames and aliases).
+        MOF_begin_arena();
+
+        for (size_t i = 0; i < mofs.size(); i++)
+            files.push_back(mofs[i].c_str());
+
+        for (size_t i = 0; i < classnames.size(); i++)
+            names.push_back(classnames[i].c_str());
+
+        string cache_dir = _cache_dir();
+        MOF_parse_classes_cached(&files[0], files.size(), 
+            names.empty() ? 0 : &names[0], names.size(), cache_dir.c_str());
+    }
+
+    _phase("parse");
+    index_classes();
+
+    // The workers (and the server's children) share the classes:
+
+    MOF_freeze();
+    _phase("index");
+
+    if (serve_path.size())
     {
-        vector<string> tmp = classnames;
+        if (profile)
+            gen_profile();
 
-        for (size_t i = 0; i < tmp.size(); i++)
-        {
-            vector<string> deps;
-            recursive_dependencies(tmp[i], deps);
+        return serve(serve_path.c_str(), _schema(mofs));
+    }
 
-            for (size_t j = 0; j < deps.size(); j++)
-            {
-                if (!contains(classnames, deps[j]))
-                {
-                    classnames.push_back(deps[j]);
-                    aliases.push_back(deps[j]);
-                }
-            }
-        }
+    // Calculate dependencies (updating classnames and aliases).
+    {
+        set<const MOF_Class_Decl*> visited;
+        size_t n = classnames.size();
+
+        for (size_t i = 0; i < n; i++)
+            add_dependencies(classnames[i], visited);
     }
 
     // Check that classes will be generated for each skeleton.
 
     for (size_t i = 0; i < skeletons.size(); i++)
     {
-        if (!contains(classnames, skeletons[i]))
+        _skeleton_names.insert(skeletons[i]);
+
+        if (!is_class(skeletons[i]))
         {
             err("Class given by -s option (%s) must also appear on the command "
                 "line on the class list. For example:\n\n"
@@ -3246,9 +5729,35 @@ int main(int argc, char** argv)
         }
     }
 
+    // A library must have at least one provider.
+
+    if (library.size() && skeletons.empty())
+        err("no provider skeletons for library %s (see -s or CLASS=ALIAS!)",
+            library.c_str());
+
+    _phase("closure");
+
     // Write files:
 
+    compile_templates();
+    _phase("templates");
     gen();
+    _phase("generate");
+
+    if (library.size())
+    {
+        gen_library();
+        _phase("library");
+    }
+
+    if (depfile.size())
+    {
+        gen_depfile();
+        _phase("depfile");
+    }
+
+    if (profile)
+        gen_profile();
 
     return 0;
 }
@@ -0,0 +1,133 @@
+/* ex: set tabstop=4 expandtab: */
+/*
+**==============================================================================
+**
+** Copyright (c) 2008, Michael E. Brasher
+** 
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+** 
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+** 
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+**==============================================================================
+*/
+
+// Parses a small schema into an arena with the repository cache on, frees
+// the arena, then parses it again: the second parse loads the repository
+// (into a fresh arena) instead of the MOF file. Exits non-zero on failure.
+
+#include "mof/MOF_Parser.h"
+#include "mof/MOF_Class_Decl.h"
+#include "mof/MOF_Qualifier_Decl.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <dirent.h>
+
+using namespace std;
+
+static const char SCHEMA[] =
+    "Qualifier Key : boolean = false, Scope(property, reference),\n"
+    "    Flavor(DisableOverride, ToSubclass);\n"
+    "class Test_Base { [Key] string Id; };\n"
+    "class Test_Sub : Test_Base { uint32 Count; };\n";
+
+static int _check(const char* what)
+{
+    // (find() fixes the case of the name it is given)
+    char class_name[] = "test_sub";
+    char qual_name[] = "key";
+    MOF_Class_Decl* cd = MOF_Class_Decl::find(class_name);
+
+    if (!cd || !cd->super_class || !MOF_Qualifier_Decl::find(qual_name))
+    {
+        fprintf(stderr, "repository-arena: %s: classes missing\n", what);
+        return -1;
+    }
+
+    // The class must come from this pass's list, not an earlier arena:
+
+    for (const MOF_Element* p = MOF_Class_Decl::list; p; p = p->next)
+    {
+        if (p == cd)
+            return 0;
+    }
+
+    fprintf(stderr, "repository-arena: %s: stale class index\n", what);
+    return -1;
+}
+
+int main()
+{
+    char dir[] = "/tmp/konkret-test.XXXXXX";
+    int status = 0;
+
+    if (!mkdtemp(dir))
+    {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    string mof = string(dir) + "/test.mof";
+    string cache = string(dir) + "/cache";
+    FILE* os = fopen(mof.c_str(), "w");
+
+    if (!os)
+    {
+        perror(mof.c_str());
+        return 1;
+    }
+
+    fputs(SCHEMA, os);
+    fclose(os);
+
+    // The first pass writes the repository, the second (and third) read it:
+
+    for (int i = 0; i < 3 && status == 0; i++)
+    {
+        MOF_begin_arena();
+
+        if (MOF_parse_file_cached(mof.c_str(), cache.c_str()) != 0)
+        {
+            fprintf(stderr, "repository-arena: pass %d: parse failed\n", i);
+            status = -1;
+        }
+        else
+            status = _check(i == 0 ? "parse" : "repository");
+
+        MOF_free_arena();
+    }
+
+    // Clean up:
+
+    DIR* d = opendir(cache.c_str());
+
+    if (d)
+    {
+        for (struct dirent* ent; (ent = readdir(d)) != NULL; )
+            unlink((cache + "/" + ent->d_name).c_str());
+
+        closedir(d);
+    }
+
+    rmdir(cache.c_str());
+    unlink(mof.c_str());
+    rmdir(dir);
+
+    return status == 0 ? 0 : 1;
+}